@@ -10,28 +10,28 @@
 
 #include "ff.h"
 
-int dldi_init(void)
+int dldi_init(void *priv)
 {
 	const DISC_INTERFACE *dldi = dldiGetInternal();
 	if (dldi == NULL) return 1;
 	return dldi->startup();
 }
 
-int dldi_online(void)
+int dldi_online(void *priv)
 {
 	const DISC_INTERFACE *dldi = dldiGetInternal();
 	if (dldi == NULL) return 1;
 	return dldi->isInserted();
 }
 
-int dldi_read(BYTE *buf, DWORD start, UINT count)
+int dldi_read(void *priv, BYTE *buf, DWORD start, UINT count)
 {
 	const DISC_INTERFACE *dldi = dldiGetInternal();
 	if (dldi == NULL) return 1;
 	return !dldi->readSectors(start, count, buf);
 }
 
-int dldi_write(const BYTE *buf, DWORD start, UINT count)
+int dldi_write(void *priv, const BYTE *buf, DWORD start, UINT count)
 {
 	const DISC_INTERFACE *dldi = dldiGetInternal();
 	if (dldi == NULL) return 1;
@@ -47,5 +47,5 @@ static const fat_disk_ops fat_ops = {
 
 int dldi_mount(char drive)
 {
-	return fat_mount(drive, &fat_ops);
+	return fat_mount(drive, &fat_ops, NULL);
 }
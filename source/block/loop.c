@@ -0,0 +1,109 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "vfs.h"
+
+#include "fat.h"
+
+#include "ff.h"
+
+#include "loop.h"
+
+typedef struct {
+	int fd;
+	bool ro;
+	DWORD sectors;
+} loop_dev_t;
+
+static int loop_init(void *priv)
+{
+	return 1;
+}
+
+static int loop_online(void *priv)
+{
+	loop_dev_t *dev = priv;
+	return dev->fd >= 0;
+}
+
+/*
+ * sector translation is a plain positional read on the backing file
+ * the backing driver maps the offset to its clusters on its own
+ */
+static int loop_read(void *priv, BYTE *buf, DWORD start, UINT count)
+{
+	loop_dev_t *dev = priv;
+	off_t len = count * FAT_SECT_SIZE;
+
+	if ((start + count) > dev->sectors) return 1;
+	return vfs_pread(dev->fd, buf, len, start * FAT_SECT_SIZE) != len;
+}
+
+static int loop_write(void *priv, const BYTE *buf, DWORD start, UINT count)
+{
+	loop_dev_t *dev = priv;
+	off_t len = count * FAT_SECT_SIZE;
+
+	if (dev->ro || (start + count) > dev->sectors) return 1;
+	return vfs_pwrite(dev->fd, buf, len, start * FAT_SECT_SIZE) != len;
+}
+
+static void loop_release(void *priv)
+{
+	loop_dev_t *dev = priv;
+	vfs_close(dev->fd);
+	mem_free(dev);
+}
+
+static const fat_disk_ops loop_ops = {
+	.init = loop_init,
+	.online = loop_online,
+	.read = loop_read,
+	.write = loop_write,
+	.release = loop_release,
+};
+
+int loop_mount(char drive, const char *path)
+{
+	int res;
+	off_t size;
+	loop_dev_t *dev;
+
+	dev = mem_alloc(MEM_BLOCK, sizeof(*dev));
+	if (dev == NULL) return -ERR_MEM;
+
+	dev->ro = false;
+	dev->fd = vfs_open(path, VFS_RW);
+	if (IS_ERR(dev->fd)) {
+		dev->ro = true;
+		dev->fd = vfs_open(path, VFS_RO);
+	}
+
+	if (IS_ERR(dev->fd)) {
+		res = dev->fd;
+		mem_free(dev);
+		return res;
+	}
+
+	size = vfs_size(dev->fd);
+	if (IS_ERR(size) || size < FAT_SECT_SIZE) {
+		res = IS_ERR(size) ? size : -ERR_ARG;
+		vfs_close(dev->fd);
+		mem_free(dev);
+		return res;
+	}
+
+	/* a trailing partial sector is unreachable anyway */
+	dev->sectors = size / FAT_SECT_SIZE;
+
+	res = fat_mount(drive, &loop_ops, dev);
+	if (IS_ERR(res)) {
+		vfs_close(dev->fd);
+		mem_free(dev);
+	}
+
+	return res;
+}
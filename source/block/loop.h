@@ -0,0 +1,13 @@
+#ifndef LOOP_H__
+#define LOOP_H__
+
+#include <nds.h>
+
+/*
+ * mounts the FAT disk image at `path` (a global VFS path) as `drive`
+ * the image is opened read-write when possible and stays open
+ * until the drive is unmounted, so the backing drive remains busy
+ */
+int loop_mount(char drive, const char *path);
+
+#endif /* LOOP_H__ */
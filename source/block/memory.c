@@ -2,37 +2,58 @@
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
 
 #include "vfs.h"
 
 #include "devfs.h"
+#include "xfer.h"
 
 off_t memfs_read(devfs_entry_t *entry, void *buf, off_t pos, off_t size)
 {
     uintptr_t src = GET_PRIVDATA(entry, uintptr_t) + pos;
-    memcpy(buf, (void*)src, size);
+    xfer_copy(buf, (void*)src, size);
     return size;
 }
 
 off_t memfs_write(devfs_entry_t *entry, const void *buf, off_t pos, off_t size)
 {
     uintptr_t dst = GET_PRIVDATA(entry, uintptr_t) + pos;
-    memcpy((void*)dst, buf, size);
+    xfer_copy((void*)dst, buf, size);
     return size;
 }
 
+/* the heap report is read straight out of this, refreshed on every open */
+static char heap_text[MEM_TEXTSZ];
+
+int memfs_open(devfs_entry_t *entry)
+{
+    if (entry->priv == heap_text)
+        entry->size = mem_format(heap_text, sizeof(heap_text));
+    return 0;
+}
+
+const void *memfs_map(devfs_entry_t *entry, off_t pos)
+{
+    return (const void*)(GET_PRIVDATA(entry, uintptr_t) + pos);
+}
+
+/* ITCM is mirrored all over the first 32 MiB, this copy doesn't sit at NULL */
 static devfs_entry_t memfs_entries[] = {
     {.name = "/bios", .priv = (void*)0xFFFF0000, .size = SIZE_KIB(32), .flags = VFS_FILE | VFS_RO},
-    {.name = "/itcm", .priv = (void*)0x00000000, .size = SIZE_KIB(32), .flags = VFS_FILE | VFS_RO},
+    {.name = "/itcm", .priv = (void*)0x01FF8000, .size = SIZE_KIB(32), .flags = VFS_FILE | VFS_RO},
     {.name = "/mram", .priv = (void*)0x02000000, .size = SIZE_MIB(4), .flags = VFS_FILE | VFS_RO},
+    {.name = "/heap", .priv = heap_text, .size = 0, .flags = VFS_FILE | VFS_RO},
 };
 
 static devfs_t memfs = {
     .dev_entry = memfs_entries,
     .n_entries = ARRAY_SIZE(memfs_entries),
     .label = "Memory",
+    .dev_open = memfs_open,
     .dev_read = memfs_read,
     .dev_write = memfs_write,
+    .dev_map = memfs_map,
 };
 
 int memfs_init(char drive)
@@ -0,0 +1,394 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "vfs.h"
+
+#include "bioscomp.h"
+
+/* anything bigger is more likely to be a false positive than real data */
+#define BIOSCOMP_MAXOUT	(SIZE_MIB(32))
+
+typedef struct {
+	mount_t mnt;	/* stand-in mount holding the view operations */
+	mount_t *base;
+	vf_t *file;
+	bioscomp_t z;
+} bioscomp_view_t;
+
+static inline u32 _bioscomp_u32(const u8 *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+int bioscomp_type(const void *hdr, off_t in_size)
+{
+	const u8 *h = hdr;
+	u32 size = _bioscomp_u32(h) >> 8;
+
+	switch(h[0]) {
+		case BIOSCOMP_LZ10:
+		case BIOSCOMP_LZ11:
+		case BIOSCOMP_HUFF4:
+		case BIOSCOMP_HUFF8:
+		case BIOSCOMP_RLE:
+			break;
+		default:
+			return -ERR_UNSUPP;
+	}
+
+	/* zero means the real size follows in the next word, can't check it */
+	if (size == 0) return (in_size > 8) ? h[0] : -ERR_UNSUPP;
+
+	/* none of the formats can shrink data to less than an eighth */
+	if (size > BIOSCOMP_MAXOUT || in_size <= 4 || size < ((in_size - 4) / 8))
+		return -ERR_UNSUPP;
+	return h[0];
+}
+
+const char *bioscomp_name(int type)
+{
+	switch(type) {
+		case BIOSCOMP_LZ10: return "LZ10";
+		case BIOSCOMP_LZ11: return "LZ11";
+		case BIOSCOMP_HUFF4: return "Huffman (4 bit)";
+		case BIOSCOMP_HUFF8: return "Huffman (8 bit)";
+		case BIOSCOMP_RLE: return "RLE";
+		default: return "unknown";
+	}
+}
+
+/* keeps the unread tail and tops the buffer up, padding it with zeros */
+static void _bioscomp_fill(bioscomp_t *z)
+{
+	u32 keep = z->in_len - z->in_idx;
+	off_t n = z->in_size - z->in_pos;
+
+	memmove(z->in, &z->in[z->in_idx], keep);
+	if (n > (BIOSCOMP_INBUF - keep)) n = BIOSCOMP_INBUF - keep;
+
+	if (n > 0) {
+		if (z->read(z->priv, &z->in[keep], n, z->in_pos) != n) {
+			z->error = true;
+			n = 0;
+		}
+		z->in_pos += n;
+	}
+
+	z->in_len = keep + n;
+	z->in_idx = 0;
+	z->in_eof = (z->in_pos >= z->in_size);
+	memset(&z->in[z->in_len], 0, BIOSCOMP_TOKEN);
+}
+
+static u8 _bioscomp_byte(bioscomp_t *z)
+{
+	if (UNLIKELY(z->in_idx >= z->in_len)) {
+		if (z->in_eof) {
+			z->error = true;
+			return 0;
+		}
+		_bioscomp_fill(z);
+		if (z->in_len == 0) {
+			z->error = true;
+			return 0;
+		}
+	}
+
+	return z->in[z->in_idx++];
+}
+
+static size_t _bioscomp_rle(bioscomp_t *z, u8 *dst, size_t size)
+{
+	size_t done = 0;
+
+	while(done < size && !z->error) {
+		u32 n;
+
+		if (z->left == 0) {
+			u8 flag = _bioscomp_byte(z);
+
+			z->raw = !(flag & 0x80);
+			if (z->raw) {
+				z->left = (flag & 0x7F) + 1;
+			} else {
+				z->left = (flag & 0x7F) + 3;
+				z->dist = _bioscomp_byte(z);
+			}
+		}
+
+		n = (z->left < (size - done)) ? z->left : (size - done);
+		z->left -= n;
+
+		if (z->raw) {
+			while(n--) {
+				u8 b = _bioscomp_byte(z);
+				if (dst) dst[done] = b;
+				done++;
+			}
+		} else {
+			if (dst) memset(&dst[done], z->dist, n);
+			done += n;
+		}
+	}
+
+	return done;
+}
+
+/*
+ * walks the tree one bit at a time, bits come MSB first out of LE words
+ * 4 bit units are packed into bytes low nibble first
+ */
+static size_t _bioscomp_huff(bioscomp_t *z, u8 *dst, size_t size)
+{
+	const u8 *tree = z->tree;
+	bool nibbles = (z->type == BIOSCOMP_HUFF4);
+	size_t done = 0;
+
+	while(done < size && !z->error) {
+		u32 addr = 1, node = tree[1], unit;
+
+		while(1) {
+			u32 bit, child;
+
+			if (z->hbits == 0) {
+				z->hword = _bioscomp_byte(z);
+				z->hword |= _bioscomp_byte(z) << 8;
+				z->hword |= _bioscomp_byte(z) << 16;
+				z->hword |= (u32)_bioscomp_byte(z) << 24;
+				z->hbits = 32;
+			}
+
+			bit = z->hword >> 31;
+			z->hword <<= 1;
+			z->hbits--;
+
+			child = (addr & ~1) + ((node & 0x3F) << 1) + 2 + bit;
+			if (child >= z->tree_len) {
+				z->error = true;
+				return done;
+			}
+
+			if (node & (bit ? 0x40 : 0x80)) {
+				unit = tree[child];
+				break;
+			}
+
+			addr = child;
+			node = tree[child];
+		}
+
+		if (nibbles) {
+			z->hacc |= (unit & 0xF) << z->hnacc;
+			z->hnacc += 4;
+			if (z->hnacc < 8) continue;
+			unit = z->hacc;
+			z->hacc = z->hnacc = 0;
+		}
+
+		if (dst) dst[done] = unit;
+		done++;
+	}
+
+	return done;
+}
+
+int bioscomp_init(bioscomp_t *z, bioscomp_read_fn read, void *priv, off_t in_size)
+{
+	u8 hdr[8];
+	off_t hlen = (in_size < 8) ? in_size : 8;
+	int type;
+
+	if (hlen < 4 || read(priv, hdr, hlen, 0) != hlen) return -ERR_IO;
+
+	type = bioscomp_type(hdr, in_size);
+	if (IS_ERR(type)) return type;
+
+	z->read = read;
+	z->priv = priv;
+	z->type = type;
+	z->in_size = in_size;
+	z->out_size = _bioscomp_u32(hdr) >> 8;
+	z->data = 4;
+
+	if (z->out_size == 0) {
+		z->out_size = _bioscomp_u32(&hdr[4]);
+		z->data = 8;
+		if (z->out_size > BIOSCOMP_MAXOUT) return -ERR_UNSUPP;
+	}
+
+	if (type == BIOSCOMP_HUFF4 || type == BIOSCOMP_HUFF8) {
+		u8 tsz;
+
+		if (read(priv, &tsz, 1, z->data) != 1) return -ERR_IO;
+		z->tree_len = (tsz + 1) * 2;
+		if (read(priv, z->tree, z->tree_len, z->data) != z->tree_len) return -ERR_IO;
+		z->data += z->tree_len;
+	}
+
+	/* room for the zero padding behind the last byte */
+	z->in = mem_alloc(MEM_DECOMP, BIOSCOMP_INBUF + BIOSCOMP_TOKEN);
+	if (z->in == NULL) return -ERR_MEM;
+
+	bioscomp_rewind(z);
+	return 0;
+}
+
+void bioscomp_free(bioscomp_t *z)
+{
+	mem_free(z->in);
+	z->in = NULL;
+}
+
+void bioscomp_rewind(bioscomp_t *z)
+{
+	z->in_len = z->in_idx = 0;
+	z->in_pos = z->data;
+	z->in_eof = (z->in_pos >= z->in_size);
+	z->error = false;
+	memset(z->in, 0, BIOSCOMP_TOKEN);
+
+	z->out_pos = 0;
+	z->flags = z->nflags = 0;
+	z->left = z->dist = 0;
+	z->wpos = 0;
+	z->raw = false;
+	z->hword = z->hbits = 0;
+	z->hacc = z->hnacc = 0;
+
+	/* some encoders reach back before the start, expecting zeros */
+	memset(z->window, 0, BIOSCOMP_WINDOW);
+}
+
+off_t bioscomp_read(bioscomp_t *z, void *out, off_t size)
+{
+	u8 *dst = out;
+	off_t done = 0;
+
+	if (size > (z->out_size - z->out_pos))
+		size = z->out_size - z->out_pos;
+
+	while(done < size) {
+		u8 *d = dst ? &dst[done] : NULL;
+		size_t want = size - done, r;
+
+		switch(z->type) {
+			case BIOSCOMP_LZ10:
+			case BIOSCOMP_LZ11:
+				if (!z->in_eof && (z->in_len - z->in_idx) < BIOSCOMP_TOKEN)
+					_bioscomp_fill(z);
+
+				if (z->type == BIOSCOMP_LZ10) r = _bioscomp_lz10(z, d, want);
+				else r = _bioscomp_lz11(z, d, want);
+
+				/* ran into the padding, or nothing left to decode */
+				if (z->in_idx > z->in_len || (r == 0 && z->in_eof))
+					z->error = true;
+				break;
+
+			case BIOSCOMP_RLE:
+				r = _bioscomp_rle(z, d, want);
+				break;
+
+			default:
+				r = _bioscomp_huff(z, d, want);
+				break;
+		}
+
+		if (z->error) return -ERR_IO;
+		done += r;
+	}
+
+	z->out_pos += done;
+	return done;
+}
+
+static off_t _bioscomp_view_input(void *priv, void *buf, off_t size, off_t pos)
+{
+	bioscomp_view_t *v = priv;
+	vf_t raw = *v->file;
+
+	/* goes straight to the backing filesystem with a private position */
+	raw.mnt = v->base;
+	raw.pos = pos;
+	return ((const vfs_ops_t*)v->base->ops)->read(v->base, &raw, buf, size);
+}
+
+static int bioscomp_view_close(mount_t *mnt, vf_t *file)
+{
+	bioscomp_view_t *v = GET_PRIVDATA(mnt, bioscomp_view_t*);
+	const vfs_ops_t *ops = v->base->ops;
+	int res = 0;
+
+	file->mnt = v->base;
+	if (ops->close) res = ops->close(v->base, file);
+
+	bioscomp_free(&v->z);
+	mem_free(v);
+	return res;
+}
+
+static off_t bioscomp_view_read(mount_t *mnt, vf_t *file, void *buf, off_t size)
+{
+	bioscomp_view_t *v = GET_PRIVDATA(mnt, bioscomp_view_t*);
+	bioscomp_t *z = &v->z;
+	off_t res;
+
+	/* the window is small, going backwards just decodes everything again */
+	if (file->pos < z->out_pos) bioscomp_rewind(z);
+
+	if (file->pos > z->out_pos) {
+		res = bioscomp_read(z, NULL, file->pos - z->out_pos);
+		if (IS_ERR(res)) return res;
+		if (file->pos != z->out_pos) return 0;
+	}
+
+	return bioscomp_read(z, buf, size);
+}
+
+static off_t bioscomp_view_size(mount_t *mnt, vf_t *file)
+{
+	bioscomp_view_t *v = GET_PRIVDATA(mnt, bioscomp_view_t*);
+	return bioscomp_size(&v->z);
+}
+
+static const vfs_ops_t bioscomp_view_ops = {
+	.close = bioscomp_view_close,
+	.read = bioscomp_view_read,
+	.size = bioscomp_view_size,
+};
+
+int bioscomp_vfs_wrap(vf_t *file)
+{
+	const vfs_ops_t *ops = file->mnt->ops;
+	bioscomp_view_t *v;
+	off_t size;
+	int res;
+
+	if (ops->read == NULL || ops->size == NULL) return -ERR_UNSUPP;
+
+	size = ops->size(file->mnt, file);
+	if (IS_ERR(size)) return size;
+
+	v = mem_alloc(MEM_DECOMP, sizeof(*v));
+	if (v == NULL) return -ERR_MEM;
+
+	v->base = file->mnt;
+	v->file = file;
+	v->mnt.ops = &bioscomp_view_ops;
+	v->mnt.info = file->mnt->info;
+	v->mnt.caps = VFS_RO;
+	v->mnt.owner = v->base->owner;
+	SET_PRIVDATA(&v->mnt, v);
+
+	res = bioscomp_init(&v->z, _bioscomp_view_input, v, size);
+	if (IS_ERR(res)) {
+		mem_free(v);
+		return res;
+	}
+
+	file->mnt = &v->mnt;
+	return 0;
+}
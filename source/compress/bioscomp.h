@@ -0,0 +1,96 @@
+#ifndef BIOSCOMP_H__
+#define BIOSCOMP_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+#define BIOSCOMP_WINDOW	(4096)	/* LZ10/LZ11 maximum displacement */
+#define BIOSCOMP_INBUF	(2048)
+#define BIOSCOMP_TOKEN	(5)		/* most input a single LZ step can take */
+#define BIOSCOMP_TREE	(512)	/* largest Huffman tree, size byte included */
+
+/* header type bytes */
+enum {
+	BIOSCOMP_LZ10	= 0x10,
+	BIOSCOMP_LZ11	= 0x11,
+	BIOSCOMP_HUFF4	= 0x24,
+	BIOSCOMP_HUFF8	= 0x28,
+	BIOSCOMP_RLE	= 0x30,
+};
+
+/* fetches `size` bytes of compressed input starting at offset `pos` */
+typedef off_t (*bioscomp_read_fn)(void *priv, void *buf, off_t size, off_t pos);
+
+/*
+ * streaming decoder for the BIOS compression formats
+ * output is pulled on demand, nothing larger than the LZ window is buffered
+ */
+typedef struct {
+	bioscomp_read_fn read;
+	void *priv;
+
+	u8 *in;
+	u32 in_len, in_idx;
+	off_t in_pos, in_size;
+	bool in_eof, error;
+
+	int type;
+	off_t data;		/* offset of the first data byte after the header */
+	off_t out_pos, out_size;
+
+	/* LZ and RLE */
+	u32 flags, nflags;
+	u32 left, dist;
+	u32 wpos;
+	bool raw;
+
+	/* Huffman */
+	u32 hword, hbits;
+	u32 hacc, hnacc;
+	u32 tree_len;
+	u8 tree[BIOSCOMP_TREE];
+
+	u8 window[BIOSCOMP_WINDOW];
+} bioscomp_t;
+
+/*
+ * checks whether the first 4 bytes of a file with `in_size` bytes
+ * look like a supported header, returns the type or an error
+ */
+int bioscomp_type(const void *hdr, off_t in_size);
+
+/* short name of a compression type */
+const char *bioscomp_name(int type);
+
+/* reads the header (and Huffman tree) and prepares the decoder */
+int bioscomp_init(bioscomp_t *z, bioscomp_read_fn read, void *priv, off_t in_size);
+
+/* frees the input buffer */
+void bioscomp_free(bioscomp_t *z);
+
+/* restarts decoding from the beginning of the data */
+void bioscomp_rewind(bioscomp_t *z);
+
+/*
+ * decodes up to `size` bytes into `out`, or just skips them if `out` is NULL
+ * returns the amount of bytes produced, zero at the end of the data
+ */
+off_t bioscomp_read(bioscomp_t *z, void *out, off_t size);
+
+/* decompressed size from the header */
+static inline off_t bioscomp_size(const bioscomp_t *z) {
+	return z->out_size;
+}
+
+/*
+ * turns an open file into a read-only view of its decompressed contents
+ * a vfs_unpack_fn, compdata_register installs it for VFS_UNPACK
+ */
+int bioscomp_vfs_wrap(vf_t *file);
+
+/* LZ hot loops, these live in ITCM (bioscomp.itcm.c) */
+size_t _bioscomp_lz10(bioscomp_t *z, u8 *dst, size_t size);
+size_t _bioscomp_lz11(bioscomp_t *z, u8 *dst, size_t size);
+
+#endif /* BIOSCOMP_H__ */
@@ -0,0 +1,110 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "bioscomp.h"
+
+#define BIOSCOMP_WMASK	(BIOSCOMP_WINDOW - 1)
+
+/*
+ * shared LZ10/LZ11 loop, the state lives in registers while decoding
+ * tokens only start while a whole one is guaranteed to be buffered,
+ * once the input is exhausted the zero padding behind it is read instead
+ * and the caller notices the overrun through in_idx
+ */
+static inline __attribute__((always_inline))
+size_t _bioscomp_lz(bioscomp_t *z, u8 *dst, size_t size, const bool ext)
+{
+	const u8 *in = z->in;
+	u8 *win = z->window;
+	u32 idx = z->in_idx, stop;
+	u32 flags = z->flags, nflags = z->nflags;
+	u32 left = z->left, dist = z->dist, wpos = z->wpos;
+	size_t done = 0;
+
+	if (z->in_eof) stop = z->in_len;
+	else if (z->in_len >= BIOSCOMP_TOKEN) stop = z->in_len - BIOSCOMP_TOKEN + 1;
+	else stop = 0;
+
+	while(done < size) {
+		if (left) {
+			u32 src = (wpos - dist) & BIOSCOMP_WMASK;
+			u32 n = (left < (size - done)) ? left : (size - done);
+
+			left -= n;
+			if (dst) {
+				while(n--) {
+					u8 b = win[src];
+					src = (src + 1) & BIOSCOMP_WMASK;
+					win[wpos] = b;
+					wpos = (wpos + 1) & BIOSCOMP_WMASK;
+					dst[done++] = b;
+				}
+			} else {
+				while(n--) {
+					win[wpos] = win[src];
+					src = (src + 1) & BIOSCOMP_WMASK;
+					wpos = (wpos + 1) & BIOSCOMP_WMASK;
+					done++;
+				}
+			}
+			continue;
+		}
+
+		if (idx >= stop) break;
+
+		if (nflags == 0) {
+			flags = in[idx++];
+			nflags = 8;
+		}
+
+		if (flags & 0x80) {
+			u32 b0 = in[idx++], b1 = in[idx++];
+
+			if (!ext) {
+				left = (b0 >> 4) + 3;
+				dist = (((b0 & 0xF) << 8) | b1) + 1;
+			} else if ((b0 >> 4) == 0) {
+				u32 b2 = in[idx++];
+				left = (((b0 & 0xF) << 4) | (b1 >> 4)) + 0x11;
+				dist = (((b1 & 0xF) << 8) | b2) + 1;
+			} else if ((b0 >> 4) == 1) {
+				u32 b2 = in[idx++], b3 = in[idx++];
+				left = (((b0 & 0xF) << 12) | (b1 << 4) | (b2 >> 4)) + 0x111;
+				dist = (((b2 & 0xF) << 8) | b3) + 1;
+			} else {
+				left = (b0 >> 4) + 1;
+				dist = (((b0 & 0xF) << 8) | b1) + 1;
+			}
+		} else {
+			u8 b = in[idx++];
+
+			win[wpos] = b;
+			wpos = (wpos + 1) & BIOSCOMP_WMASK;
+			if (dst) dst[done] = b;
+			done++;
+		}
+
+		flags <<= 1;
+		nflags--;
+	}
+
+	z->in_idx = idx;
+	z->flags = flags;
+	z->nflags = nflags;
+	z->left = left;
+	z->dist = dist;
+	z->wpos = wpos;
+	return done;
+}
+
+size_t _bioscomp_lz10(bioscomp_t *z, u8 *dst, size_t size)
+{
+	return _bioscomp_lz(z, dst, size, false);
+}
+
+size_t _bioscomp_lz11(bioscomp_t *z, u8 *dst, size_t size)
+{
+	return _bioscomp_lz(z, dst, size, true);
+}
@@ -0,0 +1,445 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "inflate.h"
+
+#define INFLATE_WMASK	(INFLATE_WINDOW - 1)
+#define INFLATE_FMASK	((1 << INFLATE_FASTBITS) - 1)
+
+/* zero bytes handed out past the end of the input before giving up */
+#define INFLATE_SLACK	(4)
+
+enum {
+	INFLATE_HEADER = 0,
+	INFLATE_STORED,
+	INFLATE_CODES,
+	INFLATE_DONE,
+	INFLATE_ERROR,
+};
+
+static const u16 inflate_lbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const u8 inflate_lext[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const u16 inflate_dbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+static const u8 inflate_dext[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const u8 inflate_clorder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static u8 _inflate_byte(inflate_t *z)
+{
+	if (UNLIKELY(z->in_idx == z->in_len)) {
+		off_t n = z->in_size - z->in_pos;
+
+		if (n <= 0) {
+			/* lookahead may run a bit past the last symbol */
+			if (++z->overrun > INFLATE_SLACK) z->error = true;
+			return 0;
+		}
+
+		if (n > INFLATE_INBUF) n = INFLATE_INBUF;
+		if (z->read(z->priv, z->in, n, z->in_pos) != n) {
+			z->error = true;
+			return 0;
+		}
+
+		z->in_pos += n;
+		z->in_len = n;
+		z->in_idx = 0;
+	}
+
+	return z->in[z->in_idx++];
+}
+
+static inline void _inflate_need(inflate_t *z, u32 n)
+{
+	while(z->bitcnt < n) {
+		z->bitbuf |= (u32)_inflate_byte(z) << z->bitcnt;
+		z->bitcnt += 8;
+	}
+}
+
+static inline u32 _inflate_bits(inflate_t *z, u32 n)
+{
+	u32 v;
+
+	_inflate_need(z, n);
+	v = z->bitbuf & ((1 << n) - 1);
+	z->bitbuf >>= n;
+	z->bitcnt -= n;
+	return v;
+}
+
+/*
+ * builds the canonical decoding tables for `n` code lengths
+ * codes that fit INFLATE_FASTBITS are resolved with a single lookup,
+ * longer ones go through the count/symbol tables one bit at a time
+ */
+static int _inflate_build(inflate_huff_t *h, const u8 *lens, int n)
+{
+	u16 offs[16], next[16];
+	int left = 1;
+	u32 code = 0;
+
+	memset(h->count, 0, sizeof(h->count));
+	for (int i = 0; i < n; i++)
+		h->count[lens[i]]++;
+	h->count[0] = 0;
+
+	for (int len = 1; len < 16; len++) {
+		left = (left << 1) - h->count[len];
+		if (left < 0) return -ERR_ARG;
+	}
+
+	offs[1] = 0;
+	for (int len = 1; len < 15; len++)
+		offs[len + 1] = offs[len] + h->count[len];
+
+	for (int len = 1; len < 16; len++) {
+		code = (code + h->count[len - 1]) << 1;
+		next[len] = code;
+	}
+
+	memset(h->fast, 0, sizeof(h->fast));
+	for (int i = 0; i < n; i++) {
+		u32 len = lens[i], rev = 0, c;
+
+		if (len == 0) continue;
+		h->symbol[offs[len]++] = i;
+
+		c = next[len]++;
+		if (len > INFLATE_FASTBITS) continue;
+
+		/* codes are stored MSB first in an LSB first stream */
+		for (u32 b = 0; b < len; b++)
+			rev |= ((c >> b) & 1) << (len - 1 - b);
+
+		for (u32 j = rev; j <= INFLATE_FMASK; j += (1 << len))
+			h->fast[j] = (len << 9) | i;
+	}
+
+	return 0;
+}
+
+static int _inflate_decode(inflate_t *z, const inflate_huff_t *h)
+{
+	int code = 0, first = 0, index = 0;
+	u32 e, bits;
+
+	_inflate_need(z, 15);
+
+	e = h->fast[z->bitbuf & INFLATE_FMASK];
+	if (LIKELY(e)) {
+		z->bitbuf >>= e >> 9;
+		z->bitcnt -= e >> 9;
+		return e & 0x1FF;
+	}
+
+	bits = z->bitbuf;
+	for (int len = 1; len < 16; len++) {
+		int count = h->count[len];
+
+		code |= bits & 1;
+		bits >>= 1;
+		if ((code - count) < first) {
+			z->bitbuf >>= len;
+			z->bitcnt -= len;
+			return h->symbol[index + (code - first)];
+		}
+
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+
+	return -ERR_IO;
+}
+
+static int _inflate_fixed(inflate_t *z)
+{
+	u8 lens[288];
+	int i;
+
+	for (i = 0; i < 144; i++) lens[i] = 8;
+	for (; i < 256; i++) lens[i] = 9;
+	for (; i < 280; i++) lens[i] = 7;
+	for (; i < 288; i++) lens[i] = 8;
+	_inflate_build(&z->lit, lens, 288);
+
+	for (i = 0; i < 30; i++) lens[i] = 5;
+	return _inflate_build(&z->dst, lens, 30);
+}
+
+static int _inflate_dynamic(inflate_t *z)
+{
+	u8 lens[286 + 30];
+	int nlen, ndist, ncode, idx = 0;
+
+	nlen = _inflate_bits(z, 5) + 257;
+	ndist = _inflate_bits(z, 5) + 1;
+	ncode = _inflate_bits(z, 4) + 4;
+	if (nlen > 286 || ndist > 30) return -ERR_IO;
+
+	memset(lens, 0, 19);
+	for (int i = 0; i < ncode; i++)
+		lens[inflate_clorder[i]] = _inflate_bits(z, 3);
+
+	/* the literal table doubles as the code length table for now */
+	if (IS_ERR(_inflate_build(&z->lit, lens, 19))) return -ERR_IO;
+
+	while(idx < (nlen + ndist)) {
+		int sym = _inflate_decode(z, &z->lit), rep;
+		u8 len = 0;
+
+		if (IS_ERR(sym)) return sym;
+		if (sym < 16) {
+			lens[idx++] = sym;
+			continue;
+		}
+
+		if (sym == 16) {
+			if (idx == 0) return -ERR_IO;
+			len = lens[idx - 1];
+			rep = 3 + _inflate_bits(z, 2);
+		} else if (sym == 17) {
+			rep = 3 + _inflate_bits(z, 3);
+		} else {
+			rep = 11 + _inflate_bits(z, 7);
+		}
+
+		if ((idx + rep) > (nlen + ndist)) return -ERR_IO;
+		while(rep--) lens[idx++] = len;
+	}
+
+	if (lens[256] == 0) return -ERR_IO;
+	if (IS_ERR(_inflate_build(&z->lit, lens, nlen))) return -ERR_IO;
+	return _inflate_build(&z->dst, &lens[nlen], ndist);
+}
+
+static int _inflate_header(inflate_t *z)
+{
+	int type, res = 0;
+
+	z->final = _inflate_bits(z, 1);
+	type = _inflate_bits(z, 2);
+
+	switch(type) {
+		case 0:
+		{
+			u32 len, nlen;
+
+			/* stored blocks start on a byte boundary */
+			_inflate_bits(z, z->bitcnt & 7);
+			len = _inflate_bits(z, 16);
+			nlen = _inflate_bits(z, 16);
+			if (len != (~nlen & 0xFFFF)) return -ERR_IO;
+
+			z->left = len;
+			z->state = INFLATE_STORED;
+			break;
+		}
+
+		case 1:
+			res = _inflate_fixed(z);
+			z->state = INFLATE_CODES;
+			break;
+
+		case 2:
+			res = _inflate_dynamic(z);
+			z->state = INFLATE_CODES;
+			break;
+
+		default:
+			return -ERR_IO;
+	}
+
+	return res;
+}
+
+int inflate_init(inflate_t *z, inflate_read_fn read, void *priv, off_t in_size)
+{
+	z->in = mem_alloc(MEM_DECOMP, INFLATE_INBUF);
+	if (z->in == NULL) return -ERR_MEM;
+
+	z->read = read;
+	z->priv = priv;
+	z->in_len = z->in_idx = 0;
+	z->in_pos = 0;
+	z->in_size = in_size;
+	z->overrun = 0;
+	z->error = false;
+
+	z->bitbuf = z->bitcnt = 0;
+	z->state = INFLATE_HEADER;
+	z->final = 0;
+	z->left = z->dist = 0;
+	z->out_pos = 0;
+	z->mark = -1;
+	z->wpos = 0;
+	return 0;
+}
+
+void inflate_free(inflate_t *z)
+{
+	mem_free(z->in);
+	z->in = NULL;
+}
+
+off_t inflate_read(inflate_t *z, void *out, off_t size)
+{
+	u8 *dst = out;
+	off_t done = 0;
+
+	while(done < size) {
+		/* input errors are only noticed once the symbol is done */
+		if (UNLIKELY(z->error)) z->state = INFLATE_ERROR;
+
+		switch(z->state) {
+			case INFLATE_HEADER:
+				/* the caller wants to checkpoint here, once */
+				if (UNLIKELY(z->mark >= 0 && (z->out_pos + done) >= z->mark)) {
+					z->mark = -1;
+					z->out_pos += done;
+					return done;
+				}
+
+				if (IS_ERR(_inflate_header(z))) z->state = INFLATE_ERROR;
+				break;
+
+			case INFLATE_STORED:
+				if (z->left == 0) {
+					z->state = z->final ? INFLATE_DONE : INFLATE_HEADER;
+					break;
+				}
+
+				while(z->left && done < size) {
+					u8 b = _inflate_bits(z, 8);
+
+					z->window[z->wpos] = b;
+					z->wpos = (z->wpos + 1) & INFLATE_WMASK;
+					if (dst) dst[done] = b;
+					done++;
+					z->left--;
+				}
+				break;
+
+			case INFLATE_CODES:
+			{
+				int sym;
+
+				/* finish any match that didn't fit the previous request */
+				if (z->left) {
+					u32 src = (z->wpos - z->dist) & INFLATE_WMASK;
+
+					while(z->left && done < size) {
+						u8 b = z->window[src];
+
+						src = (src + 1) & INFLATE_WMASK;
+						z->window[z->wpos] = b;
+						z->wpos = (z->wpos + 1) & INFLATE_WMASK;
+						if (dst) dst[done] = b;
+						done++;
+						z->left--;
+					}
+					break;
+				}
+
+				sym = _inflate_decode(z, &z->lit);
+				if (sym < 256) {
+					if (IS_ERR(sym)) {
+						z->state = INFLATE_ERROR;
+						break;
+					}
+
+					z->window[z->wpos] = sym;
+					z->wpos = (z->wpos + 1) & INFLATE_WMASK;
+					if (dst) dst[done] = sym;
+					done++;
+				} else if (sym == 256) {
+					z->state = z->final ? INFLATE_DONE : INFLATE_HEADER;
+				} else {
+					off_t avail;
+
+					sym -= 257;
+					if (sym >= 29) {
+						z->state = INFLATE_ERROR;
+						break;
+					}
+					z->left = inflate_lbase[sym] + _inflate_bits(z, inflate_lext[sym]);
+
+					sym = _inflate_decode(z, &z->dst);
+					if (IS_ERR(sym) || sym >= 30) {
+						z->state = INFLATE_ERROR;
+						break;
+					}
+					z->dist = inflate_dbase[sym] + _inflate_bits(z, inflate_dext[sym]);
+
+					avail = z->out_pos + done;
+					if (z->dist > avail) z->state = INFLATE_ERROR;
+				}
+				break;
+			}
+
+			case INFLATE_DONE:
+				z->out_pos += done;
+				return done;
+
+			default:
+				return -ERR_IO;
+		}
+	}
+
+	z->out_pos += done;
+	return done;
+}
+
+int inflate_save(const inflate_t *z, inflate_ckpt_t *ckpt)
+{
+	if (z->state != INFLATE_HEADER || z->error) return -ERR_BUSY;
+
+	/* the input buffer isn't part of the state, just where to resume it */
+	ckpt->in_pos = z->in_pos - (z->in_len - z->in_idx);
+	ckpt->out_pos = z->out_pos;
+	ckpt->bitbuf = z->bitbuf;
+	ckpt->bitcnt = z->bitcnt;
+	ckpt->overrun = z->overrun;
+	ckpt->wpos = z->wpos;
+	memcpy(ckpt->window, z->window, INFLATE_WINDOW);
+	return 0;
+}
+
+void inflate_restore(inflate_t *z, const inflate_ckpt_t *ckpt)
+{
+	z->in_len = z->in_idx = 0;
+	z->in_pos = ckpt->in_pos;
+	z->overrun = ckpt->overrun;
+	z->error = false;
+
+	z->bitbuf = ckpt->bitbuf;
+	z->bitcnt = ckpt->bitcnt;
+	z->state = INFLATE_HEADER;
+	z->final = 0;
+	z->left = z->dist = 0;
+	z->out_pos = ckpt->out_pos;
+	z->wpos = ckpt->wpos;
+	memcpy(z->window, ckpt->window, INFLATE_WINDOW);
+}
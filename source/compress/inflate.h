@@ -0,0 +1,88 @@
+#ifndef INFLATE_H__
+#define INFLATE_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+#define INFLATE_WINDOW		(32768)	/* maximum deflate match distance */
+#define INFLATE_INBUF		(4096)
+#define INFLATE_FASTBITS	(9)		/* codes up to this length take one lookup */
+
+/* fetches `size` bytes of compressed input starting at stream offset `pos` */
+typedef off_t (*inflate_read_fn)(void *priv, void *buf, off_t size, off_t pos);
+
+typedef struct {
+	u16 count[16];
+	u16 symbol[288];
+	u16 fast[1 << INFLATE_FASTBITS];
+} inflate_huff_t;
+
+/* raw deflate stream decoder, output is pulled on demand */
+typedef struct {
+	inflate_read_fn read;
+	void *priv;
+
+	u8 *in;
+	u32 in_len, in_idx;
+	off_t in_pos, in_size;
+	u32 overrun;
+	bool error;
+
+	u32 bitbuf, bitcnt;
+
+	int state, final;
+	u32 left, dist;
+
+	off_t out_pos, mark;
+	u32 wpos;
+
+	inflate_huff_t lit, dst;
+	u8 window[INFLATE_WINDOW];
+} inflate_t;
+
+/*
+ * decoder position between two blocks, where no code tables are live
+ * so the window and the bit reader are all there is to keep
+ */
+typedef struct {
+	off_t in_pos, out_pos;
+	u32 bitbuf, bitcnt;
+	u32 overrun;
+	u32 wpos;
+	u8 window[INFLATE_WINDOW];
+} inflate_ckpt_t;
+
+/* prepares a decoder for `in_size` bytes of raw deflate data */
+int inflate_init(inflate_t *z, inflate_read_fn read, void *priv, off_t in_size);
+
+/* frees the input buffer */
+void inflate_free(inflate_t *z);
+
+/*
+ * decodes up to `size` bytes into `out`, or just skips them if `out` is NULL
+ * returns the amount of bytes produced, zero at the end of the stream
+ */
+off_t inflate_read(inflate_t *z, void *out, off_t size);
+
+/*
+ * makes inflate_read return at the first block boundary once `pos` bytes
+ * have been produced, possibly with nothing decoded, negative for never
+ */
+static inline void inflate_mark(inflate_t *z, off_t pos) {
+	z->mark = pos;
+}
+
+/*
+ * stores the decoder position in `ckpt`, resumable with inflate_restore
+ * only works between blocks, -ERR_BUSY anywhere else
+ */
+int inflate_save(const inflate_t *z, inflate_ckpt_t *ckpt);
+void inflate_restore(inflate_t *z, const inflate_ckpt_t *ckpt);
+
+/* amount of bytes decoded so far */
+static inline off_t inflate_tell(const inflate_t *z) {
+	return z->out_pos;
+}
+
+#endif /* INFLATE_H__ */
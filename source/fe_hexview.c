@@ -0,0 +1,392 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "ui.h"
+#include "vfs.h"
+
+#include "vfs_glue.h"
+#include "xfer.h"
+
+#include "fe_hexview.h"
+
+#define HEXV_SCREEN		(HEXV_ROWS * HEXV_COLS)
+#define HEXV_JUMP		(SIZE_KIB(64))
+
+#define HEXV_REPEAT_DELAY	(15)
+#define HEXV_REPEAT_RATE	(3)
+
+/* sub screen layout, the ASCII column is on the left of the info panel */
+#define HEXV_INFO_X		(HEXV_COLS + 2)
+#define HEXV_INFO_W		(TFB_WIDTH - HEXV_INFO_X)
+
+#define HEXV_OFFSET_PAL	(TILE_PALETTE(COL_YELLOW))
+
+typedef struct {
+	off_t page;		/* page index, -1 if the slot is empty */
+	int len;		/* valid bytes, negative if the read failed */
+	u8 data[HEXV_PAGE_SIZE];
+} hexv_page_t;
+
+typedef struct {
+	int fd;
+	off_t size, top, maxtop;
+	int dir;		/* last scroll direction, for prefetching */
+	int digits;		/* offset width in hex digits */
+	u32 reads;
+
+	/* the whole file, when the backend can map it, the ring goes unused */
+	const u8 *map;
+
+	vu16 *hmap, *amap;
+	off_t drawn[HEXV_ROWS];	/* offset shown on each row, -1 if stale */
+
+	/* direct mapped by page index, neighbouring pages never evict each other */
+	hexv_page_t ring[HEXV_PAGES];
+} hexv_t;
+
+static const char hexv_hex[16] = "0123456789ABCDEF";
+
+static void _hexv_hexstr(char *out, off_t val, int digits)
+{
+	out[digits] = '\0';
+	while(digits--) {
+		out[digits] = hexv_hex[val & 0xF];
+		val >>= 4;
+	}
+}
+
+static inline bool _hexv_cached(hexv_t *hv, off_t page)
+{
+	return hv->ring[page & (HEXV_PAGES - 1)].page == page;
+}
+
+/* returns the slot holding `page`, reading it in if it's not there */
+static hexv_page_t *_hexv_page(hexv_t *hv, off_t page)
+{
+	hexv_page_t *p = &hv->ring[page & (HEXV_PAGES - 1)];
+	off_t pos, len, res;
+
+	if (LIKELY(p->page == page)) return p;
+
+	pos = page << HEXV_PAGE_SHIFT;
+	len = hv->size - pos;
+	if (len > HEXV_PAGE_SIZE) len = HEXV_PAGE_SIZE;
+
+	res = vfs_pread(hv->fd, p->data, len, pos);
+	p->page = page;
+	p->len = (res == len) ? (int)len : -1;
+	hv->reads++;
+	return p;
+}
+
+/*
+ * reads the next page in the scroll direction that isn't cached yet
+ * at most one page per call, so a key press is never kept waiting long
+ */
+static void _hexv_prefetch(hexv_t *hv)
+{
+	off_t first, last, maxpage;
+
+	if (hv->size == 0 || hv->map) return;
+
+	maxpage = (hv->size - 1) >> HEXV_PAGE_SHIFT;
+	first = hv->top >> HEXV_PAGE_SHIFT;
+	last = (hv->top + HEXV_SCREEN - 1) >> HEXV_PAGE_SHIFT;
+
+	for (int i = 1; i <= HEXV_AHEAD; i++) {
+		off_t page = (hv->dir >= 0) ? (last + i) : (first - i);
+
+		if (page < 0 || page > maxpage) return;
+		if (!_hexv_cached(hv, page)) {
+			_hexv_page(hv, page);
+			return;
+		}
+	}
+}
+
+static void _hexv_drawrow(hexv_t *hv, int row, off_t off)
+{
+	vu16 *h = &hv->hmap[(row + 1) * TFB_WIDTH];
+	vu16 *a = &hv->amap[(row + 1) * TFB_WIDTH];
+	const u8 *data = NULL;
+	char ostr[17];
+	int n = 0;
+
+	if (off < hv->size && hv->map) {
+		n = (hv->size - off < HEXV_COLS) ? (int)(hv->size - off) : HEXV_COLS;
+		data = &hv->map[off];
+	} else if (off < hv->size) {
+		/* rows are aligned, they never straddle two pages */
+		hexv_page_t *p = _hexv_page(hv, off >> HEXV_PAGE_SHIFT);
+
+		n = (hv->size - off < HEXV_COLS) ? (int)(hv->size - off) : HEXV_COLS;
+		if (p->len >= 0) data = &p->data[off & (HEXV_PAGE_SIZE - 1)];
+	}
+
+	if (n == 0) {
+		for (int i = 0; i < TFB_WIDTH; i++) h[i] = ' ';
+		for (int i = 0; i < HEXV_COLS; i++) a[i] = ' ';
+		ui_mark(hv->hmap, row + 1, 1);
+		ui_mark(hv->amap, row + 1, 1);
+		return;
+	}
+
+	/* the low bits are enough to tell rows apart, the panel has the rest */
+	_hexv_hexstr(ostr, off, 8);
+	for (int i = 0; i < 8; i++) h[i] = ostr[i] | HEXV_OFFSET_PAL;
+	h += 8;
+
+	for (int i = 0; i < HEXV_COLS; i++) {
+		u16 hi = ' ', lo = ' ', c = ' ';
+
+		if (i < n && data) {
+			u8 b = data[i];
+			hi = hexv_hex[b >> 4];
+			lo = hexv_hex[b & 0xF];
+			c = (b >= 0x20 && b < 0x7F) ? b : '.';
+		} else if (i < n) {
+			hi = lo = c = '?';
+		}
+
+		h[i * 3] = ' ';
+		h[i * 3 + 1] = hi;
+		h[i * 3 + 2] = lo;
+		a[i] = c;
+	}
+
+	ui_mark(hv->hmap, row + 1, 1);
+	ui_mark(hv->amap, row + 1, 1);
+}
+
+static void _hexv_copyrow(hexv_t *hv, int dst, int src)
+{
+	xfer_copy((void*)&hv->hmap[(dst + 1) * TFB_WIDTH],
+		(const void*)&hv->hmap[(src + 1) * TFB_WIDTH], TFB_WIDTH * sizeof(u16));
+	xfer_copy((void*)&hv->amap[(dst + 1) * TFB_WIDTH],
+		(const void*)&hv->amap[(src + 1) * TFB_WIDTH], HEXV_COLS * sizeof(u16));
+	ui_mark(hv->hmap, dst + 1, 1);
+	ui_mark(hv->amap, dst + 1, 1);
+	hv->drawn[dst] = hv->drawn[src];
+}
+
+/*
+ * brings the maps up to date with `top`
+ * rows that are still on screen get moved instead of redrawn,
+ * so scrolling by a row only formats the one that came in
+ */
+static void _hexv_draw(hexv_t *hv, off_t top)
+{
+	off_t d = (top - hv->top) / HEXV_COLS;
+
+	if (d > 0 && d < HEXV_ROWS) {
+		for (int i = 0; i < HEXV_ROWS - d; i++)
+			_hexv_copyrow(hv, i, i + d);
+	} else if (d < 0 && -d < HEXV_ROWS) {
+		for (int i = HEXV_ROWS - 1; i >= -d; i--)
+			_hexv_copyrow(hv, i, i + d);
+	}
+
+	if (top != hv->top) hv->dir = (top > hv->top) ? 1 : -1;
+	hv->top = top;
+
+	for (int i = 0; i < HEXV_ROWS; i++) {
+		off_t off = top + i * HEXV_COLS;
+		if (hv->drawn[i] == off) continue;
+
+		_hexv_drawrow(hv, i, off);
+		hv->drawn[i] = off;
+	}
+}
+
+static void _hexv_drawinfo(hexv_t *hv)
+{
+	char str[17];
+
+	_hexv_hexstr(str, hv->top, hv->digits);
+	ui_drawstrf(hv->amap, HEXV_INFO_X, 4, "Top   %s", str);
+	ui_drawstrf(hv->amap, HEXV_INFO_X, 5, "Reads %lu", (unsigned long)hv->reads);
+}
+
+/*
+ * lets the user pick an offset one hex digit at a time
+ * returns true and sets `dest` if it was confirmed
+ */
+static bool _hexv_goto(hexv_t *hv, off_t *dest)
+{
+	off_t val = hv->top;
+	int cur = 0, keys;
+
+	while(1) {
+		char str[64], *s = str;
+
+		s += sprintf(s, "Go to ");
+		for (int i = hv->digits - 1; i >= 0; i--) {
+			char c = hexv_hex[(val >> (i * 4)) & 0xF];
+			if (i == cur) s += sprintf(s, UI_RED "%c" UI_WHITE, c);
+			else *(s++) = c;
+		}
+		*s = '\0';
+		ui_drawstr(hv->amap, HEXV_INFO_X, 7, str);
+
+		swiWaitForVBlank();
+		scanKeys();
+		keys = keysDownRepeat();
+
+		if (keys & KEY_A) {
+			*dest = val;
+			break;
+		}
+		if (keys & KEY_B) break;
+
+		if (keys & (KEY_UP | KEY_DOWN)) {
+			off_t nib = (val >> (cur * 4)) & 0xF;
+			nib = (nib + ((keys & KEY_UP) ? 1 : 15)) & 0xF;
+			val = (val & ~((off_t)0xF << (cur * 4))) | (nib << (cur * 4));
+		}
+		if (keys & KEY_LEFT) cur = CLAMP(cur + 1, 0, hv->digits - 1);
+		if (keys & KEY_RIGHT) cur = CLAMP(cur - 1, 0, hv->digits - 1);
+	}
+
+	for (int i = 0; i < HEXV_INFO_W; i++)
+		ui_drawc(hv->amap, ' ', HEXV_INFO_X + i, 7);
+	return (keys & KEY_A) != 0;
+}
+
+static void _hexv_static(hexv_t *hv, const char *path)
+{
+	const char *name = strrchr(path, '/');
+	char sizestr[16], str[HEXV_INFO_W + 1];
+
+	ui_tilemap_set(hv->hmap, ' ');
+	ui_tilemap_set(hv->amap, ' ');
+
+	ui_drawstr(hv->hmap, 0, 0, UI_YELLOW "Offset  " UI_WHITE " 00 01 02 03 04 05 06 07");
+	ui_drawstr(hv->amap, 0, 0, UI_YELLOW "ASCII");
+
+	name = (name && name[1]) ? (name + 1) : path;
+	snprintf(str, sizeof(str), "%s", name);
+	ui_drawstr(hv->amap, HEXV_INFO_X, 1, str);
+
+	size_format(sizestr, hv->size);
+	ui_drawstrf(hv->amap, HEXV_INFO_X, 3, "Size  %s", sizestr);
+
+	ui_drawstr(hv->amap, HEXV_INFO_X, 17,
+		"Up/Down  row\n"
+		"Lt/Rt    screen\n"
+		"L/R      64 KiB\n"
+		"Y        go to\n"
+		"B        exit");
+}
+
+int fe_hexview(const char *path, off_t pos)
+{
+	const void *map;
+	hexv_t *hv;
+	off_t mlen;
+	int fd;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	hv = mem_alloc(MEM_FE, sizeof(*hv));
+	if (hv == NULL) {
+		vfs_close(fd);
+		return -ERR_MEM;
+	}
+
+	hv->fd = fd;
+	hv->size = vfs_size(fd);
+	if (IS_ERR(hv->size)) {
+		int res = hv->size;
+		mem_free(hv);
+		vfs_close(fd);
+		return res;
+	}
+
+	hv->top = 0;
+	hv->maxtop = (hv->size + HEXV_COLS - 1) / HEXV_COLS - HEXV_ROWS;
+	hv->maxtop = (hv->maxtop > 0) ? (hv->maxtop * HEXV_COLS) : 0;
+	hv->dir = 1;
+	hv->reads = 0;
+
+	hv->map = NULL;
+	if (!IS_ERR(vfs_map(fd, 0, &map, &mlen))) {
+		if (mlen >= hv->size) hv->map = map;
+		else vfs_unmap(fd, map);
+	}
+
+	hv->digits = 8;
+	while(hv->digits < 16 && ((hv->size - 1) >> (hv->digits * 4)) > 0)
+		hv->digits++;
+
+	for (int i = 0; i < HEXV_ROWS; i++) hv->drawn[i] = -1;
+	for (int i = 0; i < HEXV_PAGES; i++) hv->ring[i].page = -1;
+
+	hv->hmap = ui_map(MAINSCR, BG_MAIN);
+	hv->amap = ui_map(SUBSCR, BG_INFO);
+
+	pos = CLAMP(pos, 0, hv->maxtop);
+	pos -= pos % HEXV_COLS;
+
+	swiWaitForVBlank();
+	_hexv_static(hv, path);
+	_hexv_draw(hv, pos);
+	_hexv_drawinfo(hv);
+
+	/* let go of the button that opened the viewer first */
+	do {
+		swiWaitForVBlank();
+		scanKeys();
+	} while(keysHeld() & KEY_ANY);
+
+	keysSetRepeat(HEXV_REPEAT_DELAY, HEXV_REPEAT_RATE);
+	while(1) {
+		off_t top = hv->top, dest;
+		int keys;
+
+		swiWaitForVBlank();
+		scanKeys();
+		keys = keysDownRepeat();
+
+		if (keys == 0) {
+			/* idle frame, read ahead so the next steps hit the ring */
+			_hexv_prefetch(hv);
+			continue;
+		}
+
+		if (keys & KEY_B) break;
+
+		if (keys & KEY_UP) top -= HEXV_COLS;
+		if (keys & KEY_DOWN) top += HEXV_COLS;
+		if (keys & KEY_LEFT) top -= HEXV_SCREEN;
+		if (keys & KEY_RIGHT) top += HEXV_SCREEN;
+		if (keys & KEY_L) top -= HEXV_JUMP;
+		if (keys & KEY_R) top += HEXV_JUMP;
+
+		if ((keys & KEY_Y) && _hexv_goto(hv, &dest)) {
+			/* lands on the row holding the offset, only its pages get read */
+			top = CLAMP(dest, 0, hv->size ? hv->size - 1 : 0);
+			top -= top % HEXV_COLS;
+		}
+
+		top = CLAMP(top, 0, hv->maxtop);
+		if (top != hv->top) {
+			_hexv_draw(hv, top);
+			_hexv_drawinfo(hv);
+		}
+	}
+
+	ui_tilemap_clr(hv->hmap);
+	ui_tilemap_clr(hv->amap);
+
+	if (hv->map) vfs_unmap(fd, hv->map);
+	vfs_close(fd);
+	mem_free(hv);
+	return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef FE_HEXVIEW_H__
+#define FE_HEXVIEW_H__
+
+#include <nds.h>
+
+#include "ui.h"
+#include "vfs.h"
+
+#define HEXV_PAGE_SHIFT	(12)
+#define HEXV_PAGE_SIZE	(BIT(HEXV_PAGE_SHIFT))
+#define HEXV_PAGES		(8)		/* page ring size, must be a power of two */
+#define HEXV_AHEAD		(2)		/* pages prefetched in the scroll direction */
+
+#define HEXV_COLS		(8)		/* bytes per row */
+#define HEXV_ROWS		(TFB_HEIGHT - 1)
+
+/*
+ * browses the file at `path` as hex (main screen) and ASCII (sub screen)
+ * only a small ring of pages is kept in memory, so file size doesn't matter
+ * starts with the row holding `pos` on top, or as close as it gets
+ */
+int fe_hexview(const char *path, off_t pos);
+
+#endif /* FE_HEXVIEW_H__ */
@@ -7,6 +7,12 @@
 #include "ui.h"
 #include "vfs.h"
 
+#include "fident.h"
+#include "hash.h"
+#include "srl.h"
+#include "fe_hexview.h"
+#include "fe_search.h"
+
 #include "bp.h"
 #include "pstor.h"
 #include "vfs_glue.h"
@@ -59,9 +65,42 @@ static inline bool path_is_dir(char *p, size_t l) {
 #define FE_PSTORM_Y		(2)
 #define FE_PSTORM_YSZ	(TFB_HEIGHT - 2)
 
-static int fe_filemenu(vu16 *map, int *keys, pstor_t *ps, bp_t *cb)
+#define FE_PREVIEW_SCR	(SUBSCR)
+#define FE_PREVIEW_BG	(BG_INFO)
+
+/*
+ * shows extra information about the selected entry on the other screen
+ * only the selected entry is ever looked at, so scrolling stays cheap
+ */
+static void fe_preview(const char *cwd, pstor_t *ps, int sel)
 {
-	int res, sel = 0, base = 0, count = pstor_count(ps);
+	static const char *const rom_exts[] = {"nds", "srl", "dsi"};
+	vu16 *map = ui_map(FE_PREVIEW_SCR, FE_PREVIEW_BG);
+	char path[MAX_PATH + 1];
+	const char *ext;
+	size_t cwdlen;
+
+	ui_tilemap_clr(map);
+	if (sel == 0) return;
+
+	cwdlen = strlen(cwd);
+	strcpy(path, cwd);
+	pstor_get(ps, &path[cwdlen], MAX_PATH - cwdlen, sel);
+
+	ext = path_extension(path);
+	if (ext == NULL) return;
+
+	for (size_t i = 0; i < ARRAY_SIZE(rom_exts); i++) {
+		if (!strcasecmp(ext, rom_exts[i])) {
+			srl_preview(path, map, FE_PREVIEW_SCR, 1, 1);
+			break;
+		}
+	}
+}
+
+static int fe_filemenu(vu16 *map, int *keys, const char *cwd, pstor_t *ps, bp_t *cb)
+{
+	int res, sel = 0, base = 0, psel = -1, count = pstor_count(ps);
 	bool redraw_menu;
 
 	if (count == 0) {
@@ -96,8 +135,15 @@ static int fe_filemenu(vu16 *map, int *keys, pstor_t *ps, bp_t *cb)
 			ui_drawc(map, bp_tst(cb, i) ? '^' : ' ', 1, yc);
 		}
 
-		*keys = ui_waitkey(KEY_UP|KEY_DOWN|KEY_LEFT|KEY_RIGHT|KEY_A|KEY_B|KEY_Y|KEY_R);
+		if (sel != psel) {
+			fe_preview(cwd, ps, sel);
+			psel = sel;
+		}
+
+		*keys = ui_waitkey(KEY_UP|KEY_DOWN|KEY_LEFT|KEY_RIGHT|KEY_A|KEY_B|KEY_X|KEY_Y|KEY_R|KEY_SELECT);
 		PROCESS_KEYS(*keys) {
+			case KEY_SELECT:
+			case KEY_X:
 			case KEY_Y:
 			case KEY_A:
 				PROCESS_KEYS_STOP;
@@ -152,6 +198,180 @@ static int fe_filemenu(vu16 *map, int *keys, pstor_t *ps, bp_t *cb)
 	return sel;
 }
 
+/* copies every path in the clipboard into `dir` */
+static void fe_paste(pstor_t *clippaths, const char *dir)
+{
+	size_t count = pstor_count(clippaths);
+
+	for (size_t i = 0; i < count; i++) {
+		char cpath[MAX_PATH + 1];
+		int res;
+
+		pstor_get(clippaths, cpath, MAX_PATH, i);
+		ui_progress(i, count, "items", "Copying...");
+
+		res = tree_copy(cpath, dir);
+		if (IS_ERR(res)) {
+			ui_progress(1, 0, NULL, NULL);
+			ui_msgf("Failed to copy\n\"%s\"\n%s", cpath, err_getstr(res));
+			return;
+		}
+	}
+
+	ui_progress(1, 0, NULL, NULL);
+}
+
+/* deletes every path in the clipboard after confirmation */
+static void fe_delete(pstor_t *clippaths)
+{
+	size_t count = pstor_count(clippaths), files = 0, dirs = 0;
+	char sizestr[16];
+	off_t total = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		char cpath[MAX_PATH + 1];
+		size_t f, d;
+		off_t sz;
+
+		pstor_get(clippaths, cpath, MAX_PATH, i);
+		sz = tree_size(cpath, &f, &d);
+		if (IS_ERR(sz)) continue;
+
+		total += sz;
+		files += f;
+		dirs += d;
+	}
+
+	size_format(sizestr, total);
+	if (!ui_askf("Delete %d files and %d dirs?\n(%s)", (int)files, (int)dirs, sizestr))
+		return;
+
+	for (size_t i = 0; i < count; i++) {
+		char cpath[MAX_PATH + 1];
+		int res;
+
+		pstor_get(clippaths, cpath, MAX_PATH, i);
+		res = tree_delete(cpath);
+
+		/* already gone with a directory picked earlier */
+		if (res == -ERR_NOTFOUND) continue;
+		if (IS_ERR(res)) {
+			ui_msgf("Failed to delete\n\"%s\"\n%s", cpath, err_getstr(res));
+			break;
+		}
+	}
+
+	pstor_reset(clippaths);
+}
+
+static void fe_hash_progress(off_t cur, off_t tot, void *priv)
+{
+	ui_progress(cur >> 10, tot >> 10, "KiB", (const char*)priv);
+}
+
+static void fe_hash(const char *path)
+{
+	/* digests don't fit in a single line nor in a ui_msgf buffer */
+	char msg[256], sha1[SHA1_DIGEST_SIZE * 2 + 1], sha256[SHA256_DIGEST_SIZE * 2 + 1];
+	hash_result_t hres;
+	int res;
+
+	res = hash_file(path, HASH_ALL, &hres, fe_hash_progress, "Hashing...");
+	ui_progress(1, 0, NULL, NULL);
+	if (IS_ERR(res)) {
+		ui_msgf("Failed to hash\n\"%s\"\n%s", path, err_getstr(res));
+		return;
+	}
+
+	hash_hexstr(sha1, hres.sha1, SHA1_DIGEST_SIZE);
+	hash_hexstr(sha256, hres.sha256, SHA256_DIGEST_SIZE);
+
+	sprintf(msg, "CRC16: %04X\nCRC32: %08lX\n\nSHA-1:\n%.20s\n%s\n\nSHA-256:\n%.32s\n%s",
+		hres.crc16, (unsigned long)hres.crc32, sha1, &sha1[20], sha256, &sha256[32]);
+	ui_msg(msg);
+}
+
+enum {
+	FE_ACT_OPEN = 0,
+	FE_ACT_MOUNT,
+	FE_ACT_HEX,
+	FE_ACT_SEARCH,
+	FE_ACT_HASH,
+	FE_ACT_COUNT
+};
+
+static void fe_file_menu(const char *path)
+{
+	ui_menu_entry file_menu[FE_ACT_COUNT];
+	int actions[FE_ACT_COUNT];
+	char openstr[TFB_WIDTH];
+	fident_t *ident;
+	int nopt = 0, sel, res, drv;
+
+	ident = fident_identify(path);
+	if (ident && ident->handler) {
+		snprintf(openstr, sizeof(openstr), "Open as %s", ident->type_name);
+		file_menu[nopt].name = openstr;
+		file_menu[nopt].desc = "Open with the detected file type handler";
+		actions[nopt++] = FE_ACT_OPEN;
+	}
+
+	if (ident && ident->mount) {
+		file_menu[nopt].name = "Mount as drive";
+		file_menu[nopt].desc = "Browse the contents as a new drive";
+		actions[nopt++] = FE_ACT_MOUNT;
+	}
+
+	file_menu[nopt].name = "View as hex";
+	file_menu[nopt].desc = "Browse the raw contents";
+	actions[nopt++] = FE_ACT_HEX;
+
+	file_menu[nopt].name = "Search for bytes";
+	file_menu[nopt].desc = "Find a hex or text pattern";
+	actions[nopt++] = FE_ACT_SEARCH;
+
+	file_menu[nopt].name = "Calculate hashes";
+	file_menu[nopt].desc = "CRC16, CRC32, SHA-1 and SHA-256";
+	actions[nopt++] = FE_ACT_HASH;
+
+	sel = ui_menu(nopt, file_menu, "File options");
+	if (sel < 0) return;
+
+	switch(actions[sel]) {
+		case FE_ACT_OPEN:
+			res = ident->handler(path);
+			if (IS_ERR(res))
+				ui_msgf("Failed to open\n\"%s\"\n%s", path, err_getstr(res));
+			break;
+
+		case FE_ACT_MOUNT:
+			drv = vfs_free_drive();
+			res = IS_ERR(drv) ? drv : ident->mount(drv, path);
+			if (IS_ERR(res))
+				ui_msgf("Failed to mount\n\"%s\"\n%s", path, err_getstr(res));
+			else
+				ui_msgf("Mounted as %c:/", drv);
+			break;
+
+		case FE_ACT_HEX:
+			res = fe_hexview(path, 0);
+			if (IS_ERR(res))
+				ui_msgf("Failed to open\n\"%s\"\n%s", path, err_getstr(res));
+			break;
+
+		case FE_ACT_SEARCH:
+			fe_search(path);
+			break;
+
+		case FE_ACT_HASH:
+			fe_hash(path);
+			break;
+
+		default:
+			break;
+	}
+}
+
 void fe_main(char drv, pstor_t *paths, pstor_t *clippaths, vu16 *map)
 {
 	char cwd[MAX_PATH + 1];
@@ -182,9 +402,14 @@ void fe_main(char drv, pstor_t *paths, pstor_t *clippaths, vu16 *map)
 			break;
 		}
 
-		sel = fe_filemenu(map, &keys, paths, &cb);
+		sel = fe_filemenu(map, &keys, cwd, paths, &cb);
 		if (sel < 0) {
 			break;
+		} else if (keys & KEY_X) {
+			/* clipboard operations don't depend on the selection */
+			fe_paste(clippaths, cwd);
+		} else if (keys & KEY_SELECT) {
+			fe_delete(clippaths);
 		} else if (sel == 0) {
 			if (rectr == 0) break;
 			else {
@@ -217,12 +442,12 @@ void fe_main(char drv, pstor_t *paths, pstor_t *clippaths, vu16 *map)
 					rectr++;
 					strcpy(&cwd[cwdlen], &fpath[cwdlen]);
 				} else {
-					//fe_file_menu(fpath);
-					ui_msgf("you picked\n\"%s\"", fpath);
+					fe_file_menu(fpath);
 				}
 			}
 		}
 	}
 
+	ui_tilemap_clr(ui_map(FE_PREVIEW_SCR, FE_PREVIEW_BG));
 	bp_free(&cb);
 }
@@ -3,6 +3,7 @@
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
 
 #include "ui.h"
 #include "vfs.h"
@@ -40,6 +41,7 @@ void fe_mount_menu(void)
 	ui_menu_entry mount_menu[VFS_MOUNTPOINTS];
 	int mcnt, omcnt, res;
 	pstor_t ps, clip;
+	size_t fe_base = mem_used(MEM_FE);
 
 	res = pstor_init(&ps, FE_PATHBUF, FE_MAXITEM);
 	if (IS_ERR(res)) {
@@ -50,6 +52,7 @@ void fe_mount_menu(void)
 	res = pstor_init(&clip, FE_PATHBUF, FE_MAXITEM);
 	if (IS_ERR(res)) {
 		ui_msgf("Failed clipstore init:\n%s", err_getstr(res));
+		pstor_free(&ps);
 		return;
 	}
 
@@ -84,6 +87,15 @@ void fe_mount_menu(void)
 		}
 
 		sel = ui_menu(mcnt, mount_menu, "Main menu");
-		if (sel >= 0) fe_main(sel + 'A', &ps, &clip, map);
+		if (sel >= 0) {
+			/* the browser gets the path stores, anything else it takes must come back */
+			size_t base = mem_used(MEM_FE);
+			fe_main(sel + 'A', &ps, &clip, map);
+			mem_tag_check(MEM_FE, base, "browser");
+		}
 	} while(1);
+
+	pstor_free(&clip);
+	pstor_free(&ps);
+	mem_tag_check(MEM_FE, fe_base, "main menu");
 }
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "ui.h"
+#include "vfs.h"
+
+#include "search.h"
+#include "fe_hexview.h"
+
+#include "fe_search.h"
+
+#define FE_SEARCH_X		(1)
+#define FE_SEARCH_Y		(5)
+#define FE_SEARCH_W		(TFB_WIDTH - 2)
+
+typedef struct {
+	search_pat_t pat;
+	int count;
+	off_t hits[FE_SEARCH_LIST];
+	char names[FE_SEARCH_LIST][20];
+	ui_menu_entry menu[FE_SEARCH_LIST];
+} fe_search_t;
+
+static const char fe_search_hexset[] = "0123456789ABCDEF?";
+
+/* the last pattern is kept around, searches often get repeated */
+static char fe_search_pat[SEARCH_MAX * 2 + 1] = "00";
+static bool fe_search_text = false;
+
+static int fe_search_hexidx(char c)
+{
+	const char *p = strchr(fe_search_hexset, c);
+	return p ? (p - fe_search_hexset) : 0;
+}
+
+/* converts the pattern between hex and text, keeping what it can */
+static void fe_search_convert(void)
+{
+	char out[sizeof(fe_search_pat)];
+	size_t len = strlen(fe_search_pat), n = 0;
+
+	if (fe_search_text) {
+		for (size_t i = 0; i < len && n < SEARCH_MAX * 2; i++) {
+			u8 c = fe_search_pat[i];
+			if (c == '?') {
+				out[n++] = '?';
+				out[n++] = '?';
+			} else {
+				out[n++] = fe_search_hexset[c >> 4];
+				out[n++] = fe_search_hexset[c & 0xF];
+			}
+		}
+	} else {
+		for (size_t i = 0; i + 1 < len; i += 2) {
+			int hi = fe_search_hexidx(fe_search_pat[i]);
+			int lo = fe_search_hexidx(fe_search_pat[i + 1]);
+			int c = (hi << 4) | lo;
+
+			/* anything that doesn't have a plain character becomes a wildcard */
+			if (hi > 0xF || lo > 0xF || c < 0x20 || c > 0x7E || c == '?' || c == '\\')
+				c = '?';
+			out[n++] = c;
+		}
+	}
+
+	if (n == 0) out[n++] = 'a';
+	out[n] = '\0';
+
+	strcpy(fe_search_pat, out);
+	fe_search_text = !fe_search_text;
+}
+
+static void fe_search_draw(vu16 *map, size_t cur)
+{
+	size_t len = strlen(fe_search_pat);
+
+	swiWaitForVBlank();
+	ui_tilemap_set(map, CHR_OPAQUE);
+
+	ui_drawstr_xcenter(map, 1, "Search for bytes");
+	ui_drawstrf(map, FE_SEARCH_X, 3, "%s, ? matches any %s",
+		fe_search_text ? "Text" : "Hex", fe_search_text ? "byte" : "nibble");
+
+	/* the cursor gets a caret under it, spaces wouldn't show otherwise */
+	for (size_t i = 0; i < len; i++) {
+		size_t x = FE_SEARCH_X + (i % FE_SEARCH_W);
+		size_t y = FE_SEARCH_Y + (i / FE_SEARCH_W) * 2;
+
+		ui_drawc(map, (u8)fe_search_pat[i] | ((i == cur) ? TILE_PALETTE(COL_YELLOW) : 0), x, y);
+		if (i == cur) ui_drawc(map, '^', x, y + 1);
+	}
+
+	ui_drawstr(map, FE_SEARCH_X, 16,
+		"Up/Down  change\n"
+		"Lt/Rt    move\n"
+		"X        insert\n"
+		"Y        delete\n"
+		"SELECT   hex/text\n"
+		"A        search\n"
+		"B        cancel");
+}
+
+/* lets the user edit the pattern, returns true once it compiled */
+static bool fe_search_edit(search_pat_t *pat)
+{
+	vu16 *map = ui_map(MAINSCR, BG_PROM);
+	size_t len = strlen(fe_search_pat), cur = len - 1;
+	bool done = false;
+
+	do {
+		swiWaitForVBlank();
+		scanKeys();
+	} while(keysHeld() & KEY_ANY);
+
+	keysSetRepeat(15, 3);
+	fe_search_draw(map, cur);
+	while(1) {
+		size_t unit = fe_search_text ? 1 : 2, max = fe_search_text ? SEARCH_MAX : SEARCH_MAX * 2;
+		char *c = &fe_search_pat[cur];
+		int keys, res;
+
+		swiWaitForVBlank();
+		scanKeys();
+		keys = keysDownRepeat();
+		if (keys == 0) continue;
+
+		if (keys & KEY_B) break;
+
+		if (keys & KEY_A) {
+			if (fe_search_text) res = search_parse_text(pat, fe_search_pat);
+			else res = search_parse_hex(pat, fe_search_pat);
+
+			if (!IS_ERR(res)) {
+				done = true;
+				break;
+			}
+			ui_msg("The pattern needs at least\none byte that isn't a wildcard");
+			keysSetRepeat(15, 3);
+		}
+
+		if (keys & (KEY_UP | KEY_DOWN)) {
+			int d = (keys & KEY_UP) ? 1 : -1;
+
+			if (fe_search_text) {
+				*c = ((*c - 0x20 + d + 95) % 95) + 0x20;
+			} else {
+				int n = sizeof(fe_search_hexset) - 1;
+				*c = fe_search_hexset[(fe_search_hexidx(*c) + d + n) % n];
+			}
+		}
+
+		if ((keys & KEY_LEFT) && cur > 0) cur--;
+		if ((keys & KEY_RIGHT) && cur < len - 1) cur++;
+
+		if ((keys & KEY_X) && (len + unit) <= max) {
+			/* a new unit goes right after the one under the cursor */
+			size_t pos = fe_search_text ? (cur + 1) : ((cur | 1) + 1);
+
+			memmove(&fe_search_pat[pos + unit], &fe_search_pat[pos], len - pos + 1);
+			if (fe_search_text) fe_search_pat[pos] = *c;
+			else memcpy(&fe_search_pat[pos], "00", 2);
+			len += unit;
+			cur = pos;
+		}
+
+		if ((keys & KEY_Y) && len > unit) {
+			size_t pos = fe_search_text ? cur : (cur & ~1);
+
+			memmove(&fe_search_pat[pos], &fe_search_pat[pos + unit], len - pos - unit + 1);
+			len -= unit;
+			cur = (pos < len) ? pos : (len - 1);
+		}
+
+		if (keys & KEY_SELECT) {
+			fe_search_convert();
+			len = strlen(fe_search_pat);
+			cur = len - 1;
+		}
+
+		fe_search_draw(map, cur);
+	}
+
+	ui_tilemap_clr(map);
+	return done;
+}
+
+static bool fe_search_hit(off_t off, void *priv)
+{
+	fe_search_t *fs = priv;
+
+	/* keep counting past the end of the list */
+	if (fs->count < FE_SEARCH_LIST) fs->hits[fs->count] = off;
+	fs->count++;
+	return true;
+}
+
+static void fe_search_progress(off_t cur, off_t tot, void *priv)
+{
+	ui_progress(cur >> 10, tot >> 10, "KiB", "Searching...");
+}
+
+static void fe_search_results(const char *path, fe_search_t *fs)
+{
+	int n = (fs->count < FE_SEARCH_LIST) ? fs->count : FE_SEARCH_LIST;
+
+	for (int i = 0; i < n; i++) {
+		off_t off = fs->hits[i];
+
+		if (off >> 32) {
+			sprintf(fs->names[i], "%lX%08lX",
+				(unsigned long)(off >> 32), (unsigned long)off);
+		} else {
+			sprintf(fs->names[i], "%08lX", (unsigned long)off);
+		}
+
+		fs->menu[i].name = fs->names[i];
+		fs->menu[i].desc = "Open in the hex viewer";
+	}
+
+	while(1) {
+		int sel, res;
+
+		if (fs->count > n) sel = ui_menuf(n, fs->menu, "%d matches, first %d", fs->count, n);
+		else sel = ui_menuf(n, fs->menu, "%d matches", fs->count);
+		if (sel < 0) break;
+
+		res = fe_hexview(path, fs->hits[sel]);
+		if (IS_ERR(res)) {
+			ui_msgf("Failed to open\n\"%s\"\n%s", path, err_getstr(res));
+			break;
+		}
+	}
+}
+
+void fe_search(const char *path)
+{
+	fe_search_t *fs;
+	int res;
+
+	fs = mem_alloc(MEM_FE, sizeof(*fs));
+	if (fs == NULL) {
+		ui_msg("Not enough memory");
+		return;
+	}
+
+	if (fe_search_edit(&fs->pat)) {
+		fs->count = 0;
+		res = search_file(path, &fs->pat, fe_search_hit, fe_search_progress, fs);
+		ui_progress(1, 0, NULL, NULL);
+
+		if (IS_ERR(res))
+			ui_msgf("Failed to search\n\"%s\"\n%s", path, err_getstr(res));
+		else if (fs->count == 0)
+			ui_msg("No matches");
+		else
+			fe_search_results(path, fs);
+	}
+
+	mem_free(fs);
+}
@@ -0,0 +1,14 @@
+#ifndef FE_SEARCH_H__
+#define FE_SEARCH_H__
+
+#include <nds.h>
+
+#define FE_SEARCH_LIST	(256)	/* hits kept for the result list */
+
+/*
+ * asks for a hex or text pattern and searches the file at `path` for it
+ * hits can be opened in the hex viewer from the result list
+ */
+void fe_search(const char *path);
+
+#endif /* FE_SEARCH_H__ */
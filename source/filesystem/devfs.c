@@ -17,14 +17,12 @@ int devfs_vfs_mount(mount_t *mnt)
 
 int devfs_vfs_unmount(mount_t *mnt)
 {
-	free(mnt);
+	vfs_mount_free(mnt);
 	return 0;
 }
 
-int devfs_vfs_open(mount_t *mnt, vf_t *file, const char *path, int mode)
+static int devfs_find(devfs_t *dfs, const char *path)
 {
-	devfs_t *dfs = GET_PRIVDATA(mnt, devfs_t*);
-	devfs_entry_t *dev_entry;
 	size_t fidx;
 
 	/*
@@ -33,22 +31,63 @@ int devfs_vfs_open(mount_t *mnt, vf_t *file, const char *path, int mode)
 	 * deal with it
 	 */
 	for (fidx = 0; fidx < dfs->n_entries; fidx++) {
-		if (!strcasecmp(path, dfs->dev_entry[fidx].name)) break;
+		if (!strcasecmp(path, dfs->dev_entry[fidx].name)) return fidx;
 	}
-	if (fidx == dfs->n_entries) return -ERR_NOTFOUND;
+	return -ERR_NOTFOUND;
+}
+
+int devfs_vfs_open(mount_t *mnt, vf_t *file, const char *path, int mode)
+{
+	devfs_t *dfs = GET_PRIVDATA(mnt, devfs_t*);
+	devfs_entry_t *dev_entry;
+	int fidx;
+
+	fidx = devfs_find(dfs, path);
+	if (IS_ERR(fidx)) return fidx;
 
 	dev_entry = &dfs->dev_entry[fidx];
 
 	/* check permissions */
 	if ((dev_entry->flags & mode) != mode) return -ERR_ARG;
 
+	if (dfs->dev_open != NULL) {
+		int res = (dfs->dev_open)(dev_entry);
+		if (IS_ERR(res)) return res;
+	}
+
 	/* mark the file entry index */
-	SET_PRIVDATA(file, fidx);
+	SET_PRIVDATA(file, (size_t)fidx);
 	return 0;
 }
 
 int devfs_vfs_close(mount_t *mnt, vf_t *file)
 {
+	devfs_t *dfs = GET_PRIVDATA(mnt, devfs_t*);
+
+	if (dfs->dev_close != NULL)
+		(dfs->dev_close)(&dfs->dev_entry[GET_PRIVDATA(file, size_t)]);
+	return 0;
+}
+
+int devfs_vfs_stat(mount_t *mnt, const char *path, vfs_stat_t *st)
+{
+	devfs_t *dfs = GET_PRIVDATA(mnt, devfs_t*);
+	int fidx;
+
+	/* the root is the only directory */
+	if (!strcmp(path, "/")) {
+		st->flags = VFS_DIR | VFS_RO;
+		st->size = 0;
+		st->mtime = 0;
+		return 0;
+	}
+
+	fidx = devfs_find(dfs, path);
+	if (IS_ERR(fidx)) return fidx;
+
+	st->flags = dfs->dev_entry[fidx].flags;
+	st->size = dfs->dev_entry[fidx].size;
+	st->mtime = 0;
 	return 0;
 }
 
@@ -59,6 +98,7 @@ off_t devfs_vfs_read(mount_t *mnt, vf_t *file, void *buf, off_t size)
 	off_t rb = size;
 
 	/* clamp the position to bounds */
+	if (file->pos >= dev_entry->size) return 0;
 	if ((file->pos + rb) > dev_entry->size)
 		rb = dev_entry->size - file->pos;
 
@@ -74,6 +114,7 @@ off_t devfs_vfs_write(mount_t *mnt, vf_t *file, const void *buf, off_t size)
 	devfs_entry_t *dev_entry = &dfs->dev_entry[GET_PRIVDATA(file, size_t)];
 	off_t wb = size;
 
+	if (file->pos >= dev_entry->size) return 0;
 	if ((file->pos + wb) > dev_entry->size)
 		wb = dev_entry->size - file->pos;
 
@@ -88,6 +129,20 @@ off_t devfs_vfs_size(mount_t *mnt, vf_t *file)
 	return dev_entry->size;
 }
 
+int devfs_vfs_map(mount_t *mnt, vf_t *file, off_t pos, const void **ptr, off_t *len)
+{
+	devfs_t *dfs = GET_PRIVDATA(mnt, devfs_t*);
+	devfs_entry_t *dev_entry = &dfs->dev_entry[GET_PRIVDATA(file, size_t)];
+
+	if (dfs->dev_map == NULL) return -ERR_UNSUPP;
+	if (pos >= dev_entry->size) return -ERR_ARG;
+
+	/* the window is the device itself, nothing to release afterwards */
+	*ptr = (dfs->dev_map)(dev_entry, pos);
+	*len = dev_entry->size - pos;
+	return 0;
+}
+
 int devfs_vfs_diropen(mount_t *mnt, vf_t *dir, const char *path)
 {
 	/* subdirs are currently not supported */
@@ -110,22 +165,26 @@ int devfs_vfs_dirnext(mount_t *mnt, vf_t *dir, dirinf_t *next)
     if (idx >= dfs->n_entries) return -ERR_NOTFOUND;
     strcpy(next->path, &(dfs->dev_entry[idx].name)[1]);
     next->flags = dfs->dev_entry[idx].flags;
+    next->size = dfs->dev_entry[idx].size;
+    next->mtime = 0;
     return 0;
 }
 
 static const vfs_ops_t devfs_ops = {
 	.mount = devfs_vfs_mount,
-	.unmount = devfs_vfs_mount,
+	.unmount = devfs_vfs_unmount,
 
 	.open = devfs_vfs_open,
 	.close = devfs_vfs_close,
 
 	.unlink = NULL,
 	.rename = NULL,
+	.stat = devfs_vfs_stat,
 
 	.read = devfs_vfs_read,
 	.write = devfs_vfs_write,
 	.size = devfs_vfs_size,
+	.map = devfs_vfs_map,
 
 	.mkdir = NULL,
 	.diropen = devfs_vfs_diropen,
@@ -136,7 +195,7 @@ static const vfs_ops_t devfs_ops = {
 int devfs_mount(char drive, devfs_t *devfs)
 {
 	int res;
-	mount_t *mnt = malloc(sizeof(*mnt));
+	mount_t *mnt = vfs_mount_alloc();
 	if (mnt == NULL) return -ERR_MEM;
 
 	mnt->ops = &devfs_ops;
@@ -145,7 +204,7 @@ int devfs_mount(char drive, devfs_t *devfs)
 
 	res = vfs_mount(drive, mnt);
 	if (IS_ERR(res)) {
-		free(mnt);
+		vfs_mount_free(mnt);
 	}
 
 	return res;
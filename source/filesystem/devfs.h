@@ -21,9 +21,18 @@ typedef struct devfs_t {
 
 	const char *label;
 
+	/* optional, called on every open, can refresh the entry (size) */
+	int (*dev_open)(devfs_entry_t *dev_entry);
+
+	/* optional, called on every close of a successful open */
+	void (*dev_close)(devfs_entry_t *dev_entry);
+
 	off_t (*dev_read)(devfs_entry_t *dev_entry, void *buf, off_t pos, off_t size);
 	off_t (*dev_write)(devfs_entry_t *dev_entry, const void *buf, off_t pos, off_t size);
 
+	/* optional, for memory mapped devices: address of the byte at `pos` */
+	const void *(*dev_map)(devfs_entry_t *dev_entry, off_t pos);
+
 	void *priv;
 } devfs_t;
 
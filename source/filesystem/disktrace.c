@@ -0,0 +1,154 @@
+#ifndef ARM9
+#define _POSIX_C_SOURCE	199309L	/* clock_gettime on host builds */
+#include <time.h>
+#endif
+
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "vfs.h"
+
+#include "devfs.h"
+#include "disktrace.h"
+
+#ifdef DISK_TRACE
+
+static disktrace_rec_t ring[DISKTRACE_RECORDS];
+static u32 ring_next, ring_total, ring_dropped;
+
+/* snapshot taken by the first open, logging stops until the last close */
+static disktrace_hdr_t snap_hdr;
+static u32 snap_first, snap_opens;
+static bool paused;
+
+#ifdef ARM9
+#define DISKTRACE_HZ	(BUS_CLOCK)
+
+static void __attribute__((constructor)) __disktrace_ctor(void)
+{
+	cpuStartTiming(DISKTRACE_TIMER);
+}
+
+u32 disktrace_now(void)
+{
+	return cpuGetTiming();
+}
+#else
+#define DISKTRACE_HZ	(1000000)
+
+u32 disktrace_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u32)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+void disktrace_log(int pdrv, bool write, u32 lba, u32 count, u32 start, bool ok)
+{
+	disktrace_rec_t *rec;
+
+	if (paused) {
+		ring_dropped++;
+		return;
+	}
+
+	rec = &ring[ring_next];
+	rec->time = start;
+	rec->latency = disktrace_now() - start;
+	rec->lba = lba;
+	rec->count = count;
+	rec->drive = pdrv;
+	rec->flags = (write ? DISKTRACE_WRITE : 0) | (ok ? 0 : DISKTRACE_ERROR);
+
+	ring_next = (ring_next + 1) % DISKTRACE_RECORDS;
+	ring_total++;
+}
+
+static int trace_dev_open(devfs_entry_t *entry)
+{
+	u32 count = (ring_total < DISKTRACE_RECORDS) ? ring_total : DISKTRACE_RECORDS;
+
+	/* everyone else shares the snapshot already taken */
+	if (snap_opens++ > 0) return 0;
+	paused = true;
+
+	snap_hdr.magic = DISKTRACE_MAGIC;
+	snap_hdr.version = DISKTRACE_VERSION;
+	snap_hdr.rec_size = sizeof(disktrace_rec_t);
+	snap_hdr.tick_hz = DISKTRACE_HZ;
+	snap_hdr.count = count;
+	snap_hdr.lost = ring_total - count + ring_dropped;
+
+	/* the oldest record still in the ring */
+	snap_first = (ring_next + DISKTRACE_RECORDS - count) % DISKTRACE_RECORDS;
+
+	entry->size = sizeof(snap_hdr) + (off_t)count * sizeof(disktrace_rec_t);
+	return 0;
+}
+
+static void trace_dev_close(devfs_entry_t *entry)
+{
+	if (snap_opens > 0 && --snap_opens == 0) paused = false;
+}
+
+static off_t trace_dev_read(devfs_entry_t *entry, void *buf, off_t pos, off_t size)
+{
+	u8 *out = buf;
+	off_t left = size;
+
+	/* the header, then the records unwrapped from the ring */
+	while(left > 0) {
+		const u8 *src;
+		size_t avail;
+
+		if (pos < (off_t)sizeof(snap_hdr)) {
+			src = (const u8*)&snap_hdr + pos;
+			avail = sizeof(snap_hdr) - pos;
+		} else {
+			off_t roff = pos - sizeof(snap_hdr);
+			u32 idx = (snap_first + roff / sizeof(disktrace_rec_t)) % DISKTRACE_RECORDS;
+			size_t in = roff % sizeof(disktrace_rec_t);
+
+			src = (const u8*)&ring[idx] + in;
+			avail = sizeof(disktrace_rec_t) - in;
+		}
+
+		if ((off_t)avail > left) avail = left;
+		memcpy(out, src, avail);
+		out += avail;
+		pos += avail;
+		left -= avail;
+	}
+
+	return size;
+}
+
+static off_t trace_dev_write(devfs_entry_t *entry, const void *buf, off_t pos, off_t size)
+{
+	return -ERR_UNSUPP;
+}
+
+static devfs_entry_t trace_entries[] = {
+	{.name = "/disk.trc", .size = 0, .flags = VFS_FILE | VFS_RO},
+};
+
+static devfs_t trace_devfs = {
+	.dev_entry = trace_entries,
+	.n_entries = ARRAY_SIZE(trace_entries),
+	.label = "Trace",
+	.dev_open = trace_dev_open,
+	.dev_close = trace_dev_close,
+	.dev_read = trace_dev_read,
+	.dev_write = trace_dev_write,
+};
+
+int disktrace_init(char drive)
+{
+	return devfs_mount(drive, &trace_devfs);
+}
+
+#endif /* DISK_TRACE */
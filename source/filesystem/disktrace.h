@@ -0,0 +1,71 @@
+#ifndef DISKTRACE_H__
+#define DISKTRACE_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+/*
+ * block level I/O trace, only built with -DDISK_TRACE (make TRACE=1)
+ * without it the hooks below expand to nothing
+ *
+ * every disk_read/disk_write goes into a ring of the last
+ * DISKTRACE_RECORDS requests, readable as "/disk.trc" in the "Trace"
+ * drive so it can be copied onto the card and fed to tools/tracesim
+ *
+ * the trace stays frozen from the moment the file is opened until it's
+ * closed again, so copying it doesn't trace itself, requests issued
+ * meanwhile are counted as lost
+ */
+
+#define DISKTRACE_RECORDS	(4096)
+
+#define DISKTRACE_MAGIC		(0x43525444)	/* "DTRC" */
+#define DISKTRACE_VERSION	(1)
+
+enum {
+	DISKTRACE_WRITE	= BIT(0),	/**< Write request, read otherwise */
+	DISKTRACE_ERROR	= BIT(1),	/**< The driver failed the request */
+};
+
+/* on-disk format, little endian, tools/tracesim.c has its own copy */
+typedef struct {
+	u32 magic;
+	u16 version;
+	u16 rec_size;	/**< sizeof(disktrace_rec_t) */
+	u32 tick_hz;	/**< Timestamp frequency */
+	u32 count;		/**< Records following the header, oldest first */
+	u32 lost;		/**< Records overwritten by the ring or dropped while frozen */
+	u32 reserved[3];
+} disktrace_hdr_t;
+
+typedef struct {
+	u32 time;		/**< Issue time in ticks, wraps around */
+	u32 latency;	/**< Ticks until the driver returned */
+	u32 lba;		/**< First sector */
+	u32 count;		/**< Sectors */
+	u16 drive;		/**< FatFs physical drive */
+	u16 flags;		/**< DISKTRACE_WRITE, DISKTRACE_ERROR */
+} disktrace_rec_t;
+
+#ifdef DISK_TRACE
+
+/* timers 2 and 3 cascaded, same as the VFS counters */
+#define DISKTRACE_TIMER		(2)
+
+u32 disktrace_now(void);
+
+/* logs a request issued at `start` */
+void disktrace_log(int pdrv, bool write, u32 lba, u32 count, u32 start, bool ok);
+
+/* mounts the devfs drive holding the trace file */
+int disktrace_init(char drive);
+
+#else
+
+#define disktrace_now()								(0)
+#define disktrace_log(pdrv, w, lba, c, start, ok)	do { (void)(start); } while(0)
+
+#endif /* DISK_TRACE */
+
+#endif /* DISKTRACE_H__ */
@@ -4,6 +4,9 @@
 #include "global.h"
 
 #include "err.h"
+#include "arena.h"
+#include "mem.h"
+#include "slab.h"
 #include "vfs.h"
 
 #include "fat.h"
@@ -12,24 +15,44 @@
 
 #define FF_LOG_PATH(x)	((char[]){'0' + (x), ':', '\0'})
 
+/* drive prefix, local path and terminator */
+#define FF_PATH_MAX	(MAX_PATH + 3)
+
+/* initial cluster link map size in DWORDs, grown on demand */
+#define FAT_CLMT_INIT	(32)
+
 typedef struct {
 	const fat_disk_ops *dops;
+	void *dpriv;
 	unsigned int drvn;
-	char label[16];
+	char label[34];	/* 11 OEM chars, up to 3 bytes each in UTF-8 */
 
 	FATFS fs;
 } fat_state;
 
 static fat_state *states[FF_MAX_DISK] = {NULL};
 
+/* FIL carries its own sector buffer, keep them all out of the general heap */
+static slab_t fil_slab = SLAB_INIT("fat_fil", FIL, MAX_FILES);
+static slab_t dir_slab = SLAB_INIT("fat_dir", DIR, MAX_FILES);
+static slab_t state_slab = SLAB_INIT("fat_vol", fat_state, FF_MAX_DISK);
+
 static inline void ff_make_path(char *o, int d, const char *p, bool f)
 {
 	*(o++) = '0' + d;
 	*(o++) = ':';
-	do { *(o++) = *(p++); } while(*p);
+	while((*o = *(p++))) o++;
 	if (f && o[-1] == '/') o[-1] = '\0';
 }
 
+/* same as above in arena scratch memory, NULL if there's no room left */
+static char *ff_scratch_path(fat_state *state, const char *p, bool f)
+{
+	char *o = arena_alloc(FF_PATH_MAX);
+	if (o != NULL) ff_make_path(o, state->drvn, p, f);
+	return o;
+}
+
 const fat_disk_ops *ff_get_disk_ops(int disk)
 {
 	if (states[disk]) {
@@ -38,12 +61,64 @@ const fat_disk_ops *ff_get_disk_ops(int disk)
 	return NULL;
 }
 
+void *ff_get_disk_priv(int disk)
+{
+	if (states[disk]) {
+		return states[disk]->dpriv;
+	}
+	return NULL;
+}
+
+/*
+ * builds the cluster link map of a file on its first random access
+ * so seeking doesn't have to follow the FAT chain from the start anymore
+ * if it can't be built the file just keeps using regular seeks
+ */
+static void _ff_clmt_build(FIL *fp)
+{
+	DWORD *tbl;
+	int res;
+
+	tbl = mem_alloc(MEM_FAT, FAT_CLMT_INIT * sizeof(DWORD));
+	if (tbl == NULL) return;
+
+	tbl[0] = FAT_CLMT_INIT;
+	fp->cltbl = tbl;
+	res = f_lseek(fp, CREATE_LINKMAP);
+
+	if (res == FR_NOT_ENOUGH_CORE) {
+		DWORD need = tbl[0];
+
+		fp->cltbl = NULL;
+		mem_free(tbl);
+		tbl = mem_alloc(MEM_FAT, need * sizeof(DWORD));
+		if (tbl == NULL) return;
+
+		tbl[0] = need;
+		fp->cltbl = tbl;
+		res = f_lseek(fp, CREATE_LINKMAP);
+	}
+
+	if (res != FR_OK) {
+		fp->cltbl = NULL;
+		mem_free(tbl);
+	}
+}
+
+/* the map can't describe clusters that get appended later */
+static inline void _ff_clmt_drop(FIL *fp)
+{
+	mem_free(fp->cltbl);
+	fp->cltbl = NULL;
+}
+
 static int _ff_vfs_mode(int vfs_mode)
 {
 	int ret = 0;
 	if (vfs_mode & VFS_RO) ret |= FA_READ;
 	if (vfs_mode & VFS_WO) ret |= FA_WRITE;
-	if (vfs_mode & VFS_CREATE) ret |= FA_CREATE_ALWAYS;
+	/* VFS_CREATE includes VFS_WO, plain RW opens must not truncate */
+	if ((vfs_mode & VFS_CREATE) == VFS_CREATE) ret |= FA_CREATE_ALWAYS;
 	return ret;
 }
 
@@ -73,6 +148,11 @@ static int _ff_err(unsigned int err)
 	return -ff_err_ttbl[err];
 }
 
+static inline u32 _ff_mtime(const FILINFO *fno)
+{
+	return ((u32)fno->fdate << 16) | fno->ftime;
+}
+
 int fat_vfs_mount(mount_t *mnt)
 {
 	int res;
@@ -100,9 +180,14 @@ int fat_vfs_unmount(mount_t *mnt)
 	fat_state *state = GET_PRIVDATA(mnt, fat_state*);
 	int res = f_mount(NULL, FF_LOG_PATH(state->drvn), 0);
 	if (res == FR_OK) {
+		const fat_disk_ops *dops = state->dops;
+		void *dpriv = state->dpriv;
+
 		states[state->drvn] = NULL;
-		free(state);
-		free(mnt);
+		slab_free(&state_slab, state);
+		vfs_mount_free(mnt);
+
+		if (dops->release) dops->release(dpriv);
 	}
 
 	return _ff_err(res);
@@ -112,20 +197,22 @@ int fat_vfs_open(mount_t *mnt, vf_t *file, const char *path, int mode)
 {
 	int res;
 	FIL *ff_file;
-	char ff_lpath[MAX_PATH + 1];
+	char *ff_lpath;
+	arena_mark_t mark = arena_push();
 	fat_state *state = GET_PRIVDATA(mnt, fat_state*);
 
-	ff_file = malloc(sizeof(*ff_file));
+	ff_file = slab_alloc(&fil_slab);
 	if (ff_file == NULL) return -ERR_MEM;
 
-	ff_make_path(ff_lpath, state->drvn, path, false);
-	res = f_open(ff_file, ff_lpath, _ff_vfs_mode(mode));
+	ff_lpath = ff_scratch_path(state, path, false);
+	res = ff_lpath ? f_open(ff_file, ff_lpath, _ff_vfs_mode(mode)) : FR_NOT_ENOUGH_CORE;
 	if (res == FR_OK) {
 		SET_PRIVDATA(file, ff_file);
 	} else {
-		free(ff_file);
+		slab_free(&fil_slab, ff_file);
 	}
 
+	arena_pop(mark);
 	return _ff_err(res);
 }
 
@@ -137,7 +224,8 @@ int fat_vfs_close(mount_t *mnt, vf_t *file)
 	res = f_close(ff_file);
 	if (res == FR_OK) {
 		SET_PRIVDATA(file, NULL);
-		free(ff_file);
+		_ff_clmt_drop(ff_file);
+		slab_free(&fil_slab, ff_file);
 	}
 
 	return _ff_err(res);
@@ -146,34 +234,57 @@ int fat_vfs_close(mount_t *mnt, vf_t *file)
 int fat_vfs_unlink(mount_t *mnt, const char *path)
 {
 	int res;
-	char ff_lpath[MAX_PATH + 1];
+	arena_mark_t mark = arena_push();
 	fat_state *state = GET_PRIVDATA(mnt, fat_state*);
+	char *ff_lpath = ff_scratch_path(state, path, true);
 
-	ff_make_path(ff_lpath, state->drvn, path, true);
-
-	res = f_unlink(ff_lpath);
+	res = ff_lpath ? f_unlink(ff_lpath) : FR_NOT_ENOUGH_CORE;
+	arena_pop(mark);
 	return _ff_err(res);
 }
 
 int fat_vfs_rename(mount_t *mnt, const char *oldp, const char *newp)
 {
 	int res;
-	char ff_lop[MAX_PATH + 1], ff_lnp[MAX_PATH + 1];
+	arena_mark_t mark = arena_push();
+	fat_state *state = GET_PRIVDATA(mnt, fat_state*);
+	char *ff_lop = ff_scratch_path(state, oldp, true);
+	char *ff_lnp = ff_scratch_path(state, newp, true);
+
+	res = (ff_lop && ff_lnp) ? f_rename(ff_lop, ff_lnp) : FR_NOT_ENOUGH_CORE;
+	arena_pop(mark);
+	return _ff_err(res);
+}
+
+int fat_vfs_stat(mount_t *mnt, const char *path, vfs_stat_t *st)
+{
+	int res;
+	arena_mark_t mark = arena_push();
 	fat_state *state = GET_PRIVDATA(mnt, fat_state*);
+	char *ff_lpath = ff_scratch_path(state, path, true);
+	FILINFO *fno = arena_alloc(sizeof(*fno));
 
-	ff_make_path(ff_lop, state->drvn, oldp, true);
-	ff_make_path(ff_lnp, state->drvn, newp, true);
+	res = (ff_lpath && fno) ? f_stat(ff_lpath, fno) : FR_NOT_ENOUGH_CORE;
+	if (res == FR_OK) {
+		st->flags = (fno->fattrib & AM_DIR) ? VFS_DIR : VFS_FILE;
+		st->flags |= (fno->fattrib & AM_RDO) ? VFS_RO : VFS_RW;
+		st->size = (fno->fattrib & AM_DIR) ? 0 : fno->fsize;
+		st->mtime = _ff_mtime(fno);
+	}
 
-	res = f_rename(ff_lop, ff_lnp);
+	arena_pop(mark);
 	return _ff_err(res);
 }
 
 off_t fat_vfs_read(mount_t *mnt, vf_t *file, void *buf, off_t size)
 {
 	int res;
-	size_t br;
+	UINT br;
 	FIL *ff_file = GET_PRIVDATA(file, FIL*);
 
+	if (ff_file->cltbl == NULL && file->pos != f_tell(ff_file))
+		_ff_clmt_build(ff_file);
+
 	res = f_lseek(ff_file, file->pos);
 	if (res != FR_OK) return _ff_err(res);
 
@@ -184,9 +295,15 @@ off_t fat_vfs_read(mount_t *mnt, vf_t *file, void *buf, off_t size)
 off_t fat_vfs_write(mount_t *mnt, vf_t *file, const void *buf, off_t size)
 {
 	int res;
-	size_t wb;
+	UINT wb;
 	FIL *ff_file = GET_PRIVDATA(file, FIL*);
 
+	if ((file->pos + size) > f_size(ff_file)) {
+		_ff_clmt_drop(ff_file);
+	} else if (ff_file->cltbl == NULL && file->pos != f_tell(ff_file)) {
+		_ff_clmt_build(ff_file);
+	}
+
 	res = f_lseek(ff_file, file->pos);
 	if (res != FR_OK) return _ff_err(res);
 
@@ -203,12 +320,12 @@ off_t fat_vfs_size(mount_t *mnt, vf_t *file)
 int fat_vfs_mkdir(mount_t *mnt, const char *path)
 {
 	int res;
-	char ff_lpath[MAX_PATH + 1];
+	arena_mark_t mark = arena_push();
 	fat_state *state = GET_PRIVDATA(mnt, fat_state*);
+	char *ff_lpath = ff_scratch_path(state, path, true);
 
-	ff_make_path(ff_lpath, state->drvn, path, true);
-
-	res = f_mkdir(ff_lpath);
+	res = ff_lpath ? f_mkdir(ff_lpath) : FR_NOT_ENOUGH_CORE;
+	arena_pop(mark);
 	return _ff_err(res);
 }
 
@@ -216,21 +333,22 @@ int fat_vfs_diropen(mount_t *mnt, vf_t *dir, const char *path)
 {
 	DIR *dp;
 	int res;
-	char ff_lpath[MAX_PATH + 1];
+	char *ff_lpath;
+	arena_mark_t mark = arena_push();
 	fat_state *state = GET_PRIVDATA(mnt, fat_state*);
 
-	dp = malloc(sizeof(*dp));
+	dp = slab_alloc(&dir_slab);
 	if (dp == NULL) return -ERR_MEM;
 
-	ff_make_path(ff_lpath, state->drvn, path, true);
-
-	res = f_opendir(dp, ff_lpath);
+	ff_lpath = ff_scratch_path(state, path, true);
+	res = ff_lpath ? f_opendir(dp, ff_lpath) : FR_NOT_ENOUGH_CORE;
 	if (res == FR_OK) {
 		SET_PRIVDATA(dir, dp);
 	} else {
-		free(dp);
+		slab_free(&dir_slab, dp);
 	}
 
+	arena_pop(mark);
 	return _ff_err(res);
 }
 
@@ -241,7 +359,7 @@ int fat_vfs_dirclose(mount_t *mnt, vf_t *dir)
 
 	res = f_closedir(dp);
 	if (res == FR_OK) {
-		free(dp);
+		slab_free(&dir_slab, dp);
 	}
 
 	return _ff_err(res);
@@ -250,26 +368,33 @@ int fat_vfs_dirclose(mount_t *mnt, vf_t *dir)
 int fat_vfs_dirnext(mount_t *mnt, vf_t *dir, dirinf_t *next)
 {
 	int res;
-	FILINFO fno;
 	int flags = 0;
 	DIR *dp = GET_PRIVDATA(dir, DIR*);
+	arena_mark_t mark = arena_push();
+	FILINFO *fno = arena_alloc(sizeof(*fno));
 
-	res = f_readdir(dp, &fno);
-	if (res != FR_OK || fno.fname[0] == '\0') {
+	res = fno ? f_readdir(dp, fno) : FR_NOT_ENOUGH_CORE;
+	if (res != FR_OK || fno->fname[0] == '\0') {
 		next->path[0] = '\0';
 		next->flags = 0;
+		next->size = 0;
+		next->mtime = 0;
+		arena_pop(mark);
 		return -ERR_NOTFOUND;
 	}
 
-	strcpy(next->path, fno.fname);
-	if (fno.fattrib & AM_DIR) {
+	strcpy(next->path, fno->fname);
+	if (fno->fattrib & AM_DIR) {
 		strcat(next->path, "/");
 	}
 
-	flags |= (fno.fattrib & AM_DIR) ? VFS_DIR : VFS_FILE;
-	flags |= (fno.fattrib & AM_RDO) ? VFS_RO : VFS_RW;
+	flags |= (fno->fattrib & AM_DIR) ? VFS_DIR : VFS_FILE;
+	flags |= (fno->fattrib & AM_RDO) ? VFS_RO : VFS_RW;
 
 	next->flags = flags;
+	next->size = (fno->fattrib & AM_DIR) ? 0 : fno->fsize;
+	next->mtime = _ff_mtime(fno);
+	arena_pop(mark);
 	return 0;
 }
 
@@ -282,6 +407,7 @@ static const vfs_ops_t fat_ops = {
 
 	.unlink = fat_vfs_unlink,
 	.rename = fat_vfs_rename,
+	.stat = fat_vfs_stat,
 
 	.read = fat_vfs_read,
 	.write = fat_vfs_write,
@@ -293,7 +419,7 @@ static const vfs_ops_t fat_ops = {
 	.dirnext = fat_vfs_dirnext,
 };
 
-int fat_mount(char drive, const fat_disk_ops *disk_ops)
+int fat_mount(char drive, const fat_disk_ops *disk_ops, void *priv)
 {
 	int res;
 	size_t idx;
@@ -305,12 +431,12 @@ int fat_mount(char drive, const fat_disk_ops *disk_ops)
 		if (states[idx] == NULL) break;
 	if (idx == FF_MAX_DISK) return -ERR_DEV;
 
-	mnt = malloc(sizeof(*mnt));
+	mnt = vfs_mount_alloc();
 	if (mnt == NULL) return -ERR_MEM;
 
-	state = malloc(sizeof(*state));
+	state = slab_alloc(&state_slab);
 	if (state == NULL) {
-		free(mnt);
+		vfs_mount_free(mnt);
 		return -ERR_MEM;
 	}
 
@@ -321,11 +447,12 @@ int fat_mount(char drive, const fat_disk_ops *disk_ops)
 	memset(state->label, 0, sizeof(state->label));
 	state->drvn = idx;
 	state->dops = disk_ops;
+	state->dpriv = priv;
 
 	res = vfs_mount(drive, mnt);
 	if (IS_ERR(res)) {
-		free(state);
-		free(mnt);
+		slab_free(&state_slab, state);
+		vfs_mount_free(mnt);
 	}
 
 	return res;
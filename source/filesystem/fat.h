@@ -12,14 +12,17 @@
 #define FAT_SECT_SIZE	((off_t)512ULL)
 #define FF_MAX_DISK 	(10)
 
+/* every operation gets the `priv` pointer passed to fat_mount */
 typedef struct {
-	int (*init)(void);
-	int (*online)(void);
-	int (*read)(BYTE *buf, DWORD start, UINT count);
-	int (*write)(const BYTE *buf, DWORD start, UINT count);
+	int (*init)(void *priv);
+	int (*online)(void *priv);
+	int (*read)(void *priv, BYTE *buf, DWORD start, UINT count);
+	int (*write)(void *priv, const BYTE *buf, DWORD start, UINT count);
+	void (*release)(void *priv);	/* optional, called after unmounting */
 } fat_disk_ops;
 
 const fat_disk_ops *ff_get_disk_ops(int disk);
-int fat_mount(char drive, const fat_disk_ops *disk_ops);
+void *ff_get_disk_priv(int disk);
+int fat_mount(char drive, const fat_disk_ops *disk_ops, void *priv);
 
 #endif /* FAT_H__ */
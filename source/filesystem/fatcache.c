@@ -0,0 +1,137 @@
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+
+#include "fat.h"
+
+#include "fatcache.h"
+
+#ifdef FAT_CACHE_SECTORS
+
+#define FATCACHE_NONE	(-1)
+
+typedef struct {
+	DWORD sect;
+	s16 pdrv;	/**< FatFs physical drive, FATCACHE_NONE if unused */
+	s16 next;	/**< Next entry in the same bucket */
+	u32 used;	/**< Last hit, for LRU eviction */
+} fatcache_ent_t;
+
+static fatcache_ent_t ents[FAT_CACHE_SECTORS] TCM_BSS;
+static s16 buckets[FATCACHE_BUCKETS] TCM_BSS;
+static u32 lru_clock TCM_BSS;
+
+/* only ever memcpy'd to and from the window, so DTCM is fine if they fit */
+#if FAT_CACHE_SECTORS <= FATCACHE_TCM_SECTORS
+static u8 pages[FAT_CACHE_SECTORS][FAT_SECT_SIZE] TCM_BSS __attribute__((aligned(32)));
+#else
+static u8 pages[FAT_CACHE_SECTORS][FAT_SECT_SIZE] __attribute__((aligned(32)));
+#endif
+
+static inline int _fatcache_hash(int pdrv, DWORD sect)
+{
+	return (sect ^ (pdrv * 0x9E3779B1)) % FATCACHE_BUCKETS;
+}
+
+static void __attribute__((constructor)) __fatcache_ctor(void)
+{
+	for (int i = 0; i < FATCACHE_BUCKETS; i++)
+		buckets[i] = FATCACHE_NONE;
+	for (int i = 0; i < FAT_CACHE_SECTORS; i++) {
+		ents[i].pdrv = FATCACHE_NONE;
+		ents[i].next = FATCACHE_NONE;
+	}
+}
+
+static int _fatcache_find(int pdrv, DWORD sect)
+{
+	int i = buckets[_fatcache_hash(pdrv, sect)];
+
+	while(i != FATCACHE_NONE) {
+		if (ents[i].sect == sect && ents[i].pdrv == pdrv) return i;
+		i = ents[i].next;
+	}
+	return FATCACHE_NONE;
+}
+
+static void _fatcache_unlink(int i)
+{
+	s16 *link = &buckets[_fatcache_hash(ents[i].pdrv, ents[i].sect)];
+
+	while(*link != i) link = &ents[*link].next;
+	*link = ents[i].next;
+	ents[i].pdrv = FATCACHE_NONE;
+	ents[i].next = FATCACHE_NONE;
+}
+
+/* a free entry if there's one, the least recently used otherwise */
+static int _fatcache_victim(void)
+{
+	int v = 0;
+
+	for (int i = 0; i < FAT_CACHE_SECTORS; i++) {
+		if (ents[i].pdrv == FATCACHE_NONE) return i;
+		if ((s32)(ents[i].used - ents[v].used) < 0) v = i;
+	}
+
+	_fatcache_unlink(v);
+	return v;
+}
+
+bool fatcache_read(int pdrv, BYTE *buf, DWORD sect, UINT count)
+{
+	int i;
+
+	if (count != 1) return false;
+
+	i = _fatcache_find(pdrv, sect);
+	if (i == FATCACHE_NONE) return false;
+
+	ents[i].used = ++lru_clock;
+	memcpy(buf, pages[i], FAT_SECT_SIZE);
+	return true;
+}
+
+void fatcache_fill(int pdrv, const BYTE *buf, DWORD sect, UINT count)
+{
+	int i, h;
+
+	if (count != 1) return;
+
+	i = _fatcache_victim();
+	h = _fatcache_hash(pdrv, sect);
+
+	ents[i].sect = sect;
+	ents[i].pdrv = pdrv;
+	ents[i].used = ++lru_clock;
+	ents[i].next = buckets[h];
+	buckets[h] = i;
+	memcpy(pages[i], buf, FAT_SECT_SIZE);
+}
+
+void fatcache_write(int pdrv, const BYTE *buf, DWORD sect, UINT count)
+{
+	/* single sectors are FAT, directory or window flushes, likely to be read again */
+	if (count == 1 && _fatcache_find(pdrv, sect) == FATCACHE_NONE) {
+		fatcache_fill(pdrv, buf, sect, count);
+		return;
+	}
+
+	for (UINT s = 0; s < count; s++) {
+		int i = _fatcache_find(pdrv, sect + s);
+		if (i == FATCACHE_NONE) continue;
+
+		ents[i].used = ++lru_clock;
+		memcpy(pages[i], &buf[s * FAT_SECT_SIZE], FAT_SECT_SIZE);
+	}
+}
+
+void fatcache_drop(int pdrv)
+{
+	for (int i = 0; i < FAT_CACHE_SECTORS; i++) {
+		if (ents[i].pdrv == pdrv) _fatcache_unlink(i);
+	}
+}
+
+#endif /* FAT_CACHE_SECTORS */
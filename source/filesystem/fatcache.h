@@ -0,0 +1,52 @@
+#ifndef FATCACHE_H__
+#define FATCACHE_H__
+
+#include <nds.h>
+
+#include "ff.h"
+
+/*
+ * shared sector cache, only built with -DFAT_CACHE_SECTORS=n (make FATCACHE=n)
+ * without it the hooks below expand to nothing
+ *
+ * FatFs is switched to its tiny configuration, so files don't carry a
+ * sector buffer of their own and every partial sector goes through the
+ * volume window instead. the window is backed by `n` cached sectors shared
+ * by every volume, so the FAT, directories and all handles on a file hit
+ * the same copies and memory only depends on `n`
+ *
+ * single sector requests are cached, longer ones go straight to the driver
+ * writes go through to the driver and refresh any cached copies
+ */
+
+#ifdef FAT_CACHE_SECTORS
+
+#define FATCACHE_BUCKETS	(64)
+
+/* caches up to this size keep their sectors in DTCM along with the index */
+#ifndef FATCACHE_TCM_SECTORS
+#define FATCACHE_TCM_SECTORS	(4)
+#endif
+
+/* fills `buf` if the sector is cached, returns true on a hit */
+bool fatcache_read(int pdrv, BYTE *buf, DWORD sect, UINT count);
+
+/* keeps a copy of a sector that has just been read from the driver */
+void fatcache_fill(int pdrv, const BYTE *buf, DWORD sect, UINT count);
+
+/* refreshes the copies of sectors just written, lone sectors get cached anyway */
+void fatcache_write(int pdrv, const BYTE *buf, DWORD sect, UINT count);
+
+/* forgets every sector of a drive, the media might have changed */
+void fatcache_drop(int pdrv);
+
+#else
+
+#define fatcache_read(pdrv, buf, sect, count)	(false)
+#define fatcache_fill(pdrv, buf, sect, count)	do { } while(0)
+#define fatcache_write(pdrv, buf, sect, count)	do { } while(0)
+#define fatcache_drop(pdrv)						do { } while(0)
+
+#endif /* FAT_CACHE_SECTORS */
+
+#endif /* FATCACHE_H__ */
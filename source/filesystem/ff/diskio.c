@@ -11,6 +11,9 @@
 #include "diskio.h"		/* FatFs lower layer API */
 
 #include "fat.h"
+#include "disktrace.h"
+#include "fatcache.h"
+#include "vfs_stats.h"
 
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
@@ -21,7 +24,7 @@ DSTATUS disk_status (
 )
 {
 	const fat_disk_ops *ops = ff_get_disk_ops(pdrv);
-	if (ops != NULL && ops->online()) return RES_OK;
+	if (ops != NULL && ops->online(ff_get_disk_priv(pdrv))) return RES_OK;
 	return RES_NOTRDY;
 }
 
@@ -36,7 +39,8 @@ DSTATUS disk_initialize (
 )
 {
 	const fat_disk_ops *ops = ff_get_disk_ops(pdrv);
-	if (ops != NULL && ops->init()) return RES_OK;
+	fatcache_drop(pdrv);
+	if (ops != NULL && ops->init(ff_get_disk_priv(pdrv))) return RES_OK;
 	return RES_NOTRDY;
 }
 
@@ -54,9 +58,17 @@ DRESULT disk_read (
 )
 {
 	const fat_disk_ops *ops = ff_get_disk_ops(pdrv);
+	u32 start = vfs_stats_now(), tstart = disktrace_now();
+	int res;
+
 	if (ops == NULL) return RES_NOTRDY;
-	if (ops->read(buff, sector, count) == 0) return RES_OK;
-	return RES_NOTRDY;
+	if (fatcache_read(pdrv, buff, sector, count)) return RES_OK;
+
+	res = ops->read(ff_get_disk_priv(pdrv), buff, sector, count);
+	vfs_stats_disk(pdrv, false, count, start, res == 0);
+	disktrace_log(pdrv, false, sector, count, tstart, res == 0);
+	if (res == 0) fatcache_fill(pdrv, buff, sector, count);
+	return (res == 0) ? RES_OK : RES_NOTRDY;
 }
 
 
@@ -73,9 +85,15 @@ DRESULT disk_write (
 )
 {
 	const fat_disk_ops *ops = ff_get_disk_ops(pdrv);
+	u32 start = vfs_stats_now(), tstart = disktrace_now();
+	int res;
+
 	if (ops == NULL) return RES_NOTRDY;
-	if (ops->write(buff, sector, count) == 0) return RES_OK;
-	return RES_NOTRDY;
+	res = ops->write(ff_get_disk_priv(pdrv), buff, sector, count);
+	vfs_stats_disk(pdrv, true, count, start, res == 0);
+	disktrace_log(pdrv, true, sector, count, tstart, res == 0);
+	if (res == 0) fatcache_write(pdrv, buff, sector, count);
+	return (res == 0) ? RES_OK : RES_NOTRDY;
 }
 
 
@@ -15465,7 +15465,8 @@ WCHAR ff_oem2uni (	/* Returns Unicode character, zero on error */
 /* Unicode up-case conversion                                             */
 /*------------------------------------------------------------------------*/
 
-DWORD ff_wtoupper (	/* Returns up-converted code point */
+#ifdef FF_CASE_REFERENCE	/* Only built into tools/casegen, which flattens it into ffcase.h */
+static DWORD ff_wtoupper_ref (	/* Returns up-converted code point */
 	DWORD uni		/* Unicode code point to be up-converted */
 )
 {
@@ -15593,5 +15594,19 @@ DWORD ff_wtoupper (	/* Returns up-converted code point */
 	return uni;
 }
 
+#else
+#include "ffcase.h"	/* Generated from the tables above at build time */
+
+DWORD ff_wtoupper (	/* Returns up-converted code point */
+	DWORD uni		/* Unicode code point to be up-converted */
+)
+{
+	if (uni < 0x80) return uni - ((uni - 'a' < 26) << 5);	/* ASCII without branches */
+	if (uni >= 0x10000) return uni;		/* Out of BMP? */
+
+	return (WORD)(uni + ff_case_delta[ff_case_index[uni >> FF_CASE_SHIFT]][uni & ((1 << FF_CASE_SHIFT) - 1)]);
+}
+#endif
+
 
 #endif /* #if FF_USE_LFN */
@@ -0,0 +1,434 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "vfs.h"
+
+#include "nitrofs.h"
+#include "srl.h"
+
+/*
+ * the FNT and FAT are read once at mount time with two positional reads
+ * names are never copied, entries point straight into the FNT blob
+ */
+
+typedef struct {
+	u32 start;
+	u32 end;
+} nitrofs_fat_t;
+
+typedef struct {
+	u32 name;		/* offset of the name in the FNT */
+	u8 name_len;
+	u8 is_dir;
+	u16 id;			/* file id, or directory index for subdirectories */
+} nitrofs_entry_t;
+
+typedef struct {
+	u32 first;		/* index of the first entry */
+	u32 count;		/* amount of entries */
+} nitrofs_dir_t;
+
+typedef struct {
+	int fd;
+	char path[MAX_PATH + 1];
+	char label[13];
+
+	u8 *fnt;
+	nitrofs_fat_t *fat;
+	u32 fnt_size;
+	u32 nfiles;
+
+	nitrofs_dir_t *dirs;
+	nitrofs_entry_t *entries;
+	u32 ndirs;
+	u32 nentries;
+} nitrofs_state;
+
+/* walks a directory subtable, counting or filling entries */
+static int _nitrofs_subtable(nitrofs_state *st, u32 off, u16 first_id,
+							nitrofs_entry_t *out, u32 *count)
+{
+	u16 file_id = first_id;
+	u32 n = 0;
+
+	while(1) {
+		u8 tl, len;
+
+		if (off >= st->fnt_size) return -ERR_IO;
+		tl = st->fnt[off++];
+		if (tl == 0) break;
+
+		len = tl & 0x7F;
+		if ((off + len + ((tl & 0x80) ? 2 : 0)) > st->fnt_size) return -ERR_IO;
+
+		if (out) {
+			out[n].name = off;
+			out[n].name_len = len;
+			out[n].is_dir = (tl & 0x80) != 0;
+		}
+		off += len;
+
+		if (tl & 0x80) {
+			u16 did = st->fnt[off] | (st->fnt[off + 1] << 8);
+			off += 2;
+			if (did < NITROFS_ROOT || (did - NITROFS_ROOT) >= st->ndirs) return -ERR_IO;
+			if (out) out[n].id = did - NITROFS_ROOT;
+		} else {
+			if (file_id >= st->nfiles) return -ERR_IO;
+			if (out) out[n].id = file_id;
+			file_id++;
+		}
+
+		n++;
+	}
+
+	*count = n;
+	return 0;
+}
+
+static int _nitrofs_parse(nitrofs_state *st)
+{
+	u32 total = 0;
+	int res;
+
+	if (st->fnt_size < 8) return -ERR_IO;
+
+	/* the root main table entry holds the directory count */
+	st->ndirs = st->fnt[6] | (st->fnt[7] << 8);
+	if (st->ndirs == 0 || (st->ndirs * 8) > st->fnt_size) return -ERR_IO;
+
+	/* first pass counts, second pass fills the single allocation */
+	for (int pass = 0; pass < 2; pass++) {
+		u32 idx = 0;
+
+		for (u32 d = 0; d < st->ndirs; d++) {
+			const u8 *m = &st->fnt[d * 8];
+			u32 sub = m[0] | (m[1] << 8) | (m[2] << 16) | (m[3] << 24);
+			u16 first = m[4] | (m[5] << 8);
+			u32 cnt;
+
+			res = _nitrofs_subtable(st, sub, first,
+				pass ? &st->entries[idx] : NULL, &cnt);
+			if (IS_ERR(res)) return res;
+
+			if (pass) {
+				st->dirs[d].first = idx;
+				st->dirs[d].count = cnt;
+			}
+			idx += cnt;
+		}
+
+		if (pass == 0) {
+			total = idx;
+			st->dirs = mem_alloc(MEM_ARCHIVE, st->ndirs * sizeof(*st->dirs) + total * sizeof(*st->entries));
+			if (st->dirs == NULL) return -ERR_MEM;
+			st->entries = (nitrofs_entry_t*)&st->dirs[st->ndirs];
+		}
+	}
+
+	st->nentries = total;
+	return 0;
+}
+
+/* resolves a local path to a directory index or an entry */
+static int _nitrofs_lookup(nitrofs_state *st, const char *path, const nitrofs_entry_t **ent)
+{
+	u32 dir = 0;
+
+	*ent = NULL;
+	while(*path == '/') path++;
+
+	while(*path) {
+		const nitrofs_dir_t *d = &st->dirs[dir];
+		const nitrofs_entry_t *e = NULL;
+		size_t clen = 0;
+
+		while(path[clen] && path[clen] != '/') clen++;
+
+		for (u32 i = 0; i < d->count; i++) {
+			const nitrofs_entry_t *c = &st->entries[d->first + i];
+			if (c->name_len == clen &&
+				!strncasecmp((const char*)&st->fnt[c->name], path, clen)) {
+				e = c;
+				break;
+			}
+		}
+		if (e == NULL) return -ERR_NOTFOUND;
+
+		path += clen;
+		while(*path == '/') path++;
+
+		if (e->is_dir) {
+			dir = e->id;
+			*ent = e;
+		} else {
+			/* files can't have children */
+			if (*path) return -ERR_NOTFOUND;
+			*ent = e;
+			return 0;
+		}
+	}
+
+	return dir;
+}
+
+static inline off_t _nitrofs_fsize(nitrofs_state *st, u16 id)
+{
+	const nitrofs_fat_t *f = &st->fat[id];
+	return (f->end > f->start) ? (f->end - f->start) : 0;
+}
+
+int nitrofs_vfs_mount(mount_t *mnt)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	srl_header_t *hdr;
+	off_t rb, size;
+	int res;
+
+	st->fd = vfs_open(st->path, VFS_RO);
+	if (IS_ERR(st->fd)) return st->fd;
+
+	hdr = mem_alloc(MEM_ARCHIVE, sizeof(*hdr));
+	if (hdr == NULL) {
+		res = -ERR_MEM;
+		goto fail;
+	}
+
+	res = srl_read_header(st->fd, hdr);
+	if (IS_ERR(res)) goto fail;
+
+	size = vfs_size(st->fd);
+	if (IS_ERR(size)) {
+		res = size;
+		goto fail;
+	}
+
+	if (hdr->fnt_size == 0 || (hdr->fnt_offset + (off_t)hdr->fnt_size) > size ||
+		(hdr->fat_offset + (off_t)hdr->fat_size) > size) {
+		res = -ERR_IO;
+		goto fail;
+	}
+
+	st->fnt_size = hdr->fnt_size;
+	st->nfiles = hdr->fat_size / sizeof(nitrofs_fat_t);
+
+	/* FNT and FAT share one buffer, FAT first to keep it aligned */
+	st->fat = mem_alloc(MEM_ARCHIVE, st->nfiles * sizeof(nitrofs_fat_t) + st->fnt_size);
+	if (st->fat == NULL) {
+		res = -ERR_MEM;
+		goto fail;
+	}
+	st->fnt = (u8*)&st->fat[st->nfiles];
+
+	rb = vfs_pread(st->fd, st->fat, st->nfiles * sizeof(nitrofs_fat_t), hdr->fat_offset);
+	if (rb != (off_t)(st->nfiles * sizeof(nitrofs_fat_t))) {
+		res = IS_ERR(rb) ? rb : -ERR_IO;
+		goto fail;
+	}
+
+	rb = vfs_pread(st->fd, st->fnt, st->fnt_size, hdr->fnt_offset);
+	if (rb != st->fnt_size) {
+		res = IS_ERR(rb) ? rb : -ERR_IO;
+		goto fail;
+	}
+
+	res = _nitrofs_parse(st);
+	if (IS_ERR(res)) goto fail;
+
+	memcpy(st->label, hdr->title, 12);
+	st->label[12] = '\0';
+	if (st->label[0] == '\0') strcpy(st->label, "NitroFS");
+
+	mnt->info.label = st->label;
+	mnt->info.size = size;
+
+	mem_free(hdr);
+	return 0;
+
+fail:
+	mem_free(st->dirs);
+	mem_free(st->fat);
+	mem_free(hdr);
+	vfs_close(st->fd);
+	st->dirs = NULL;
+	st->fat = NULL;
+	return res;
+}
+
+int nitrofs_vfs_unmount(mount_t *mnt)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	int res;
+
+	res = vfs_close(st->fd);
+	if (IS_ERR(res)) return res;
+
+	mem_free(st->dirs);
+	mem_free(st->fat);
+	mem_free(st);
+	vfs_mount_free(mnt);
+	return 0;
+}
+
+int nitrofs_vfs_open(mount_t *mnt, vf_t *file, const char *path, int mode)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	const nitrofs_entry_t *ent;
+	int res;
+
+	if (mode & VFS_WO) return -ERR_ARG;
+
+	res = _nitrofs_lookup(st, path, &ent);
+	if (IS_ERR(res)) return res;
+	if (ent == NULL || ent->is_dir) return -ERR_NOTFOUND;
+
+	SET_PRIVDATA(file, (size_t)ent->id);
+	return 0;
+}
+
+int nitrofs_vfs_close(mount_t *mnt, vf_t *file)
+{
+	return 0;
+}
+
+int nitrofs_vfs_stat(mount_t *mnt, const char *path, vfs_stat_t *stat)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	const nitrofs_entry_t *ent;
+	int res;
+
+	res = _nitrofs_lookup(st, path, &ent);
+	if (IS_ERR(res)) return res;
+
+	if (ent == NULL || ent->is_dir) {
+		stat->flags = VFS_DIR | VFS_RO;
+		stat->size = 0;
+	} else {
+		stat->flags = VFS_FILE | VFS_RO;
+		stat->size = _nitrofs_fsize(st, ent->id);
+	}
+
+	stat->mtime = 0;
+	return 0;
+}
+
+off_t nitrofs_vfs_read(mount_t *mnt, vf_t *file, void *buf, off_t size)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	u16 id = GET_PRIVDATA(file, size_t);
+	off_t fsize = _nitrofs_fsize(st, id);
+
+	if (file->pos >= fsize) return 0;
+	if ((file->pos + size) > fsize)
+		size = fsize - file->pos;
+
+	/* a window onto the ROM, straight into the caller buffer */
+	return vfs_pread(st->fd, buf, size, st->fat[id].start + file->pos);
+}
+
+off_t nitrofs_vfs_size(mount_t *mnt, vf_t *file)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	return _nitrofs_fsize(st, GET_PRIVDATA(file, size_t));
+}
+
+int nitrofs_vfs_diropen(mount_t *mnt, vf_t *dir, const char *path)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	const nitrofs_entry_t *ent;
+	int res;
+
+	res = _nitrofs_lookup(st, path, &ent);
+	if (IS_ERR(res)) return res;
+	if (ent != NULL && !ent->is_dir) return -ERR_NOTFOUND;
+
+	SET_PRIVDATA(dir, (size_t)res);
+	return 0;
+}
+
+int nitrofs_vfs_dirclose(mount_t *mnt, vf_t *dir)
+{
+	return 0;
+}
+
+int nitrofs_vfs_dirnext(mount_t *mnt, vf_t *dir, dirinf_t *next)
+{
+	nitrofs_state *st = GET_PRIVDATA(mnt, nitrofs_state*);
+	const nitrofs_dir_t *d = &st->dirs[GET_PRIVDATA(dir, size_t)];
+	const nitrofs_entry_t *ent;
+
+	if (dir->pos >= d->count) return -ERR_NOTFOUND;
+	ent = &st->entries[d->first + dir->pos];
+
+	memcpy(next->path, &st->fnt[ent->name], ent->name_len);
+	next->path[ent->name_len] = '\0';
+	next->mtime = 0;
+
+	if (ent->is_dir) {
+		strcat(next->path, "/");
+		next->flags = VFS_DIR | VFS_RO;
+		next->size = 0;
+	} else {
+		next->flags = VFS_FILE | VFS_RO;
+		next->size = _nitrofs_fsize(st, ent->id);
+	}
+
+	return 0;
+}
+
+static const vfs_ops_t nitrofs_ops = {
+	.mount = nitrofs_vfs_mount,
+	.unmount = nitrofs_vfs_unmount,
+
+	.open = nitrofs_vfs_open,
+	.close = nitrofs_vfs_close,
+
+	.unlink = NULL,
+	.rename = NULL,
+	.stat = nitrofs_vfs_stat,
+
+	.read = nitrofs_vfs_read,
+	.write = NULL,
+	.size = nitrofs_vfs_size,
+
+	.mkdir = NULL,
+	.diropen = nitrofs_vfs_diropen,
+	.dirclose = nitrofs_vfs_dirclose,
+	.dirnext = nitrofs_vfs_dirnext,
+};
+
+int nitrofs_mount(char drive, const char *path)
+{
+	nitrofs_state *st;
+	mount_t *mnt;
+	int res;
+
+	if (path == NULL || strlen(path) > MAX_PATH) return -ERR_ARG;
+
+	mnt = vfs_mount_alloc();
+	if (mnt == NULL) return -ERR_MEM;
+
+	st = mem_alloc(MEM_ARCHIVE, sizeof(*st));
+	if (st == NULL) {
+		vfs_mount_free(mnt);
+		return -ERR_MEM;
+	}
+
+	memset(st, 0, sizeof(*st));
+	strcpy(st->path, path);
+
+	mnt->ops = &nitrofs_ops;
+	mnt->caps = VFS_RO;
+	SET_PRIVDATA(mnt, st);
+
+	res = vfs_mount(drive, mnt);
+	if (IS_ERR(res)) {
+		mem_free(st);
+		vfs_mount_free(mnt);
+	}
+
+	return res;
+}
@@ -0,0 +1,18 @@
+#ifndef NITROFS_H__
+#define NITROFS_H__
+
+#include <nds.h>
+
+#include "err.h"
+
+#include "vfs.h"
+
+#define NITROFS_ROOT	(0xF000)	/* first directory id */
+
+/*
+ * mounts the NitroFS contents of the NDS ROM at `path` (a global VFS path)
+ * as a read-only drive, the ROM stays open until the drive is unmounted
+ */
+int nitrofs_mount(char drive, const char *path);
+
+#endif /* NITROFS_H__ */
@@ -0,0 +1,684 @@
+#include <stdlib.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "vfs.h"
+
+#include "inflate.h"
+#include "zipfs.h"
+
+/*
+ * the central directory is read once at mount time and turned into
+ * an index sorted by path, entries and their names share one allocation
+ * with the names packed back to back (unterminated, like in pstor)
+ *
+ * directories are implied by the paths, so a directory is just
+ * the contiguous range of entries that share its prefix
+ */
+
+#define ZIP_EOCD_SIG	(0x06054B50)
+#define ZIP_CDIR_SIG	(0x02014B50)
+#define ZIP_LOCAL_SIG	(0x04034B50)
+
+#define ZIP_EOCD_SIZE	(22)
+#define ZIP_CDIR_SIZE	(46)
+#define ZIP_LOCAL_SIZE	(30)
+
+/* the EOCD is usually in the last sector, unless there's an archive comment */
+#define ZIP_TAIL_FAST	(1024)
+#define ZIP_TAIL_MAX	(ZIP_EOCD_SIZE + 0xFFFF)
+
+enum {
+	ZIP_STORED = 0,
+	ZIP_DEFLATE = 8,
+	ZIP_UNSUPP = 0xFFFF,
+};
+
+typedef struct {
+	const char *name;	/* points into the name arena, not terminated */
+	u16 name_len;
+	u16 method;
+	u32 mtime;
+	u32 csize;
+	u32 usize;
+	u32 lhdr;			/* local header offset */
+} zipfs_entry_t;
+
+typedef struct {
+	int fd;
+	off_t size;
+	char path[MAX_PATH + 1];
+	char label[16];
+
+	zipfs_entry_t *entries;
+	u32 nentries;
+} zipfs_state;
+
+typedef struct {
+	int fd;
+	const zipfs_entry_t *ent;
+	off_t data;
+
+	/* deflated entries only */
+	inflate_t *z;
+	inflate_ckpt_t *ckpt[ZIPFS_CKPT_MAX];
+	u32 nckpt;
+	off_t ckpt_next, ckpt_step;	/* next is negative once all are taken */
+} zipfs_file;
+
+/* checkpoints held by every open file together */
+static u32 zipfs_ckpts;
+
+typedef struct {
+	u32 first;	/* first entry with the directory prefix */
+	u32 cur;
+	u32 plen;
+} zipfs_dir;
+
+static inline u16 _zip_u16(const u8 *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline u32 _zip_u32(const u8 *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+/* plain lexicographic order, ignoring case like the rest of the VFS */
+static int _zipfs_cmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+	int res = strncasecmp(a, b, (alen < blen) ? alen : blen);
+	if (res) return res;
+	return (int)alen - (int)blen;
+}
+
+static int _zipfs_sortcmp(const void *a, const void *b)
+{
+	const zipfs_entry_t *ea = a, *eb = b;
+	return _zipfs_cmp(ea->name, ea->name_len, eb->name, eb->name_len);
+}
+
+static inline bool _zipfs_prefixed(const zipfs_entry_t *e, const char *pfx, size_t plen)
+{
+	return e->name_len >= plen && !strncasecmp(e->name, pfx, plen);
+}
+
+/* first entry that doesn't sort before `key` */
+static u32 _zipfs_lbound(zipfs_state *st, const char *key, size_t klen)
+{
+	u32 lo = 0, hi = st->nentries;
+
+	while(lo < hi) {
+		u32 mid = (lo + hi) / 2;
+		const zipfs_entry_t *e = &st->entries[mid];
+
+		if (_zipfs_cmp(e->name, e->name_len, key, klen) < 0) lo = mid + 1;
+		else hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * resolves a local path to the index of a file entry, or of the first
+ * entry in a directory if `dir` is set, returns the length of the match
+ */
+static int _zipfs_find(zipfs_state *st, const char *path, bool dir, u32 *idx)
+{
+	char key[MAX_PATH + 2];
+	const zipfs_entry_t *e;
+	size_t klen;
+	u32 i;
+
+	while(*path == '/') path++;
+	klen = strlen(path);
+
+	if (dir) {
+		/* the root always exists, even in an empty archive */
+		if (klen == 0) {
+			*idx = 0;
+			return 0;
+		}
+
+		memcpy(key, path, klen);
+		if (key[klen - 1] != '/') key[klen++] = '/';
+	} else {
+		if (klen == 0 || path[klen - 1] == '/') return -ERR_NOTFOUND;
+		memcpy(key, path, klen);
+	}
+
+	i = _zipfs_lbound(st, key, klen);
+	if (i >= st->nentries) return -ERR_NOTFOUND;
+
+	e = &st->entries[i];
+	if (dir) {
+		if (!_zipfs_prefixed(e, key, klen)) return -ERR_NOTFOUND;
+	} else {
+		if (_zipfs_cmp(e->name, e->name_len, key, klen)) return -ERR_NOTFOUND;
+	}
+
+	*idx = i;
+	return klen;
+}
+
+static int _zipfs_eocd(zipfs_state *st, u32 *cd_off, u32 *cd_size, u32 *count)
+{
+	const off_t tails[] = {ZIP_TAIL_FAST, ZIP_TAIL_MAX};
+	int res = -ERR_ARG;
+	u8 *buf;
+
+	buf = mem_alloc(MEM_ARCHIVE, ZIP_TAIL_MAX);
+	if (buf == NULL) return -ERR_MEM;
+
+	for (size_t t = 0; t < ARRAY_SIZE(tails) && res == -ERR_ARG; t++) {
+		off_t tail = (st->size < tails[t]) ? st->size : tails[t], rb;
+
+		rb = vfs_pread(st->fd, buf, tail, st->size - tail);
+		if (rb != tail) {
+			res = IS_ERR(rb) ? rb : -ERR_IO;
+			break;
+		}
+
+		for (off_t i = tail - ZIP_EOCD_SIZE; i >= 0; i--) {
+			const u8 *eocd = &buf[i];
+
+			if (_zip_u32(eocd) != ZIP_EOCD_SIG) continue;
+			if ((i + ZIP_EOCD_SIZE + _zip_u16(&eocd[20])) > tail) continue;
+
+			*count = _zip_u16(&eocd[10]);
+			*cd_size = _zip_u32(&eocd[12]);
+			*cd_off = _zip_u32(&eocd[16]);
+			res = 0;
+			break;
+		}
+
+		/* the whole file was already searched */
+		if (tail == st->size) break;
+	}
+
+	mem_free(buf);
+	if (IS_ERR(res)) return res;
+
+	/* ZIP64 archives mark the real values with all ones */
+	if (*count == 0xFFFF || *cd_off == 0xFFFFFFFF || *cd_size == 0xFFFFFFFF)
+		return -ERR_UNSUPP;
+
+	if ((*cd_off + (off_t)*cd_size) > st->size) return -ERR_IO;
+	return 0;
+}
+
+/* first pass counts the entries and name bytes, second one fills the arena */
+static int _zipfs_index(zipfs_state *st, const u8 *cd, u32 cd_size, u32 count)
+{
+	size_t names = 0;
+	u32 n = 0;
+
+	for (int pass = 0; pass < 2; pass++) {
+		char *arena = pass ? (char*)&st->entries[n] : NULL;
+		u32 off = 0, idx = 0;
+
+		for (u32 i = 0; i < count; i++) {
+			const u8 *h = &cd[off];
+			u16 nlen, flags, method;
+			zipfs_entry_t *e;
+
+			if ((off + ZIP_CDIR_SIZE) > cd_size || _zip_u32(h) != ZIP_CDIR_SIG)
+				return -ERR_IO;
+
+			nlen = _zip_u16(&h[28]);
+			off += ZIP_CDIR_SIZE + nlen + _zip_u16(&h[30]) + _zip_u16(&h[32]);
+			if (off > cd_size) return -ERR_IO;
+
+			/* can't be reached through a local path anyway */
+			if (nlen == 0 || nlen >= MAX_PATH || h[ZIP_CDIR_SIZE] == '/') continue;
+
+			if (pass == 0) {
+				names += nlen;
+				n++;
+				continue;
+			}
+
+			e = &st->entries[idx++];
+			memcpy(arena, &h[ZIP_CDIR_SIZE], nlen);
+			e->name = arena;
+			e->name_len = nlen;
+			arena += nlen;
+
+			flags = _zip_u16(&h[8]);
+			method = _zip_u16(&h[10]);
+			if ((flags & BIT(0)) || (method != ZIP_STORED && method != ZIP_DEFLATE))
+				method = ZIP_UNSUPP;
+
+			e->method = method;
+			e->mtime = (_zip_u16(&h[14]) << 16) | _zip_u16(&h[12]);
+			e->csize = _zip_u32(&h[20]);
+			e->usize = _zip_u32(&h[24]);
+			e->lhdr = _zip_u32(&h[42]);
+		}
+
+		if (pass == 0) {
+			st->entries = mem_alloc(MEM_ARCHIVE, n * sizeof(zipfs_entry_t) + names);
+			if (st->entries == NULL) return -ERR_MEM;
+		}
+	}
+
+	st->nentries = n;
+	qsort(st->entries, n, sizeof(zipfs_entry_t), _zipfs_sortcmp);
+	return 0;
+}
+
+int zipfs_vfs_mount(mount_t *mnt)
+{
+	zipfs_state *st = GET_PRIVDATA(mnt, zipfs_state*);
+	u32 cd_off, cd_size, count;
+	const char *base;
+	u8 *cd = NULL;
+	off_t rb;
+	int res;
+
+	st->fd = vfs_open(st->path, VFS_RO);
+	if (IS_ERR(st->fd)) return st->fd;
+
+	st->size = vfs_size(st->fd);
+	if (IS_ERR(st->size)) {
+		res = st->size;
+		goto fail;
+	}
+
+	res = _zipfs_eocd(st, &cd_off, &cd_size, &count);
+	if (IS_ERR(res)) goto fail;
+
+	cd = mem_alloc(MEM_ARCHIVE, cd_size ? cd_size : 1);
+	if (cd == NULL) {
+		res = -ERR_MEM;
+		goto fail;
+	}
+
+	rb = vfs_pread(st->fd, cd, cd_size, cd_off);
+	if (rb != cd_size) {
+		res = IS_ERR(rb) ? rb : -ERR_IO;
+		goto fail;
+	}
+
+	res = _zipfs_index(st, cd, cd_size, count);
+	if (IS_ERR(res)) goto fail;
+	mem_free(cd);
+
+	base = strrchr(st->path, '/');
+	base = base ? base + 1 : st->path;
+	strncpy(st->label, base, sizeof(st->label) - 1);
+	st->label[sizeof(st->label) - 1] = '\0';
+
+	mnt->info.label = st->label;
+	mnt->info.size = st->size;
+	return 0;
+
+fail:
+	mem_free(st->entries);
+	mem_free(cd);
+	vfs_close(st->fd);
+	st->entries = NULL;
+	return res;
+}
+
+int zipfs_vfs_unmount(mount_t *mnt)
+{
+	zipfs_state *st = GET_PRIVDATA(mnt, zipfs_state*);
+	int res;
+
+	res = vfs_close(st->fd);
+	if (IS_ERR(res)) return res;
+
+	mem_free(st->entries);
+	mem_free(st);
+	vfs_mount_free(mnt);
+	return 0;
+}
+
+static off_t _zipfs_input(void *priv, void *buf, off_t size, off_t pos)
+{
+	zipfs_file *zf = priv;
+	return vfs_pread(zf->fd, buf, size, zf->data + pos);
+}
+
+int zipfs_vfs_open(mount_t *mnt, vf_t *file, const char *path, int mode)
+{
+	zipfs_state *st = GET_PRIVDATA(mnt, zipfs_state*);
+	const zipfs_entry_t *e;
+	u8 lhdr[ZIP_LOCAL_SIZE];
+	zipfs_file *zf;
+	off_t data, rb;
+	u32 idx;
+	int res;
+
+	if (mode & VFS_WO) return -ERR_ARG;
+
+	res = _zipfs_find(st, path, false, &idx);
+	if (IS_ERR(res)) return res;
+
+	e = &st->entries[idx];
+	if (e->method == ZIP_UNSUPP) return -ERR_UNSUPP;
+
+	/* the local extra field can differ from the central one */
+	rb = vfs_pread(st->fd, lhdr, ZIP_LOCAL_SIZE, e->lhdr);
+	if (rb != ZIP_LOCAL_SIZE) return IS_ERR(rb) ? rb : -ERR_IO;
+	if (_zip_u32(lhdr) != ZIP_LOCAL_SIG) return -ERR_IO;
+
+	data = e->lhdr + ZIP_LOCAL_SIZE + _zip_u16(&lhdr[26]) + _zip_u16(&lhdr[28]);
+	if ((data + e->csize) > st->size) return -ERR_IO;
+
+	zf = mem_alloc(MEM_ARCHIVE, sizeof(*zf));
+	if (zf == NULL) return -ERR_MEM;
+
+	memset(zf, 0, sizeof(*zf));
+	zf->fd = st->fd;
+	zf->ent = e;
+	zf->data = data;
+
+	if (e->method == ZIP_DEFLATE) {
+		zf->z = mem_alloc(MEM_ARCHIVE, sizeof(inflate_t));
+		if (zf->z == NULL) {
+			mem_free(zf);
+			return -ERR_MEM;
+		}
+
+		res = inflate_init(zf->z, _zipfs_input, zf, e->csize);
+		if (IS_ERR(res)) {
+			mem_free(zf->z);
+			mem_free(zf);
+			return res;
+		}
+
+		zf->ckpt_step = e->usize / (ZIPFS_CKPT_MAX + 1);
+		if (zf->ckpt_step < ZIPFS_CKPT_MIN) zf->ckpt_step = ZIPFS_CKPT_MIN;
+		zf->ckpt_next = zf->ckpt_step;
+		inflate_mark(zf->z, zf->ckpt_next);
+	}
+
+	SET_PRIVDATA(file, zf);
+	return 0;
+}
+
+int zipfs_vfs_close(mount_t *mnt, vf_t *file)
+{
+	zipfs_file *zf = GET_PRIVDATA(file, zipfs_file*);
+
+	if (zf->z) {
+		for (u32 i = 0; i < zf->nckpt; i++)
+			mem_free(zf->ckpt[i]);
+		zipfs_ckpts -= zf->nckpt;
+		inflate_free(zf->z);
+		mem_free(zf->z);
+	}
+
+	mem_free(zf);
+	SET_PRIVDATA(file, NULL);
+	return 0;
+}
+
+int zipfs_vfs_stat(mount_t *mnt, const char *path, vfs_stat_t *stat)
+{
+	zipfs_state *st = GET_PRIVDATA(mnt, zipfs_state*);
+	u32 idx;
+
+	if (!IS_ERR(_zipfs_find(st, path, false, &idx))) {
+		const zipfs_entry_t *e = &st->entries[idx];
+
+		stat->flags = VFS_FILE | VFS_RO;
+		stat->size = e->usize;
+		stat->mtime = e->mtime;
+		return 0;
+	}
+
+	if (!IS_ERR(_zipfs_find(st, path, true, &idx))) {
+		stat->flags = VFS_DIR | VFS_RO;
+		stat->size = 0;
+		stat->mtime = 0;
+		return 0;
+	}
+
+	return -ERR_NOTFOUND;
+}
+
+/*
+ * the decoder drops its mark when it stops at the first block boundary
+ * past it, that's where a snapshot goes, unless the global cap is hit
+ * returns whether it did stop there, even if nothing could be kept
+ */
+static bool _zipfs_checkpoint(zipfs_file *zf)
+{
+	inflate_t *z = zf->z;
+	inflate_ckpt_t *ck = NULL;
+
+	if (zf->ckpt_next < 0 || z->mark >= 0) return false;
+
+	if (zipfs_ckpts < ZIPFS_CKPT_TOTAL)
+		ck = mem_alloc(MEM_ARCHIVE, sizeof(*ck));
+
+	if (ck) {
+		if (IS_ERR(inflate_save(z, ck))) {
+			mem_free(ck);
+		} else {
+			zf->ckpt[zf->nckpt++] = ck;
+			zipfs_ckpts++;
+		}
+	}
+
+	if (zf->nckpt < ZIPFS_CKPT_MAX) {
+		zf->ckpt_next = inflate_tell(z) + zf->ckpt_step;
+		inflate_mark(z, zf->ckpt_next);
+	} else {
+		zf->ckpt_next = -1;
+	}
+	return true;
+}
+
+/*
+ * serves deflated data at any position, going backwards (or far ahead)
+ * resumes from the closest checkpoint instead of the start of the stream
+ */
+static off_t _zipfs_inflate(zipfs_file *zf, u8 *buf, off_t size, off_t pos)
+{
+	inflate_t *z = zf->z;
+	inflate_ckpt_t *best = NULL;
+	off_t done = 0;
+
+	for (u32 i = 0; i < zf->nckpt; i++) {
+		off_t at = zf->ckpt[i]->out_pos;
+		if (at <= pos && (at > inflate_tell(z) || pos < inflate_tell(z)))
+			best = zf->ckpt[i];
+	}
+
+	if (best) {
+		inflate_restore(z, best);
+	} else if (pos < inflate_tell(z)) {
+		inflate_free(z);
+		if (IS_ERR(inflate_init(z, _zipfs_input, zf, zf->ent->csize)))
+			return -ERR_MEM;
+		if (zf->ckpt_next >= 0) inflate_mark(z, zf->ckpt_next);
+	}
+
+	while(done < size) {
+		off_t cur = inflate_tell(z), want, rb;
+		u8 *dst;
+
+		if (cur < pos) {
+			dst = NULL;
+			want = pos - cur;
+		} else {
+			dst = &buf[done];
+			want = size - done;
+		}
+
+		rb = inflate_read(z, dst, want);
+		if (IS_ERR(rb)) return rb;
+		if (dst) done += rb;
+
+		/* a stop for a checkpoint can come back empty, that's not the end */
+		if (_zipfs_checkpoint(zf)) continue;
+		if (rb == 0) break;
+	}
+
+	return done;
+}
+
+off_t zipfs_vfs_read(mount_t *mnt, vf_t *file, void *buf, off_t size)
+{
+	zipfs_file *zf = GET_PRIVDATA(file, zipfs_file*);
+	off_t usize = zf->ent->usize;
+
+	if (file->pos >= usize) return 0;
+	if ((file->pos + size) > usize)
+		size = usize - file->pos;
+
+	/* stored data goes straight from the archive to the caller */
+	if (zf->z == NULL)
+		return vfs_pread(zf->fd, buf, size, zf->data + file->pos);
+
+	return _zipfs_inflate(zf, buf, size, file->pos);
+}
+
+off_t zipfs_vfs_size(mount_t *mnt, vf_t *file)
+{
+	zipfs_file *zf = GET_PRIVDATA(file, zipfs_file*);
+	return zf->ent->usize;
+}
+
+int zipfs_vfs_diropen(mount_t *mnt, vf_t *dir, const char *path)
+{
+	zipfs_state *st = GET_PRIVDATA(mnt, zipfs_state*);
+	zipfs_dir *zd;
+	u32 idx;
+	int res;
+
+	res = _zipfs_find(st, path, true, &idx);
+	if (IS_ERR(res)) return res;
+
+	zd = mem_alloc(MEM_ARCHIVE, sizeof(*zd));
+	if (zd == NULL) return -ERR_MEM;
+
+	zd->first = zd->cur = idx;
+	zd->plen = res;
+	SET_PRIVDATA(dir, zd);
+	return 0;
+}
+
+int zipfs_vfs_dirclose(mount_t *mnt, vf_t *dir)
+{
+	mem_free(GET_PRIVDATA(dir, zipfs_dir*));
+	SET_PRIVDATA(dir, NULL);
+	return 0;
+}
+
+int zipfs_vfs_dirnext(mount_t *mnt, vf_t *dir, dirinf_t *next)
+{
+	zipfs_state *st = GET_PRIVDATA(mnt, zipfs_state*);
+	zipfs_dir *zd = GET_PRIVDATA(dir, zipfs_dir*);
+	const char *pfx;
+
+	if (zd->first >= st->nentries) return -ERR_NOTFOUND;
+	pfx = st->entries[zd->first].name;
+
+	while(zd->cur < st->nentries) {
+		const zipfs_entry_t *e = &st->entries[zd->cur];
+		const char *rest;
+		size_t rlen, clen = 0;
+
+		if (!_zipfs_prefixed(e, pfx, zd->plen)) break;
+
+		rest = &e->name[zd->plen];
+		rlen = e->name_len - zd->plen;
+		while(clen < rlen && rest[clen] != '/') clen++;
+
+		/* explicit entry for the directory itself */
+		if (rlen == 0) {
+			zd->cur++;
+			continue;
+		}
+
+		memcpy(next->path, rest, clen);
+		next->path[clen] = '\0';
+
+		if (clen < rlen) {
+			size_t glen = zd->plen + clen + 1;
+
+			/* everything below the subdirectory is contiguous, skip it */
+			do {
+				zd->cur++;
+			} while(zd->cur < st->nentries &&
+					_zipfs_prefixed(&st->entries[zd->cur], e->name, glen));
+
+			strcat(next->path, "/");
+			next->flags = VFS_DIR | VFS_RO;
+			next->size = 0;
+			next->mtime = (rlen == clen + 1) ? e->mtime : 0;
+		} else {
+			zd->cur++;
+			next->flags = VFS_FILE | VFS_RO;
+			next->size = e->usize;
+			next->mtime = e->mtime;
+		}
+
+		return 0;
+	}
+
+	return -ERR_NOTFOUND;
+}
+
+static const vfs_ops_t zipfs_ops = {
+	.mount = zipfs_vfs_mount,
+	.unmount = zipfs_vfs_unmount,
+
+	.open = zipfs_vfs_open,
+	.close = zipfs_vfs_close,
+
+	.unlink = NULL,
+	.rename = NULL,
+	.stat = zipfs_vfs_stat,
+
+	.read = zipfs_vfs_read,
+	.write = NULL,
+	.size = zipfs_vfs_size,
+
+	.mkdir = NULL,
+	.diropen = zipfs_vfs_diropen,
+	.dirclose = zipfs_vfs_dirclose,
+	.dirnext = zipfs_vfs_dirnext,
+};
+
+int zipfs_mount(char drive, const char *path)
+{
+	zipfs_state *st;
+	mount_t *mnt;
+	int res;
+
+	if (path == NULL || strlen(path) > MAX_PATH) return -ERR_ARG;
+
+	mnt = vfs_mount_alloc();
+	if (mnt == NULL) return -ERR_MEM;
+
+	st = mem_alloc(MEM_ARCHIVE, sizeof(*st));
+	if (st == NULL) {
+		vfs_mount_free(mnt);
+		return -ERR_MEM;
+	}
+
+	memset(st, 0, sizeof(*st));
+	strcpy(st->path, path);
+
+	mnt->ops = &zipfs_ops;
+	mnt->caps = VFS_RO;
+	SET_PRIVDATA(mnt, st);
+
+	res = vfs_mount(drive, mnt);
+	if (IS_ERR(res)) {
+		mem_free(st);
+		vfs_mount_free(mnt);
+	}
+
+	return res;
+}
@@ -0,0 +1,24 @@
+#ifndef ZIPFS_H__
+#define ZIPFS_H__
+
+#include <nds.h>
+
+#include "err.h"
+
+#include "vfs.h"
+
+/*
+ * decoder snapshots kept per deflated file for backwards seeks, each one
+ * is a whole 32 KiB window so there's also a cap across all open files
+ */
+#define ZIPFS_CKPT_MAX		(4)
+#define ZIPFS_CKPT_TOTAL	(8)
+#define ZIPFS_CKPT_MIN		(SIZE_KIB(256))	/* minimum distance between them */
+
+/*
+ * mounts the ZIP archive at `path` (a global VFS path) as a read-only drive
+ * only the central directory is read, the archive stays open until unmount
+ */
+int zipfs_mount(char drive, const char *path);
+
+#endif /* ZIPFS_H__ */
@@ -3,61 +3,302 @@
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
 
 #include "fident.h"
+#include "hash.h"
 #include "vfs.h"
 
 #include "vfs_glue.h"
 
+#define FIDENT_MAXROOTS	(16)
+
+/*
+ * the dispatch trie has one root per distinct signature offset, every
+ * node matches one byte and accumulates the handlers whose signature
+ * ends there, so a single walk over the header yields all candidates
+ */
+typedef struct {
+	u8 byte;
+	u16 child;
+	u16 next;
+	u32 accept;
+} fident_node_t;
+
+typedef struct {
+	u32 offset;
+	u16 child;
+} fident_root_t;
+
+typedef struct {
+	u32 key;
+	u32 mtime;
+	off_t size;
+	char *path;		/* the CRC only picks the slot, this is what gets compared */
+	fident_t *identity;
+	bool valid;
+} fident_cache_t;
+
+/* handlers are kept sorted by priority, lower index goes first */
 static fident_handler_t *fhandlers[MAX_FHANDLERS] = {NULL};
 static int fhandlers_count = 0;
-static size_t fhandlers_maxsize = 0;
+
+static fident_node_t fnodes[FIDENT_MAXNODES];
+static fident_root_t froots[FIDENT_MAXROOTS];
+static int fnodes_count, froots_count;
+static u32 fident_always;
+static size_t fident_hdrlen;
+static bool fident_dirty = true;
+
+static fident_cache_t fcache[FIDENT_CACHE];
+static u32 fcache_gen;
+static u8 fident_hdr[FIDENT_HDRSZ] __attribute__((aligned(4)));
+
+static u16 *_fident_root(u32 offset)
+{
+	for (int i = 0; i < froots_count; i++) {
+		if (froots[i].offset == offset)
+			return &froots[i].child;
+	}
+
+	if (froots_count == FIDENT_MAXROOTS) return NULL;
+
+	froots[froots_count].offset = offset;
+	froots[froots_count].child = 0;
+	return &froots[froots_count++].child;
+}
+
+static int _fident_insert(const fident_magic_t *magic, u32 mask)
+{
+	fident_node_t *node = NULL;
+	u16 *link;
+
+	link = _fident_root(magic->offset);
+	if (link == NULL) return -ERR_MEM;
+
+	for (size_t i = 0; i < magic->len; i++) {
+		u8 b = magic->bytes[i];
+		u16 n = *link;
+
+		while(n && fnodes[n].byte != b) n = fnodes[n].next;
+
+		if (n == 0) {
+			if (fnodes_count == FIDENT_MAXNODES) return -ERR_MEM;
+			n = fnodes_count++;
+			fnodes[n].byte = b;
+			fnodes[n].child = 0;
+			fnodes[n].accept = 0;
+			fnodes[n].next = *link;
+			*link = n;
+		}
+
+		node = &fnodes[n];
+		link = &node->child;
+	}
+
+	if (node) node->accept |= mask;
+	return 0;
+}
+
+static void _fident_compile(void)
+{
+	/* node zero is the null link */
+	fnodes_count = 1;
+	froots_count = 0;
+	fident_always = 0;
+	fident_hdrlen = 0;
+
+	for (int i = 0; i < fhandlers_count; i++) {
+		const fident_handler_t *h = fhandlers[i];
+
+		if (h->req_size > fident_hdrlen)
+			fident_hdrlen = h->req_size;
+
+		if (h->n_magic == 0)
+			fident_always |= BIT(i);
+
+		for (size_t j = 0; j < h->n_magic; j++) {
+			const fident_magic_t *m = &h->magic[j];
+
+			if (m->offset + m->len > fident_hdrlen)
+				fident_hdrlen = m->offset + m->len;
+
+			/* out of nodes, degrade gracefully to always trying it */
+			if (IS_ERR(_fident_insert(m, BIT(i))))
+				fident_always |= BIT(i);
+		}
+	}
+
+	fident_dirty = false;
+}
+
+static u32 _fident_candidates(const u8 *data, size_t len)
+{
+	u32 mask = fident_always;
+
+	for (int r = 0; r < froots_count; r++) {
+		size_t pos = froots[r].offset;
+		u16 n = froots[r].child;
+
+		while(n && pos < len) {
+			u8 b = data[pos++];
+
+			while(n && fnodes[n].byte != b) n = fnodes[n].next;
+			if (n == 0) break;
+
+			mask |= fnodes[n].accept;
+			n = fnodes[n].child;
+		}
+	}
+
+	return mask;
+}
+
+static bool _fident_ext_match(const fident_handler_t *h, const char *ext)
+{
+	const char *const *e = h->exts;
+
+	if (e == NULL || ext == NULL) return false;
+	for (; *e; e++) {
+		if (!strcasecmp(*e, ext)) return true;
+	}
+	return false;
+}
+
+static bool _fident_try(const fident_handler_t *h, fident_ctx_t *ctx)
+{
+	if (ctx->data_len < h->req_size) return false;
+	return (h->verify == NULL) || h->verify(ctx);
+}
 
 int fident_register(fident_handler_t *handler)
 {
-	int ret = fhandlers_count;
+	int i;
+
 	if (handler == NULL || fhandlers_count == MAX_FHANDLERS)
 		return -ERR_MEM;
+	if (handler->req_size > FIDENT_HDRSZ)
+		return -ERR_ARG;
+
+	for (size_t j = 0; j < handler->n_magic; j++) {
+		const fident_magic_t *m = &handler->magic[j];
+		if (m->len == 0 || (m->offset + m->len) > FIDENT_HDRSZ)
+			return -ERR_ARG;
+	}
 
-	if (handler->req_size > fhandlers_maxsize)
-		fhandlers_maxsize = handler->req_size;
+	/* insertion sort by priority, equal priorities keep registration order */
+	for (i = fhandlers_count; i > 0; i--) {
+		if (fhandlers[i - 1]->priority <= handler->priority) break;
+		fhandlers[i] = fhandlers[i - 1];
+	}
+
+	fhandlers[i] = handler;
+	fhandlers_count++;
+
+	fident_dirty = true;
+	fident_cache_flush();
+	return 0;
+}
 
-	fhandlers[fhandlers_count++] = handler;
-	return ret;
+void fident_cache_flush(void)
+{
+	for (int i = 0; i < FIDENT_CACHE; i++)
+		mem_free(fcache[i].path);
+	memset(fcache, 0, sizeof(fcache));
 }
 
 fident_t *fident_identify(const char *path)
 {
-	int fd;
-	off_t rb;
-	void *data;
+	fident_t *identity = NULL;
+	fident_cache_t *slot;
 	fident_ctx_t ctx;
+	vfs_stat_t st;
+	u32 key, mask, tried;
+	size_t plen;
+	off_t rb;
+	int fd;
 
-	fd = vfs_open(path);
-	if (IS_ERR(fd)) return 0;
+	if (path == NULL) return NULL;
 
-	data = malloc(fhandlers_maxsize);
-	if (data == NULL) {
-		vfs_close(fd);
-		return 0;
+	if (IS_ERR(vfs_stat(path, &st)) || !(st.flags & VFS_FILE))
+		return NULL;
+
+	/* without timestamps a different file can show up under the same name */
+	if (fcache_gen != vfs_generation()) {
+		fident_cache_flush();
+		fcache_gen = vfs_generation();
 	}
 
-	rb = vfs_read(fd, data, fhandlers_maxsize);
+	plen = strlen(path);
+	key = hash_crc32(0, path, plen);
+	slot = &fcache[key & (FIDENT_CACHE - 1)];
+	if (slot->valid && slot->key == key && !strcmp(slot->path, path) &&
+		slot->size == st.size && slot->mtime == st.mtime)
+		return slot->identity;
+
+	if (UNLIKELY(fident_dirty))
+		_fident_compile();
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return NULL;
+
+	/* the one and only read needed to pick a handler */
+	rb = vfs_read(fd, fident_hdr, CLAMP((off_t)fident_hdrlen, 0, st.size));
 	if (IS_ERR(rb)) {
 		vfs_close(fd);
-		free(data);
-		return 0;
+		return NULL;
 	}
 
 	ctx.path = path;
 	ctx.ext = path_extension(path);
-	ctx.data = data;
+	ctx.data = fident_hdr;
+	ctx.data_len = rb;
+	ctx.size = st.size;
 	ctx.fd = fd;
 
-	for (int i = 0; i < fhandlers_count; i++) {
-		if (fhandlers[i]->verify(&ctx))
-			return fhandlers[i]->identity;
+	mask = _fident_candidates(fident_hdr, rb);
+	tried = 0;
+
+	/* extension hints go first, as long as they can prove themselves */
+	if (ctx.ext) {
+		for (int i = 0; i < fhandlers_count; i++) {
+			const fident_handler_t *h = fhandlers[i];
+
+			if (!_fident_ext_match(h, ctx.ext)) continue;
+			if (h->verify == NULL && !(mask & BIT(i))) continue;
+
+			tried |= BIT(i);
+			if (_fident_try(h, &ctx)) {
+				identity = h->identity;
+				goto done;
+			}
+		}
 	}
 
-	return NULL;
+	mask &= ~tried;
+	while(mask) {
+		int i = __builtin_ctz(mask);
+		mask &= ~BIT(i);
+
+		if (_fident_try(fhandlers[i], &ctx)) {
+			identity = fhandlers[i]->identity;
+			break;
+		}
+	}
+
+done:
+	vfs_close(fd);
+
+	mem_free(slot->path);
+	slot->valid = false;
+	slot->path = mem_alloc(MEM_FORMAT, plen + 1);
+	if (slot->path == NULL) return identity;
+
+	memcpy(slot->path, path, plen + 1);
+	slot->key = key;
+	slot->size = st.size;
+	slot->mtime = st.mtime;
+	slot->identity = identity;
+	slot->valid = true;
+	return identity;
 }
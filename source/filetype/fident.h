@@ -1,32 +1,64 @@
 #ifndef FILEIDENT_H__
 #define FILEIDENT_H__
 
-#define MAX_FHANDLERS (4)
+#include <nds.h>
+
+#include "vfs.h"
+
+#define MAX_FHANDLERS	(32)	/* one bit per handler in the candidate mask */
+#define FIDENT_HDRSZ	(512)	/* shared header buffer size, largest req_size */
+#define FIDENT_MAXNODES	(512)	/* dispatch trie node pool */
+#define FIDENT_CACHE	(256)	/* identification cache entries, power of two */
 
 typedef int (*fident_handle_t)(const char *path);
+typedef int (*fident_mount_t)(char drive, const char *path);
 
 typedef struct {
 	const char *type_name;		/** Type name */
 	fident_handle_t handler;	/** Handler function */
+	fident_mount_t mount;		/** Mounts the file as a drive, NULL if not a container */
 } fident_t;
 
 typedef struct {
 	const char *path;	/** File path */
-	const char *ext;	/** File extension */
+	const char *ext;	/** File extension, NULL if none */
 	const void *data;	/** First bytes of the file, at least req_size */
+	size_t data_len;	/** Amount of valid bytes in `data` */
+	off_t size;			/** File size */
 	int fd;				/** Already open file descriptor */
 } fident_ctx_t;
 
 typedef int (*fident_verify_t)(fident_ctx_t*);
 
+typedef struct {
+	u32 offset;			/** Offset of the signature in the file */
+	size_t len;			/** Signature length */
+	const u8 *bytes;	/** Signature bytes */
+} fident_magic_t;
+
 typedef struct {
 	u32 priority;			/** Handler priority, lower priority goes first */
 	size_t req_size;		/** Required buffer size */
-	fident_verify_t verify;	/** Verification function */
+
+	const fident_magic_t *magic;	/** Signatures, any of them makes it a candidate */
+	size_t n_magic;					/** Signature count, zero to always be a candidate */
+	const char *const *exts;		/** NULL terminated list of extension hints */
+
+	fident_verify_t verify;	/** Verification function, NULL if the magic suffices */
 	fident_t *identity;		/** Identity structure */
 } fident_handler_t;
 
+/* registers a new handler, the dispatch trie is rebuilt on the next lookup */
 int fident_register(fident_handler_t *handler);
+
+/*
+ * identifies the file at `path`
+ * results are cached by (path, size, mtime) so repeated lookups only stat,
+ * the cache starts over whenever vfs_generation moves
+ */
 fident_t *fident_identify(const char *path);
 
+/* drops every cached identification */
+void fident_cache_flush(void);
+
 #endif /* FILEIDENT_H__ */
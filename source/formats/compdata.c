@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <strings.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "bioscomp.h"
+#include "fident.h"
+#include "hash.h"
+#include "ui.h"
+#include "vfs.h"
+
+#include "compdata.h"
+
+static void compdata_progress(off_t cur, off_t tot, void *priv)
+{
+	ui_progress(cur >> 10, tot >> 10, "KiB", (const char*)priv);
+}
+
+/* shows what's inside and hashes the decompressed data */
+static int compdata_view(const char *path)
+{
+	char msg[160], sha1[SHA1_DIGEST_SIZE * 2 + 1];
+	hash_result_t hres;
+	u8 hdr[4];
+	off_t csize, usize;
+	int fd, type, res;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	csize = vfs_size(fd);
+	res = vfs_pread(fd, hdr, sizeof(hdr), 0);
+	vfs_close(fd);
+	if (res != sizeof(hdr)) return IS_ERR(res) ? res : -ERR_IO;
+
+	type = bioscomp_type(hdr, csize);
+	if (IS_ERR(type)) return type;
+
+	fd = vfs_open(path, VFS_RO | VFS_UNPACK);
+	if (IS_ERR(fd)) return fd;
+
+	usize = vfs_size(fd);
+	res = hash_fd(fd, HASH_CRC32 | HASH_SHA1, &hres, compdata_progress, "Decompressing...");
+	ui_progress(1, 0, NULL, NULL);
+	vfs_close(fd);
+	if (IS_ERR(res)) return res;
+
+	hash_hexstr(sha1, hres.sha1, SHA1_DIGEST_SIZE);
+	sprintf(msg, "%s compressed\n%lld -> %lld bytes\n\nCRC32: %08lX\nSHA-1:\n%.20s\n%s",
+		bioscomp_name(type), csize, usize, (unsigned long)hres.crc32, sha1, &sha1[20]);
+	ui_msg(msg);
+	return 0;
+}
+
+static fident_t compdata_identity = {
+	.type_name = "compressed data",
+	.handler = compdata_view,
+};
+
+static const char *const compdata_exts[] = {"lz", "lz77", "cmp", "rle", NULL};
+
+/*
+ * a single type byte is a weak signature, plenty of unrelated files
+ * start with one, so it only counts with one of the extensions above
+ */
+static int compdata_verify(fident_ctx_t *ctx)
+{
+	const char *const *e;
+
+	if (ctx->ext == NULL) return 0;
+	for (e = compdata_exts; *e; e++) {
+		if (!strcasecmp(*e, ctx->ext)) break;
+	}
+	if (*e == NULL) return 0;
+
+	return !IS_ERR(bioscomp_type(ctx->data, ctx->size));
+}
+
+static const u8 compdata_types[] = {
+	BIOSCOMP_LZ10, BIOSCOMP_LZ11, BIOSCOMP_HUFF4, BIOSCOMP_HUFF8, BIOSCOMP_RLE
+};
+
+static const fident_magic_t compdata_magic[] = {
+	{.offset = 0, .len = 1, .bytes = &compdata_types[0]},
+	{.offset = 0, .len = 1, .bytes = &compdata_types[1]},
+	{.offset = 0, .len = 1, .bytes = &compdata_types[2]},
+	{.offset = 0, .len = 1, .bytes = &compdata_types[3]},
+	{.offset = 0, .len = 1, .bytes = &compdata_types[4]},
+};
+
+/* after every other handler, lower values are tried first */
+static fident_handler_t compdata_handler = {
+	.priority = 100,
+	.req_size = 4,
+	.magic = compdata_magic,
+	.n_magic = ARRAY_SIZE(compdata_magic),
+	.exts = compdata_exts,
+	.verify = compdata_verify,
+	.identity = &compdata_identity,
+};
+
+int compdata_register(void)
+{
+	vfs_set_unpack(bioscomp_vfs_wrap);
+	return fident_register(&compdata_handler);
+}
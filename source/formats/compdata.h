@@ -0,0 +1,9 @@
+#ifndef COMPDATA_H__
+#define COMPDATA_H__
+
+#include <nds.h>
+
+/* registers the BIOS compressed data identification handler */
+int compdata_register(void);
+
+#endif /* COMPDATA_H__ */
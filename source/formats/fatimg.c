@@ -0,0 +1,55 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "fident.h"
+
+#include "loop.h"
+#include "fatimg.h"
+
+#define FATIMG_SIG_OFF	(0x1FE)
+#define FATIMG_PART0	(0x1BE)	/* first MBR partition entry */
+
+static fident_t fatimg_identity = {
+	.type_name = "FAT image",
+	.mount = loop_mount,
+};
+
+/*
+ * the boot signature alone is too weak, either a VBR (x86 jump)
+ * or an MBR with a used first partition entry is required on top
+ *
+ * extension hints skip the magic match, so the signature is checked here too
+ */
+static int fatimg_verify(fident_ctx_t *ctx)
+{
+	const u8 *sect = ctx->data;
+
+	if (sect[FATIMG_SIG_OFF] != 0x55 || sect[FATIMG_SIG_OFF + 1] != 0xAA) return 0;
+	if (sect[0] == 0xEB || sect[0] == 0xE9) return 1;
+	return (sect[FATIMG_PART0] & 0x7F) == 0 && sect[FATIMG_PART0 + 4] != 0;
+}
+
+static const u8 fatimg_sig[] = {0x55, 0xAA};
+
+static const fident_magic_t fatimg_magic[] = {
+	{.offset = FATIMG_SIG_OFF, .len = sizeof(fatimg_sig), .bytes = fatimg_sig},
+};
+
+static const char *const fatimg_exts[] = {"img", "ima", "fat", NULL};
+
+static fident_handler_t fatimg_handler = {
+	.priority = 50,
+	.req_size = 512,
+	.magic = fatimg_magic,
+	.n_magic = ARRAY_SIZE(fatimg_magic),
+	.exts = fatimg_exts,
+	.verify = fatimg_verify,
+	.identity = &fatimg_identity,
+};
+
+int fatimg_register(void)
+{
+	return fident_register(&fatimg_handler);
+}
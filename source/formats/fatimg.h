@@ -0,0 +1,9 @@
+#ifndef FATIMG_H__
+#define FATIMG_H__
+
+#include <nds.h>
+
+/* registers the FAT disk image identification handler */
+int fatimg_register(void);
+
+#endif /* FATIMG_H__ */
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "fident.h"
+#include "ui.h"
+#include "vfs.h"
+
+#include "gba.h"
+
+_Static_assert(sizeof(gba_header_t) == GBA_HDR_SIZE, "bad gba header layout");
+
+/* bytes carried over between chunks, must fit the longest ID and stay aligned */
+#define GBA_SAVEID_MAX	(16)
+
+/* little endian word made of four chars */
+#define GBA_WORD(a, b, c, d)	((u32)(a) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
+
+typedef struct {
+	const char *id;
+	size_t len;
+	u32 word;
+	int type;
+} gba_saveid_t;
+
+/* library IDs are always word aligned in the ROM image */
+static const gba_saveid_t gba_saveids[] = {
+	{"EEPROM_V", 8, GBA_WORD('E', 'E', 'P', 'R'), GBA_SAVE_EEPROM},
+	{"SRAM_V", 6, GBA_WORD('S', 'R', 'A', 'M'), GBA_SAVE_SRAM},
+	{"SRAM_F_V", 8, GBA_WORD('S', 'R', 'A', 'M'), GBA_SAVE_SRAM},
+	{"FLASH_V", 7, GBA_WORD('F', 'L', 'A', 'S'), GBA_SAVE_FLASH512},
+	{"FLASH512_V", 10, GBA_WORD('F', 'L', 'A', 'S'), GBA_SAVE_FLASH512},
+	{"FLASH1M_V", 9, GBA_WORD('F', 'L', 'A', 'S'), GBA_SAVE_FLASH1M},
+};
+
+static const char *gba_save_names[GBA_SAVE_COUNT] = {
+	[GBA_SAVE_NONE]		= "none",
+	[GBA_SAVE_EEPROM]	= "EEPROM",
+	[GBA_SAVE_SRAM]		= "SRAM",
+	[GBA_SAVE_FLASH512]	= "Flash 512Kbit",
+	[GBA_SAVE_FLASH1M]	= "Flash 1Mbit",
+};
+
+int gba_parse_header(const gba_header_t *hdr)
+{
+	const u8 *raw = (const u8*)hdr;
+	int status = 0;
+	u8 chk = 0;
+
+	for (int i = 0xA0; i < 0xBD; i++)
+		chk -= raw[i];
+	chk -= 0x19;
+
+	if (chk == hdr->complement) status |= GBA_HDR_OK;
+	if (hdr->fixed == GBA_FIXED_VAL) status |= GBA_FIXED_OK;
+	return status;
+}
+
+int gba_read_header(int fd, gba_header_t *hdr)
+{
+	off_t rb = vfs_pread(fd, hdr, GBA_HDR_SIZE, 0);
+	if (IS_ERR(rb)) return rb;
+	if (rb != GBA_HDR_SIZE) return -ERR_IO;
+	return gba_parse_header(hdr);
+}
+
+/*
+ * scans the aligned words in [0, limit) of `buf`, which holds `have` bytes
+ * a single compare against the three possible first words rejects
+ * nearly everything, the full ID is only checked on a hit
+ */
+static int _gba_scan(const u8 *buf, size_t limit, size_t have)
+{
+	const u32 *w = (const u32*)buf;
+	size_t nw = limit / 4;
+
+	for (size_t i = 0; i < nw; i++) {
+		u32 v = w[i];
+
+		if (LIKELY(v != GBA_WORD('E', 'E', 'P', 'R') &&
+			v != GBA_WORD('S', 'R', 'A', 'M') &&
+			v != GBA_WORD('F', 'L', 'A', 'S')))
+			continue;
+
+		for (size_t j = 0; j < ARRAY_SIZE(gba_saveids); j++) {
+			const gba_saveid_t *sid = &gba_saveids[j];
+
+			if (sid->word != v || (i * 4 + sid->len) > have) continue;
+			if (!memcmp(&buf[i * 4], sid->id, sid->len))
+				return sid->type;
+		}
+	}
+
+	return GBA_SAVE_NONE;
+}
+
+int gba_save_type(int fd, gba_progress_fn progress, void *priv)
+{
+	int type = GBA_SAVE_NONE;
+	size_t have = 0;
+	off_t size, pos = 0;
+	u8 *buf;
+
+	size = vfs_size(fd);
+	if (IS_ERR(size)) return size;
+
+	/* room for the worst case carry on top of a full chunk */
+	buf = mem_alloc(MEM_FORMAT, (GBA_SAVEID_MAX * 2) + GBA_SCANBUF);
+	if (buf == NULL) return -ERR_MEM;
+
+	while(pos < size) {
+		size_t limit;
+		off_t rb;
+		bool eof;
+
+		rb = vfs_pread(fd, &buf[have], GBA_SCANBUF, pos);
+		if (rb <= 0) {
+			type = IS_ERR(rb) ? rb : -ERR_IO;
+			break;
+		}
+
+		pos += rb;
+		have += rb;
+		eof = (pos >= size);
+
+		/* the tail might hold a split ID, keep it for the next chunk */
+		if (eof) limit = have;
+		else if (have > GBA_SAVEID_MAX) limit = (have - GBA_SAVEID_MAX) & ~3;
+		else limit = 0;
+
+		type = _gba_scan(buf, limit, have);
+		if (type != GBA_SAVE_NONE) break;
+
+		memmove(buf, &buf[limit], have - limit);
+		have -= limit;
+
+		if (progress) progress(pos, size, priv);
+	}
+
+	mem_free(buf);
+	return type;
+}
+
+const char *gba_save_name(int type)
+{
+	if (type < 0 || type >= GBA_SAVE_COUNT) return "unknown";
+	return gba_save_names[type];
+}
+
+static void gba_scan_progress(off_t cur, off_t tot, void *priv)
+{
+	ui_progress(cur >> 10, tot >> 10, "KiB", (const char*)priv);
+}
+
+static int gba_view(const char *path)
+{
+	gba_header_t *hdr;
+	char msg[128];
+	int fd, res, save;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	hdr = mem_alloc(MEM_FORMAT, sizeof(*hdr));
+	if (hdr == NULL) {
+		vfs_close(fd);
+		return -ERR_MEM;
+	}
+
+	res = gba_read_header(fd, hdr);
+	if (!IS_ERR(res)) {
+		save = gba_save_type(fd, gba_scan_progress, "Scanning save type...");
+		ui_progress(1, 0, NULL, NULL);
+
+		sprintf(msg, "%.12s\nCode: %.4s  Maker: %.2s\n\nHeader check: %s\nSave: %s",
+			hdr->title, hdr->gamecode, hdr->makercode,
+			(res & GBA_HDR_OK) ? "OK" : "BAD",
+			IS_ERR(save) ? err_getstr(save) : gba_save_name(save));
+		ui_msg(msg);
+	}
+
+	mem_free(hdr);
+	vfs_close(fd);
+	return res;
+}
+
+static fident_t gba_identity = {
+	.type_name = "GBA ROM",
+	.handler = gba_view,
+};
+
+static int gba_verify(fident_ctx_t *ctx)
+{
+	int status = gba_parse_header(ctx->data);
+	return (status & (GBA_HDR_OK | GBA_FIXED_OK)) == (GBA_HDR_OK | GBA_FIXED_OK);
+}
+
+/* start of the compressed Nintendo logo, shared by every retail ROM */
+static const u8 gba_logo[] = {0x24, 0xFF, 0xAE, 0x51, 0x69, 0x9A, 0xA2, 0x21};
+static const u8 gba_fixed[] = {GBA_FIXED_VAL};
+
+static const fident_magic_t gba_magic[] = {
+	{.offset = 0x04, .len = sizeof(gba_logo), .bytes = gba_logo},
+	{.offset = 0xB2, .len = sizeof(gba_fixed), .bytes = gba_fixed},
+};
+
+static const char *const gba_exts[] = {"gba", "agb", "mb", NULL};
+
+static fident_handler_t gba_handler = {
+	.priority = 20,
+	.req_size = GBA_HDR_SIZE,
+	.magic = gba_magic,
+	.n_magic = ARRAY_SIZE(gba_magic),
+	.exts = gba_exts,
+	.verify = gba_verify,
+	.identity = &gba_identity,
+};
+
+int gba_register(void)
+{
+	return fident_register(&gba_handler);
+}
@@ -0,0 +1,65 @@
+#ifndef GBA_H__
+#define GBA_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+#define GBA_HDR_SIZE	(0xC0)
+#define GBA_LOGO_SIZE	(0x9C)
+#define GBA_FIXED_VAL	(0x96)
+
+/* chunk size for the save type scan */
+#define GBA_SCANBUF		(SIZE_KIB(64))
+
+/* validation results, as returned by gba_parse_header */
+enum {
+	GBA_HDR_OK		= BIT(0),	/**< Complement check matches */
+	GBA_FIXED_OK	= BIT(1),	/**< Fixed value at 0xB2 is present */
+};
+
+enum {
+	GBA_SAVE_NONE = 0,
+	GBA_SAVE_EEPROM,
+	GBA_SAVE_SRAM,
+	GBA_SAVE_FLASH512,
+	GBA_SAVE_FLASH1M,
+	GBA_SAVE_COUNT
+};
+
+typedef struct {
+	u32 entry;
+	u8 logo[GBA_LOGO_SIZE];
+	char title[12];
+	char gamecode[4];
+	char makercode[2];
+	u8 fixed;
+	u8 unitcode;
+	u8 devtype;
+	u8 reserved0[7];
+	u8 version;
+	u8 complement;
+	u8 reserved1[2];
+} __attribute__((packed, aligned(4))) gba_header_t;
+
+typedef void (*gba_progress_fn)(off_t cur, off_t tot, void *priv);
+
+/* validates a raw header, returns a mask of GBA_HDR_OK / GBA_FIXED_OK */
+int gba_parse_header(const gba_header_t *hdr);
+
+/* reads and validates the header with a single positional read */
+int gba_read_header(int fd, gba_header_t *hdr);
+
+/*
+ * detects the save type by looking for the library ID strings
+ * in a single sequential pass, returns one of GBA_SAVE_*
+ */
+int gba_save_type(int fd, gba_progress_fn progress, void *priv);
+
+/* human readable save type name */
+const char *gba_save_name(int type);
+
+/* registers the GBA ROM identification handler */
+int gba_register(void);
+
+#endif /* GBA_H__ */
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "fident.h"
+#include "hash.h"
+#include "ui.h"
+#include "vfs.h"
+
+#include "nitrofs.h"
+#include "srl.h"
+
+_Static_assert(sizeof(srl_header_t) == SRL_HDR_SIZE, "bad srl header layout");
+
+/* the icon region that is read in one go, tiles followed by the palette */
+#define SRL_ICON_READSZ	(sizeof(srl_icon_t))
+
+int srl_parse_header(const srl_header_t *hdr)
+{
+	int status = 0;
+	u16 crc;
+
+	crc = hash_crc16(0xFFFF, hdr, SRL_HDR_CRC_LEN);
+	if (crc == hdr->header_crc) status |= SRL_HDR_OK;
+
+	crc = hash_crc16(0xFFFF, hdr->logo, SRL_LOGO_SIZE);
+	if (crc == hdr->logo_crc && crc == SRL_LOGO_CRC) status |= SRL_LOGO_OK;
+
+	if (hdr->banner_offset != 0) status |= SRL_HAS_BANNER;
+	return status;
+}
+
+int srl_read_header(int fd, srl_header_t *hdr)
+{
+	off_t rb = vfs_pread(fd, hdr, SRL_HDR_SIZE, 0);
+	if (IS_ERR(rb)) return rb;
+	if (rb != SRL_HDR_SIZE) return -ERR_IO;
+	return srl_parse_header(hdr);
+}
+
+int srl_read_icon(int fd, const srl_header_t *hdr, srl_icon_t *icon)
+{
+	off_t rb;
+
+	if (hdr->banner_offset == 0) return -ERR_NOTFOUND;
+
+	rb = vfs_pread(fd, icon, SRL_ICON_READSZ, hdr->banner_offset + SRL_ICON_OFFSET);
+	if (IS_ERR(rb)) return rb;
+	if (rb != SRL_ICON_READSZ) return -ERR_IO;
+	return 0;
+}
+
+int srl_read_title(int fd, const srl_header_t *hdr, int lang, char *out, size_t max)
+{
+	u16 title[SRL_TITLE_CHARS];
+	size_t i, len;
+	off_t rb;
+
+	if (max == 0) return -ERR_ARG;
+	if (lang < 0 || lang >= SRL_LANGS) return -ERR_ARG;
+	if (hdr->banner_offset == 0) return -ERR_NOTFOUND;
+
+	rb = vfs_pread(fd, title, sizeof(title),
+		hdr->banner_offset + SRL_TITLE_OFFSET + lang * sizeof(title));
+	if (IS_ERR(rb)) return rb;
+
+	len = rb / sizeof(u16);
+	for (i = 0; i < len && i < (max - 1); i++) {
+		u16 c = title[i];
+		if (c == 0) break;
+		out[i] = (c == '\n' || (c >= 0x20 && c < 0x7F)) ? c : '?';
+	}
+
+	out[i] = '\0';
+	return i;
+}
+
+int srl_check_banner(int fd, const srl_header_t *hdr)
+{
+	u8 *banner;
+	off_t rb;
+	int res;
+
+	if (hdr->banner_offset == 0) return -ERR_NOTFOUND;
+
+	banner = mem_alloc(MEM_FORMAT, SRL_BANNER_SIZE);
+	if (banner == NULL) return -ERR_MEM;
+
+	rb = vfs_pread(fd, banner, SRL_BANNER_SIZE, hdr->banner_offset);
+	if (IS_ERR(rb)) {
+		res = rb;
+	} else if (rb != SRL_BANNER_SIZE) {
+		res = -ERR_IO;
+	} else {
+		u16 crc = hash_crc16(0xFFFF, &banner[SRL_ICON_OFFSET], SRL_BANNER_CRC_LEN);
+		res = (crc == (banner[2] | (banner[3] << 8))) ? 1 : 0;
+	}
+
+	mem_free(banner);
+	return res;
+}
+
+int srl_preview(const char *path, vu16 *map, int screen, size_t x, size_t y)
+{
+	srl_header_t *hdr;
+	srl_icon_t *icon;
+	char title[SRL_TITLE_CHARS];
+	int fd, res;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	hdr = mem_alloc(MEM_FORMAT, sizeof(*hdr) + sizeof(*icon));
+	if (hdr == NULL) {
+		vfs_close(fd);
+		return -ERR_MEM;
+	}
+	icon = (srl_icon_t*)(hdr + 1);
+
+	/* only the header, icon and one title are ever touched */
+	res = srl_read_header(fd, hdr);
+	if (!IS_ERR(res) && !(res & SRL_HAS_BANNER)) res = -ERR_NOTFOUND;
+	if (!IS_ERR(res)) res = srl_read_icon(fd, hdr, icon);
+	if (!IS_ERR(res)) res = srl_read_title(fd, hdr, SRL_LANG_EN, title, sizeof(title));
+
+	if (!IS_ERR(res)) {
+		ui_icon_load(screen, 0, icon->tiles, icon->pal);
+		ui_drawicon(map, 0, x, y);
+		ui_drawstr(map, x + UI_ICON_DIM + 1, y, title);
+	}
+
+	mem_free(hdr);
+	vfs_close(fd);
+	return res;
+}
+
+static int srl_view(const char *path)
+{
+	vu16 *map = ui_map(SUBSCR, BG_INFO);
+	srl_header_t *hdr;
+	char msg[128];
+	int fd, res;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	hdr = mem_alloc(MEM_FORMAT, sizeof(*hdr));
+	if (hdr == NULL) {
+		vfs_close(fd);
+		return -ERR_MEM;
+	}
+
+	res = srl_read_header(fd, hdr);
+	if (!IS_ERR(res)) {
+		sprintf(msg, "%.12s\nCode: %.4s  Maker: %.2s\n\nHeader CRC: %s\nLogo CRC: %s",
+			hdr->title, hdr->gamecode, hdr->makercode,
+			(res & SRL_HDR_OK) ? "OK" : "BAD", (res & SRL_LOGO_OK) ? "OK" : "BAD");
+
+		vfs_close(fd);
+		srl_preview(path, map, SUBSCR, 1, 1);
+		ui_msg(msg);
+		ui_tilemap_clr(map);
+	} else {
+		vfs_close(fd);
+	}
+
+	mem_free(hdr);
+	return res;
+}
+
+static fident_t srl_identity = {
+	.type_name = "NDS ROM",
+	.handler = srl_view,
+	.mount = nitrofs_mount,
+};
+
+static int srl_verify(fident_ctx_t *ctx)
+{
+	return (srl_parse_header(ctx->data) & SRL_HDR_OK) != 0;
+}
+
+static const u8 srl_logo_crc[] = {SRL_LOGO_CRC & 0xFF, SRL_LOGO_CRC >> 8};
+
+static const fident_magic_t srl_magic[] = {
+	{.offset = 0x15C, .len = sizeof(srl_logo_crc), .bytes = srl_logo_crc},
+};
+
+static const char *const srl_exts[] = {"nds", "srl", "dsi", "ids", NULL};
+
+static fident_handler_t srl_handler = {
+	.priority = 10,
+	.req_size = SRL_HDR_SIZE,
+	.magic = srl_magic,
+	.n_magic = ARRAY_SIZE(srl_magic),
+	.exts = srl_exts,
+	.verify = srl_verify,
+	.identity = &srl_identity,
+};
+
+int srl_register(void)
+{
+	return fident_register(&srl_handler);
+}
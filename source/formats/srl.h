@@ -0,0 +1,125 @@
+#ifndef SRL_H__
+#define SRL_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+#define SRL_HDR_SIZE		(0x200)
+#define SRL_HDR_CRC_LEN		(0x15E)
+#define SRL_LOGO_SIZE		(0x9C)
+#define SRL_LOGO_CRC		(0xCF56)
+
+#define SRL_ICON_OFFSET		(0x20)
+#define SRL_ICON_TILESZ		(0x200)
+#define SRL_TITLE_OFFSET	(0x240)
+#define SRL_TITLE_CHARS		(0x80)
+#define SRL_BANNER_CRC_LEN	(0x820)
+#define SRL_BANNER_SIZE		(0x840)
+
+enum {
+	SRL_LANG_JP = 0,
+	SRL_LANG_EN,
+	SRL_LANG_FR,
+	SRL_LANG_DE,
+	SRL_LANG_IT,
+	SRL_LANG_ES,
+	SRL_LANGS
+};
+
+/* validation results, as returned by srl_parse_header */
+enum {
+	SRL_HDR_OK		= BIT(0),	/**< Header CRC16 matches */
+	SRL_LOGO_OK		= BIT(1),	/**< Logo CRC16 matches the stored and known CRC */
+	SRL_HAS_BANNER	= BIT(2),	/**< Banner offset is set */
+};
+
+typedef struct {
+	u32 rom_offset;
+	u32 entry;
+	u32 ram_addr;
+	u32 size;
+} srl_bin_t;
+
+typedef struct {
+	char title[12];
+	char gamecode[4];
+	char makercode[2];
+	u8 unitcode;
+	u8 seed_select;
+	u8 capacity;
+	u8 reserved0[8];
+	u8 region;
+	u8 version;
+	u8 autostart;
+
+	srl_bin_t arm9;
+	srl_bin_t arm7;
+
+	u32 fnt_offset;
+	u32 fnt_size;
+	u32 fat_offset;
+	u32 fat_size;
+
+	u32 arm9_ovl_offset;
+	u32 arm9_ovl_size;
+	u32 arm7_ovl_offset;
+	u32 arm7_ovl_size;
+
+	u32 normal_cmd;
+	u32 key1_cmd;
+	u32 banner_offset;
+	u16 secure_crc;
+	u16 secure_delay;
+	u32 arm9_autoload;
+	u32 arm7_autoload;
+	u64 secure_disable;
+	u32 rom_used;
+	u32 header_size;
+	u8 reserved1[0x38];
+
+	u8 logo[SRL_LOGO_SIZE];
+	u16 logo_crc;
+	u16 header_crc;
+
+	u8 reserved2[SRL_HDR_SIZE - 0x160];
+} __attribute__((packed, aligned(4))) srl_header_t;
+
+/* icon data in the banner layout, which is also the VRAM layout */
+typedef struct {
+	u8 tiles[SRL_ICON_TILESZ];
+	u16 pal[16];
+} __attribute__((aligned(4))) srl_icon_t;
+
+/*
+ * validates a raw header buffer of at least SRL_HDR_SIZE bytes
+ * returns a mask of SRL_HDR_OK / SRL_LOGO_OK / SRL_HAS_BANNER
+ * doesn't do any I/O, so it can be fed sample headers directly
+ */
+int srl_parse_header(const srl_header_t *hdr);
+
+/* reads and validates the header with a single positional read */
+int srl_read_header(int fd, srl_header_t *hdr);
+
+/*
+ * reads only the icon tiles + palette from the banner, lazily
+ * the result can be uploaded as-is with ui_icon_load
+ */
+int srl_read_icon(int fd, const srl_header_t *hdr, srl_icon_t *icon);
+
+/*
+ * reads a single banner title and converts it to printable ASCII,
+ * characters outside the font range get replaced by '?'
+ */
+int srl_read_title(int fd, const srl_header_t *hdr, int lang, char *out, size_t max);
+
+/* checks the banner CRC16, reading the whole banner */
+int srl_check_banner(int fd, const srl_header_t *hdr);
+
+/* draws the icon and title of the ROM at `path` on `map`, if it has any */
+int srl_preview(const char *path, vu16 *map, int screen, size_t x, size_t y);
+
+/* registers the NDS ROM identification handler */
+int srl_register(void);
+
+#endif /* SRL_H__ */
@@ -0,0 +1,40 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "fident.h"
+
+#include "zipfs.h"
+#include "zip.h"
+
+static fident_t zip_identity = {
+	.type_name = "ZIP archive",
+	.mount = zipfs_mount,
+};
+
+/* a local file header, or the end of central directory of an empty archive */
+static const u8 zip_local[] = {'P', 'K', 0x03, 0x04};
+static const u8 zip_empty[] = {'P', 'K', 0x05, 0x06};
+
+static const fident_magic_t zip_magic[] = {
+	{.offset = 0, .len = sizeof(zip_local), .bytes = zip_local},
+	{.offset = 0, .len = sizeof(zip_empty), .bytes = zip_empty},
+};
+
+static const char *const zip_exts[] = {"zip", NULL};
+
+static fident_handler_t zip_handler = {
+	.priority = 30,
+	.req_size = sizeof(zip_local),
+	.magic = zip_magic,
+	.n_magic = ARRAY_SIZE(zip_magic),
+	.exts = zip_exts,
+	.verify = NULL,
+	.identity = &zip_identity,
+};
+
+int zip_register(void)
+{
+	return fident_register(&zip_handler);
+}
@@ -0,0 +1,9 @@
+#ifndef ZIP_H__
+#define ZIP_H__
+
+#include <nds.h>
+
+/* registers the ZIP archive identification handler */
+int zip_register(void);
+
+#endif /* ZIP_H__ */
@@ -0,0 +1,272 @@
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+#include "arena.h"
+
+#include "vfs.h"
+
+#include "hash.h"
+
+u16 _crc16_tbl[256];
+u32 _crc32_tbl[8][256];
+
+static const u32 sha1_iv[5] = {
+	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0,
+};
+
+static const u32 sha256_iv[8] = {
+	0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+	0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+static void __attribute__((constructor)) __hash_ctor(void)
+{
+	for (int i = 0; i < 256; i++) {
+		u16 c16 = i;
+		u32 c32 = i;
+
+		for (int j = 0; j < 8; j++) {
+			c16 = (c16 & 1) ? ((c16 >> 1) ^ 0xA001) : (c16 >> 1);
+			c32 = (c32 & 1) ? ((c32 >> 1) ^ 0xEDB88320) : (c32 >> 1);
+		}
+
+		_crc16_tbl[i] = c16;
+		_crc32_tbl[0][i] = c32;
+	}
+
+	/* every slice advances the previous one by another zero byte */
+	for (int i = 0; i < 256; i++) {
+		u32 c = _crc32_tbl[0][i];
+		for (int s = 1; s < 8; s++) {
+			c = (c >> 8) ^ _crc32_tbl[0][c & 0xFF];
+			_crc32_tbl[s][i] = c;
+		}
+	}
+}
+
+static void _sha_init(sha_ctx_t *sha, const u32 *iv, size_t words)
+{
+	memcpy(sha->state, iv, words * sizeof(u32));
+	sha->length = 0;
+	sha->blen = 0;
+}
+
+static void _sha_update(sha_ctx_t *sha, const u8 *data, size_t len,
+						void (*blocks)(u32*, const u8*, size_t))
+{
+	size_t nblk;
+
+	sha->length += len;
+
+	/* top off a partially filled block first */
+	if (sha->blen) {
+		size_t fill = SHA_BLOCK_SIZE - sha->blen;
+		if (fill > len) fill = len;
+
+		memcpy(&sha->block[sha->blen], data, fill);
+		sha->blen += fill;
+		data += fill;
+		len -= fill;
+
+		if (sha->blen < SHA_BLOCK_SIZE) return;
+		blocks(sha->state, sha->block, 1);
+		sha->blen = 0;
+	}
+
+	/* then hash whole blocks straight from the caller buffer */
+	nblk = len / SHA_BLOCK_SIZE;
+	if (nblk) {
+		blocks(sha->state, data, nblk);
+		data += nblk * SHA_BLOCK_SIZE;
+		len -= nblk * SHA_BLOCK_SIZE;
+	}
+
+	memcpy(sha->block, data, len);
+	sha->blen = len;
+}
+
+static void _sha_final(sha_ctx_t *sha, u8 *out, size_t words,
+					void (*blocks)(u32*, const u8*, size_t))
+{
+	u64 bits = sha->length << 3;
+
+	sha->block[sha->blen++] = 0x80;
+	if (sha->blen > (SHA_BLOCK_SIZE - 8)) {
+		memset(&sha->block[sha->blen], 0, SHA_BLOCK_SIZE - sha->blen);
+		blocks(sha->state, sha->block, 1);
+		sha->blen = 0;
+	}
+
+	memset(&sha->block[sha->blen], 0, SHA_BLOCK_SIZE - 8 - sha->blen);
+	for (int i = 0; i < 8; i++)
+		sha->block[SHA_BLOCK_SIZE - 1 - i] = bits >> (i * 8);
+	blocks(sha->state, sha->block, 1);
+
+	for (size_t i = 0; i < words; i++) {
+		u32 w = sha->state[i];
+		*(out++) = w >> 24;
+		*(out++) = w >> 16;
+		*(out++) = w >> 8;
+		*(out++) = w;
+	}
+}
+
+void hash_init(hash_ctx_t *ctx, int algos)
+{
+	ctx->algos = algos & HASH_ALL;
+	ctx->crc16 = 0xFFFF;
+	ctx->crc32 = 0xFFFFFFFF;
+
+	if (algos & HASH_SHA1)
+		_sha_init(&ctx->sha1, sha1_iv, ARRAY_SIZE(sha1_iv));
+	if (algos & HASH_SHA256)
+		_sha_init(&ctx->sha256, sha256_iv, ARRAY_SIZE(sha256_iv));
+}
+
+void hash_update(hash_ctx_t *ctx, const void *data, size_t len)
+{
+	int algos = ctx->algos;
+
+	if (algos & HASH_CRC16)
+		ctx->crc16 = _crc16_update(ctx->crc16, data, len);
+	if (algos & HASH_CRC32)
+		ctx->crc32 = _crc32_update(ctx->crc32, data, len);
+	if (algos & HASH_SHA1)
+		_sha_update(&ctx->sha1, data, len, _sha1_blocks);
+	if (algos & HASH_SHA256)
+		_sha_update(&ctx->sha256, data, len, _sha256_blocks);
+}
+
+void hash_final(hash_ctx_t *ctx, hash_result_t *res)
+{
+	int algos = ctx->algos;
+
+	memset(res, 0, sizeof(*res));
+	res->algos = algos;
+
+	if (algos & HASH_CRC16)
+		res->crc16 = ctx->crc16;
+	if (algos & HASH_CRC32)
+		res->crc32 = ~ctx->crc32;
+	if (algos & HASH_SHA1)
+		_sha_final(&ctx->sha1, res->sha1, SHA1_DIGEST_SIZE / 4, _sha1_blocks);
+	if (algos & HASH_SHA256)
+		_sha_final(&ctx->sha256, res->sha256, SHA256_DIGEST_SIZE / 4, _sha256_blocks);
+}
+
+int hash_fd(int fd, int algos, hash_result_t *res,
+			hash_progress_fn progress, void *priv)
+{
+	hash_ctx_t *ctx;
+	off_t size, done, mlen;
+	const void *map;
+	bool mapped;
+	void *buf;
+	int ret = 0;
+	arena_mark_t mark;
+
+	if (res == NULL) return -ERR_MEM;
+
+	size = vfs_size(fd);
+	if (IS_ERR(size)) return size;
+
+	/* the digest state is small enough for the arena */
+	mark = arena_push();
+	ctx = arena_alloc(sizeof(*ctx));
+	if (ctx == NULL) {
+		arena_pop(mark);
+		return -ERR_MEM;
+	}
+
+	hash_init(ctx, algos);
+
+	/* memory backed files get hashed in place, without the copy */
+	mapped = !IS_ERR(vfs_map(fd, 0, &map, &mlen));
+	if (mapped && mlen < size) {
+		vfs_unmap(fd, map);
+		mapped = false;
+	}
+
+	if (mapped) {
+		for (done = 0; done < size;) {
+			off_t n = (size - done < HASH_BUFSZ) ? (size - done) : HASH_BUFSZ;
+
+			hash_update(ctx, (const u8*)map + done, n);
+			done += n;
+
+			if (progress) progress(done, size, priv);
+		}
+
+		vfs_unmap(fd, map);
+		hash_final(ctx, res);
+		arena_pop(mark);
+		return 0;
+	}
+
+	/* word aligned, so the slice-by-8 path kicks in right away */
+	buf = mem_alloc(MEM_TOOLS, HASH_BUFSZ);
+	if (buf == NULL) {
+		arena_pop(mark);
+		return -ERR_MEM;
+	}
+
+	done = 0;
+	while(done < size) {
+		off_t rb = vfs_read(fd, buf, HASH_BUFSZ);
+		if (rb <= 0) {
+			ret = IS_ERR(rb) ? rb : -ERR_IO;
+			break;
+		}
+
+		hash_update(ctx, buf, rb);
+		done += rb;
+
+		if (progress) progress(done, size, priv);
+	}
+
+	if (!IS_ERR(ret))
+		hash_final(ctx, res);
+
+	mem_free(buf);
+	arena_pop(mark);
+	return ret;
+}
+
+int hash_file(const char *path, int algos, hash_result_t *res,
+			hash_progress_fn progress, void *priv)
+{
+	int fd, ret;
+
+	if (path == NULL) return -ERR_MEM;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	ret = hash_fd(fd, algos, res, progress, priv);
+	vfs_close(fd);
+	return ret;
+}
+
+u16 hash_crc16(u16 crc, const void *data, size_t len)
+{
+	return _crc16_update(crc, data, len);
+}
+
+u32 hash_crc32(u32 crc, const void *data, size_t len)
+{
+	return ~_crc32_update(~crc, data, len);
+}
+
+size_t hash_hexstr(char *out, const u8 *digest, size_t len)
+{
+	static const char hexchr[] = "0123456789abcdef";
+
+	for (size_t i = 0; i < len; i++) {
+		*(out++) = hexchr[digest[i] >> 4];
+		*(out++) = hexchr[digest[i] & 0xF];
+	}
+	*out = '\0';
+	return len * 2;
+}
@@ -0,0 +1,91 @@
+#ifndef HASH_H__
+#define HASH_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+/* size of the buffer used when hashing files through the VFS */
+#define HASH_BUFSZ	(SIZE_KIB(64))
+
+#define SHA1_DIGEST_SIZE	(20)
+#define SHA256_DIGEST_SIZE	(32)
+#define SHA_BLOCK_SIZE		(64)
+
+enum {
+	HASH_CRC16	= BIT(0),	/**< NDS style CRC16 (0xA001 reflected, 0xFFFF init) */
+	HASH_CRC32	= BIT(1),	/**< Standard CRC32 (0xEDB88320 reflected) */
+	HASH_SHA1	= BIT(2),	/**< SHA-1 */
+	HASH_SHA256	= BIT(3),	/**< SHA-256 */
+
+	HASH_ALL	= HASH_CRC16 | HASH_CRC32 | HASH_SHA1 | HASH_SHA256,
+};
+
+typedef struct {
+	u32 state[8];
+	u64 length;
+	u8 block[SHA_BLOCK_SIZE];
+	size_t blen;
+} sha_ctx_t;
+
+typedef struct {
+	int algos;
+
+	u16 crc16;
+	u32 crc32;
+	sha_ctx_t sha1;
+	sha_ctx_t sha256;
+} hash_ctx_t;
+
+typedef struct {
+	int algos;
+
+	u16 crc16;
+	u32 crc32;
+	u8 sha1[SHA1_DIGEST_SIZE];
+	u8 sha256[SHA256_DIGEST_SIZE];
+} hash_result_t;
+
+/* called with the amount of bytes processed so far and the total size */
+typedef void (*hash_progress_fn)(off_t cur, off_t tot, void *priv);
+
+/* starts a new multi-digest computation over the `algos` mask */
+void hash_init(hash_ctx_t *ctx, int algos);
+
+/* feeds `len` bytes to every selected digest at once */
+void hash_update(hash_ctx_t *ctx, const void *data, size_t len);
+
+/* pads and finishes all digests, storing them in `res` */
+void hash_final(hash_ctx_t *ctx, hash_result_t *res);
+
+/*
+ * computes all digests in `algos` in a single sequential pass
+ * `progress` is optional and gets called after every chunk
+ */
+int hash_file(const char *path, int algos, hash_result_t *res,
+			hash_progress_fn progress, void *priv);
+
+/*
+ * same as hash_file, on an already open file that is still at its start
+ * files the backend can map are hashed in place
+ */
+int hash_fd(int fd, int algos, hash_result_t *res,
+			hash_progress_fn progress, void *priv);
+
+/* one-shot helpers, mostly for header checksums */
+u16 hash_crc16(u16 crc, const void *data, size_t len);
+u32 hash_crc32(u32 crc, const void *data, size_t len);
+
+/* formats a digest as a lowercase hex string, `out` needs 2*len+1 bytes */
+size_t hash_hexstr(char *out, const u8 *digest, size_t len);
+
+/*
+ * block level primitives, these live in ITCM (hash.itcm.c)
+ * the CRC functions work on the raw (non-inverted) register
+ */
+u16 _crc16_update(u16 crc, const u8 *data, size_t len);
+u32 _crc32_update(u32 crc, const u8 *data, size_t len);
+void _sha1_blocks(u32 *state, const u8 *data, size_t nblk);
+void _sha256_blocks(u32 *state, const u8 *data, size_t nblk);
+
+#endif /* HASH_H__ */
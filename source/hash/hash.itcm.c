@@ -0,0 +1,168 @@
+#include <nds.h>
+
+#include "global.h"
+
+#include "hash.h"
+
+/*
+ * hot loops for the hashing subsystem, placed in ITCM
+ *
+ * the ARM946E-S has no REV instruction nor unaligned word loads, so
+ * big endian words are assembled from bytes, and the message schedules
+ * use a 16 word circular buffer so everything stays close to registers
+ */
+
+/* generated by hash.c at startup */
+extern u16 _crc16_tbl[256];
+extern u32 _crc32_tbl[8][256];
+
+#define ROL(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+static inline u32 _load_be32(const u8 *p) {
+	return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+u16 _crc16_update(u16 crc, const u8 *data, size_t len)
+{
+	while(len--)
+		crc = (crc >> 8) ^ _crc16_tbl[(crc ^ *(data++)) & 0xFF];
+	return crc;
+}
+
+u32 _crc32_update(u32 crc, const u8 *data, size_t len)
+{
+	/* byte at a time until the source is word aligned */
+	while(len && ((uintptr_t)data & 3)) {
+		crc = (crc >> 8) ^ _crc32_tbl[0][(crc ^ *(data++)) & 0xFF];
+		len--;
+	}
+
+	/* slice-by-8, two aligned words per iteration */
+	while(len >= 8) {
+		u32 lo = *(const u32*)data ^ crc;
+		u32 hi = *(const u32*)(data + 4);
+
+		crc = _crc32_tbl[7][lo & 0xFF] ^
+			_crc32_tbl[6][(lo >> 8) & 0xFF] ^
+			_crc32_tbl[5][(lo >> 16) & 0xFF] ^
+			_crc32_tbl[4][lo >> 24] ^
+			_crc32_tbl[3][hi & 0xFF] ^
+			_crc32_tbl[2][(hi >> 8) & 0xFF] ^
+			_crc32_tbl[1][(hi >> 16) & 0xFF] ^
+			_crc32_tbl[0][hi >> 24];
+
+		data += 8;
+		len -= 8;
+	}
+
+	while(len--)
+		crc = (crc >> 8) ^ _crc32_tbl[0][(crc ^ *(data++)) & 0xFF];
+	return crc;
+}
+
+void _sha1_blocks(u32 *state, const u8 *data, size_t nblk)
+{
+	u32 w[16];
+
+	while(nblk--) {
+		u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+		for (int i = 0; i < 80; i++) {
+			u32 f, k, t;
+
+			if (i < 16) {
+				w[i] = _load_be32(&data[i * 4]);
+			} else {
+				t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+				w[i & 15] = ROL(t, 1);
+			}
+
+			if (i < 20) {
+				f = d ^ (b & (c ^ d));
+				k = 0x5A827999;
+			} else if (i < 40) {
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			} else if (i < 60) {
+				f = (b & c) | (d & (b | c));
+				k = 0x8F1BBCDC;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+
+			t = ROL(a, 5) + f + e + k + w[i & 15];
+			e = d;
+			d = c;
+			c = ROL(b, 30);
+			b = a;
+			a = t;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		data += SHA_BLOCK_SIZE;
+	}
+}
+
+static const u32 sha256_k[64] = {
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+void _sha256_blocks(u32 *state, const u8 *data, size_t nblk)
+{
+	u32 w[16];
+
+	while(nblk--) {
+		u32 a = state[0], b = state[1], c = state[2], d = state[3];
+		u32 e = state[4], f = state[5], g = state[6], h = state[7];
+
+		for (int i = 0; i < 64; i++) {
+			u32 t1, t2;
+
+			if (i < 16) {
+				w[i] = _load_be32(&data[i * 4]);
+			} else {
+				u32 w15 = w[(i + 1) & 15], w2 = w[(i + 14) & 15];
+				u32 s0 = ROR(w15, 7) ^ ROR(w15, 18) ^ (w15 >> 3);
+				u32 s1 = ROR(w2, 17) ^ ROR(w2, 19) ^ (w2 >> 10);
+				w[i & 15] += s0 + w[(i + 9) & 15] + s1;
+			}
+
+			t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) +
+				(g ^ (e & (f ^ g))) + sha256_k[i] + w[i & 15];
+			t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) +
+				((a & b) | (c & (a | b)));
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+		data += SHA_BLOCK_SIZE;
+	}
+}
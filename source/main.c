@@ -3,10 +3,18 @@
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
 
 #include "ui.h"
 #include "vfs.h"
-
+#include "vfs_stats.h"
+
+#include "compdata.h"
+#include "disktrace.h"
+#include "fatimg.h"
+#include "gba.h"
+#include "srl.h"
+#include "zip.h"
 #include "vfs_glue.h"
 
 int dldi_mount(char drv);
@@ -14,13 +22,33 @@ int memfs_init(char drv);
 
 void fe_mount_menu(void);
 
+/* with FAILFAST=1, right before giving up */
+static void mem_failed(const char *why, int tag, size_t size)
+{
+	ui_msgf("%s\n%s: %u bytes", why, mem_tag_name(tag), (unsigned)size);
+}
+
 int main(void) {
 	char drv = 'A';
+	mem_stack_init();
 	defaultExceptionHandler();
 	ui_reset();
+	mem_set_failhook(mem_failed);
+
+	srl_register();
+	gba_register();
+	fatimg_register();
+	zip_register();
+	compdata_register();
 
 	if (!IS_ERR(dldi_mount(drv))) drv++;
 	if (!IS_ERR(memfs_init(drv))) drv++;
+#ifdef VFS_STATS
+	if (!IS_ERR(vfs_stats_init(drv))) drv++;
+#endif
+#ifdef DISK_TRACE
+	if (!IS_ERR(disktrace_init(drv))) drv++;
+#endif
 
 	while(1) fe_mount_menu();
 }
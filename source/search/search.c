@@ -0,0 +1,228 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "vfs.h"
+
+#include "search.h"
+
+static int _search_nibble(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	c = toupper((unsigned char)c);
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/* picks the anchor and fills in the shift table once the bytes are set */
+static int _search_prepare(search_pat_t *p)
+{
+	size_t last = p->len - 1;
+
+	if (p->len == 0) return -ERR_ARG;
+
+	p->anchor = -1;
+	for (size_t i = 0; i < p->len; i++) {
+		if (p->mask[i] == 0xFF) {
+			p->anchor = i;
+			break;
+		}
+	}
+
+	/* a pattern of nothing but wildcards would match everywhere */
+	if (p->anchor < 0) {
+		size_t i;
+		for (i = 0; i < p->len; i++) {
+			if (p->mask[i]) break;
+		}
+		if (i == p->len) return -ERR_ARG;
+	}
+
+	/*
+	 * a byte may be lined up with every position it fits in, so the
+	 * safe shift is the distance to the rightmost one, wildcards fit
+	 * every byte and cap the shift for all of them
+	 */
+	memset(p->shift, p->len, sizeof(p->shift));
+	for (size_t j = 0; j < last; j++) {
+		for (int b = 0; b < 256; b++) {
+			if ((b & p->mask[j]) == p->val[j])
+				p->shift[b] = last - j;
+		}
+	}
+
+	return 0;
+}
+
+int search_parse_hex(search_pat_t *p, const char *str)
+{
+	size_t n = 0;
+
+	p->len = 0;
+	while(*str) {
+		int nib;
+
+		if (isspace((unsigned char)*str)) {
+			str++;
+			continue;
+		}
+
+		if (p->len == SEARCH_MAX) return -ERR_ARG;
+
+		if (*str == '?') {
+			nib = -1;
+		} else {
+			nib = _search_nibble(*str);
+			if (nib < 0) return -ERR_ARG;
+		}
+
+		if ((n & 1) == 0) {
+			p->val[p->len] = (nib < 0) ? 0 : (nib << 4);
+			p->mask[p->len] = (nib < 0) ? 0 : 0xF0;
+		} else {
+			p->val[p->len] |= (nib < 0) ? 0 : nib;
+			p->mask[p->len] |= (nib < 0) ? 0 : 0x0F;
+			p->len++;
+		}
+
+		n++;
+		str++;
+	}
+
+	/* half a byte isn't a pattern */
+	if (n & 1) return -ERR_ARG;
+	return _search_prepare(p);
+}
+
+int search_parse_text(search_pat_t *p, const char *str)
+{
+	p->len = 0;
+	while(*str) {
+		bool wild = (*str == '?');
+
+		if (p->len == SEARCH_MAX) return -ERR_ARG;
+
+		if (*str == '\\' && str[1] != '\0') str++;
+
+		p->val[p->len] = wild ? 0 : *str;
+		p->mask[p->len] = wild ? 0 : 0xFF;
+		p->len++;
+		str++;
+	}
+
+	return _search_prepare(p);
+}
+
+static int _search_scan(const search_pat_t *p, const u8 *buf, size_t len, off_t base,
+					search_hit_fn hit, void *priv, bool *stop)
+{
+	bool word = (p->len < SEARCH_BMH_MIN) && (p->anchor >= 0);
+	size_t i = 0;
+	int hits = 0;
+
+	while(1) {
+		i = word ? _search_word(p, buf, i, len) : _search_bmh(p, buf, i, len);
+		if (i == SEARCH_NONE) break;
+
+		hits++;
+		if (!hit(base + i, priv)) {
+			*stop = true;
+			break;
+		}
+		i++;
+	}
+
+	return hits;
+}
+
+int search_mem(const search_pat_t *p, const void *data, size_t len, off_t base,
+			search_hit_fn hit, void *priv)
+{
+	bool stop = false;
+	return _search_scan(p, data, len, base, hit, priv, &stop);
+}
+
+int search_fd(int fd, const search_pat_t *p, search_hit_fn hit,
+			search_progress_fn progress, void *priv)
+{
+	size_t keep = 0, tail = p->len - 1;
+	off_t size, done = 0, pos = 0, mlen;
+	bool stop = false, mapped;
+	const void *map;
+	int hits = 0;
+	u8 *buf;
+
+	size = vfs_size(fd);
+	if (IS_ERR(size)) return size;
+
+	mapped = !IS_ERR(vfs_map(fd, 0, &map, &mlen));
+	if (mapped && mlen < size) {
+		vfs_unmap(fd, map);
+		mapped = false;
+	}
+
+	/*
+	 * memory backed files get scanned in place, every step reaches
+	 * len-1 bytes into the next one so its last candidates are whole
+	 */
+	if (mapped) {
+		while(!stop && done < size) {
+			off_t n = (size - done < SEARCH_BUFSZ) ? (size - done) : SEARCH_BUFSZ;
+			off_t span = (size - done < n + tail) ? (size - done) : (n + tail);
+
+			hits += _search_scan(p, (const u8*)map + done, span, done, hit, priv, &stop);
+			done += n;
+
+			if (progress) progress(done, size, priv);
+		}
+
+		vfs_unmap(fd, map);
+		return hits;
+	}
+
+	/* the tail of the last chunk goes in front so reads stay whole */
+	buf = mem_alloc(MEM_TOOLS, SEARCH_BUFSZ + SEARCH_MAX);
+	if (buf == NULL) return -ERR_MEM;
+
+	while(!stop && done < size) {
+		off_t rb = vfs_read(fd, &buf[keep], SEARCH_BUFSZ);
+		size_t fill;
+
+		if (rb <= 0) {
+			hits = IS_ERR(rb) ? rb : -ERR_IO;
+			break;
+		}
+
+		fill = keep + rb;
+		hits += _search_scan(p, buf, fill, pos, hit, priv, &stop);
+		done += rb;
+
+		/* matches starting in here weren't complete yet */
+		keep = (fill < tail) ? fill : tail;
+		memmove(buf, &buf[fill - keep], keep);
+		pos += fill - keep;
+
+		if (progress) progress(done, size, priv);
+	}
+
+	mem_free(buf);
+	return hits;
+}
+
+int search_file(const char *path, const search_pat_t *p, search_hit_fn hit,
+			search_progress_fn progress, void *priv)
+{
+	int fd, ret;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	ret = search_fd(fd, p, hit, progress, priv);
+	vfs_close(fd);
+	return ret;
+}
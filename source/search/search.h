@@ -0,0 +1,75 @@
+#ifndef SEARCH_H__
+#define SEARCH_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+/* size of the chunks read when searching files through the VFS */
+#define SEARCH_BUFSZ	(SIZE_KIB(64))
+
+#define SEARCH_MAX		(64)	/* longest pattern, in bytes */
+#define SEARCH_NONE		((size_t)-1)
+
+/* patterns shorter than this scan for a single byte a word at a time */
+#define SEARCH_BMH_MIN	(4)
+
+/*
+ * a compiled pattern, a byte matches when (byte & mask) == val
+ * wildcard bytes have a zero mask, hex patterns can also mask nibbles
+ */
+typedef struct {
+	u8 val[SEARCH_MAX];
+	u8 mask[SEARCH_MAX];
+	size_t len;
+
+	int anchor;			/* exact byte for the word scan, -1 if none */
+	u8 shift[256];		/* Horspool bad character shifts */
+} search_pat_t;
+
+/* called for every match in order, return false to stop the search */
+typedef bool (*search_hit_fn)(off_t off, void *priv);
+
+/* called with the amount of bytes scanned so far and the total size */
+typedef void (*search_progress_fn)(off_t cur, off_t tot, void *priv);
+
+/*
+ * compiles a hex pattern like "DE AD ?? EF" or "dead?0ef"
+ * '?' stands for any nibble, whitespace is ignored
+ */
+int search_parse_hex(search_pat_t *p, const char *str);
+
+/*
+ * compiles a text pattern, '?' matches any byte
+ * a backslash makes the character after it literal
+ */
+int search_parse_text(search_pat_t *p, const char *str);
+
+/*
+ * scans `len` bytes at `data` in place, hits are reported as `base` + index
+ * returns the amount of hits
+ */
+int search_mem(const search_pat_t *p, const void *data, size_t len, off_t base,
+			search_hit_fn hit, void *priv);
+
+/*
+ * streams an open file (still at its start) through the scanner in
+ * SEARCH_BUFSZ reads, matches crossing chunk boundaries are found too
+ * files the backend can map (devfs memory) are scanned in place instead
+ * returns the amount of hits or an error
+ */
+int search_fd(int fd, const search_pat_t *p, search_hit_fn hit,
+			search_progress_fn progress, void *priv);
+
+/* same as above, opening `path` first */
+int search_file(const char *path, const search_pat_t *p, search_hit_fn hit,
+			search_progress_fn progress, void *priv);
+
+/*
+ * finds the first match starting at or after `start` that fits in `len`
+ * returns its index or SEARCH_NONE, these live in ITCM (search.itcm.c)
+ */
+size_t _search_bmh(const search_pat_t *p, const u8 *buf, size_t start, size_t len);
+size_t _search_word(const search_pat_t *p, const u8 *buf, size_t start, size_t len);
+
+#endif /* SEARCH_H__ */
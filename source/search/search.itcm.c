@@ -0,0 +1,72 @@
+#include <nds.h>
+
+#include "global.h"
+
+#include "search.h"
+
+/*
+ * hot loops for the pattern scanner, placed in ITCM
+ *
+ * every byte comparison goes through the mask so wildcards cost nothing
+ * extra, the ARM946E-S has no unaligned loads so the word scan lines up
+ * the anchor byte on a word boundary before going four bytes at a time
+ */
+
+static inline bool _search_match(const search_pat_t *p, const u8 *d, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		if ((d[i] & p->mask[i]) != p->val[i]) return false;
+	}
+	return true;
+}
+
+size_t _search_bmh(const search_pat_t *p, const u8 *buf, size_t start, size_t len)
+{
+	const size_t last = p->len - 1;
+	const u8 lval = p->val[last], lmask = p->mask[last];
+	const u8 *shift = p->shift;
+	size_t i = start;
+
+	if (len < p->len) return SEARCH_NONE;
+
+	while(i <= len - p->len) {
+		u8 b = buf[i + last];
+
+		if ((b & lmask) == lval && _search_match(p, &buf[i], last))
+			return i;
+		i += shift[b];
+	}
+
+	return SEARCH_NONE;
+}
+
+size_t _search_word(const search_pat_t *p, const u8 *buf, size_t start, size_t len)
+{
+	const u32 ones = 0x01010101, highs = 0x80808080;
+	const int a = p->anchor;
+	const u8 aval = p->val[a];
+	const u32 rep = ones * aval;
+	size_t i = start, end;
+
+	if (len < p->len) return SEARCH_NONE;
+	end = len - p->len + 1;
+
+	while(i < end) {
+		const u8 *ap = &buf[i + a];
+
+		/* skip four candidates at once if none of them has the anchor byte */
+		if (((uintptr_t)ap & 3) == 0 && (i + 4) <= end) {
+			u32 w = *(const u32*)ap ^ rep;
+			if (((w - ones) & ~w & highs) == 0) {
+				i += 4;
+				continue;
+			}
+		}
+
+		if (*ap == aval && _search_match(p, &buf[i], p->len))
+			return i;
+		i++;
+	}
+
+	return SEARCH_NONE;
+}
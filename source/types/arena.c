@@ -0,0 +1,45 @@
+#include <nds.h>
+
+#include "global.h"
+
+#include "arena.h"
+
+static u8 arena_mem[ARENA_SIZE] TCM_BSS __attribute__((aligned(ARENA_ALIGN)));
+static size_t arena_top, arena_hwm;
+static u32 arena_nfail;
+
+arena_mark_t arena_push(void)
+{
+	return arena_top;
+}
+
+void arena_pop(arena_mark_t mark)
+{
+	arena_top = mark;
+}
+
+void *arena_alloc(size_t size)
+{
+	void *ptr;
+
+	size = arena_round(size);
+	if (UNLIKELY(size > (ARENA_SIZE - arena_top))) {
+		arena_nfail++;
+		return NULL;
+	}
+
+	ptr = &arena_mem[arena_top];
+	arena_top += size;
+	if (arena_top > arena_hwm) arena_hwm = arena_top;
+	return ptr;
+}
+
+size_t arena_peak(void)
+{
+	return arena_hwm;
+}
+
+u32 arena_fails(void)
+{
+	return arena_nfail;
+}
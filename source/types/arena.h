@@ -0,0 +1,44 @@
+#ifndef ARENA_H__
+#define ARENA_H__
+
+#include <nds.h>
+
+/*
+ * bump allocator for scratch memory that only lives during one operation,
+ * it sits in DTCM so it's as fast as the stack, but whatever it takes is
+ * taken from the stack, which gets the DTCM left over
+ *
+ * the deepest nesting is a tree copy: its context, the walker state and
+ * a FILINFO plus path in the FAT backend, about 2.3KiB, "/heap" shows the
+ * arena and stack peaks next to each other
+ *
+ * every user takes a mark with arena_push before allocating and gives
+ * everything back with arena_pop once done, marks must be popped in the
+ * reverse order they were pushed
+ */
+
+#define ARENA_SIZE	(3072)
+#define ARENA_ALIGN	(8)
+
+typedef size_t arena_mark_t;
+
+static inline size_t arena_round(size_t sz) {
+	return (sz + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+/* current top, to be passed back to arena_pop */
+arena_mark_t arena_push(void);
+
+/* releases everything allocated since `mark` was taken */
+void arena_pop(arena_mark_t mark);
+
+/* returns `size` bytes, NULL if the arena is exhausted */
+void *arena_alloc(size_t size);
+
+/* most bytes ever in use at once */
+size_t arena_peak(void);
+
+/* number of allocations that didn't fit */
+u32 arena_fails(void);
+
+#endif /* ARENA_H__ */
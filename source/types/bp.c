@@ -2,12 +2,13 @@
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
 
 #include "bp.h"
 
 int bp_init(bp_t *bp, int n)
 {
-	bp->map = malloc(BP_SIZEB(n));
+	bp->map = mem_alloc(MEM_FE, BP_SIZEB(n));
 	if (bp->map == NULL) return -ERR_MEM;
 
 	memset(bp->map, 0, BP_SIZEB(n));
@@ -21,7 +22,7 @@ int bp_init(bp_t *bp, int n)
 
 void bp_free(bp_t *bp)
 {
-	free(bp->map);
+	mem_free(bp->map);
 }
 
 void bp_clearall(bp_t *bp)
@@ -70,7 +71,7 @@ void bp_xor(bp_t *bp, int i)
 	}
 }
 
-int bp_find_clr(bp_t *bp)
+TCM_CODE int bp_find_clr(bp_t *bp)
 {
 	size_t i;
 	int ret;
@@ -93,7 +94,7 @@ int bp_find_clr(bp_t *bp)
 	return ret + (i * BP_UBITS);
 }
 
-int bp_find_set(bp_t *bp)
+TCM_CODE int bp_find_set(bp_t *bp)
 {
 	size_t i;
 	int ret;
@@ -14,6 +14,8 @@
 
 #include <nds.h>
 
+#include "tcm.h"
+
 #define LIKELY(x)	__builtin_expect((x), 1)
 #define UNLIKELY(x)	__builtin_expect((x), 0)
 
@@ -0,0 +1,284 @@
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "arena.h"
+#include "mem.h"
+
+#define MEM_HDR_MAGIC	(0xA5)
+
+/* right in front of every block, keeps the 8 byte alignment malloc gives */
+typedef struct {
+	u32 size;
+	u8 tag;
+	u8 owner;
+	u8 skew;	/**< Bytes between the malloc'd block and this header */
+	u8 magic;
+} mem_hdr_t;
+
+typedef struct {
+	size_t used, peak;
+	u32 blocks;
+	u32 allocs;
+	u32 fails;
+} mem_tagstat_t;
+
+typedef struct {
+	char what[16];
+	size_t bytes;
+	u32 blocks;
+} mem_leak_t;
+
+static const char *const mem_tag_names[MEM_TAGS] = {
+	"misc", "pool", "vfs", "fat", "archive",
+	"decomp", "format", "block", "tools", "fe",
+};
+
+static mem_tagstat_t tag_stats[MEM_TAGS];
+static size_t mem_total, mem_peak;
+
+static struct {
+	size_t used;
+	u32 blocks;
+} owner_stats[MEM_OWNERS];
+static int mem_owner = MEM_NOOWNER;
+
+static mem_leak_t leak_log[MEM_LEAKLOG];
+static u32 leak_count;
+
+#ifdef MEM_FAILFAST
+static bool mem_failfast = true;
+#else
+static bool mem_failfast = false;
+#endif
+static mem_fail_fn mem_failhook = NULL;
+
+static void _mem_panic(const char *why, int tag, size_t size)
+{
+	if (!mem_failfast) return;
+	if (mem_failhook) mem_failhook(why, tag, size);
+	abort();
+}
+
+static void *_mem_failed(int tag, size_t size)
+{
+	tag_stats[tag].fails++;
+	_mem_panic("Out of memory", tag, size);
+	return NULL;
+}
+
+static void *_mem_charge(void *raw, mem_hdr_t *hdr, int tag, size_t size)
+{
+	mem_tagstat_t *ts = &tag_stats[tag];
+
+	hdr->size = size;
+	hdr->tag = tag;
+	hdr->owner = mem_owner;
+	hdr->skew = (u8*)hdr - (u8*)raw;
+	hdr->magic = MEM_HDR_MAGIC;
+
+	ts->used += size;
+	ts->blocks++;
+	ts->allocs++;
+	if (ts->used > ts->peak) ts->peak = ts->used;
+
+	mem_total += size;
+	if (mem_total > mem_peak) mem_peak = mem_total;
+
+	owner_stats[mem_owner].used += size;
+	owner_stats[mem_owner].blocks++;
+	return hdr + 1;
+}
+
+void *mem_alloc(int tag, size_t size)
+{
+	mem_hdr_t *hdr;
+
+	if (tag < 0 || tag >= MEM_TAGS) tag = MEM_MISC;
+
+	hdr = malloc(sizeof(*hdr) + size);
+	if (hdr == NULL) return _mem_failed(tag, size);
+	return _mem_charge(hdr, hdr, tag, size);
+}
+
+void *mem_memalign(int tag, size_t align, size_t size)
+{
+	uintptr_t user;
+	u8 *raw;
+
+	if (tag < 0 || tag >= MEM_TAGS) tag = MEM_MISC;
+	if (align < sizeof(mem_hdr_t)) align = sizeof(mem_hdr_t);
+	if (align > 128 || (align & (align - 1))) return _mem_failed(tag, size);
+
+	/* the header goes right below the aligned address */
+	raw = malloc(align + sizeof(mem_hdr_t) + size);
+	if (raw == NULL) return _mem_failed(tag, size);
+
+	user = ((uintptr_t)raw + sizeof(mem_hdr_t) + align - 1) & ~(uintptr_t)(align - 1);
+	return _mem_charge(raw, (mem_hdr_t*)user - 1, tag, size);
+}
+
+void mem_free(void *ptr)
+{
+	mem_hdr_t *hdr;
+	mem_tagstat_t *ts;
+
+	if (ptr == NULL) return;
+
+	hdr = (mem_hdr_t*)ptr - 1;
+	if (UNLIKELY(hdr->magic != MEM_HDR_MAGIC || hdr->tag >= MEM_TAGS)) {
+		/* not ours or trashed, leaking it beats corrupting the heap */
+		tag_stats[MEM_MISC].fails++;
+		_mem_panic("Bad free", MEM_MISC, 0);
+		return;
+	}
+
+	ts = &tag_stats[hdr->tag];
+	ts->used -= hdr->size;
+	ts->blocks--;
+	mem_total -= hdr->size;
+
+	/* the owner might have been checked already, don't wrap around */
+	if (owner_stats[hdr->owner].blocks > 0) {
+		owner_stats[hdr->owner].used -= hdr->size;
+		owner_stats[hdr->owner].blocks--;
+	}
+
+	hdr->magic = 0;
+	free((u8*)hdr - hdr->skew);
+}
+
+void mem_set_failfast(bool failfast)
+{
+	mem_failfast = failfast;
+}
+
+void mem_set_failhook(mem_fail_fn fn)
+{
+	mem_failhook = fn;
+}
+
+const char *mem_tag_name(int tag)
+{
+	return (tag >= 0 && tag < MEM_TAGS) ? mem_tag_names[tag] : "?";
+}
+
+size_t mem_used(int tag)
+{
+	return (tag >= 0 && tag < MEM_TAGS) ? tag_stats[tag].used : 0;
+}
+
+int mem_owner_set(int owner)
+{
+	int prev = mem_owner;
+	mem_owner = (owner >= 0 && owner < MEM_OWNERS) ? owner : MEM_NOOWNER;
+	return prev;
+}
+
+static void _mem_leak(const char *what, size_t bytes, u32 blocks)
+{
+	mem_leak_t *l = &leak_log[leak_count++ % MEM_LEAKLOG];
+
+	strncpy(l->what, what, sizeof(l->what) - 1);
+	l->what[sizeof(l->what) - 1] = '\0';
+	l->bytes = bytes;
+	l->blocks = blocks;
+}
+
+void mem_owner_check(int owner, const char *what)
+{
+	if (owner <= MEM_NOOWNER || owner >= MEM_OWNERS) return;
+	if (owner_stats[owner].blocks == 0) return;
+
+	_mem_leak(what, owner_stats[owner].used, owner_stats[owner].blocks);
+	owner_stats[owner].used = 0;
+	owner_stats[owner].blocks = 0;
+}
+
+void mem_tag_check(int tag, size_t base, const char *what)
+{
+	size_t used = mem_used(tag);
+	if (used > base) _mem_leak(what, used - base, 0);
+}
+
+#ifdef ARM9
+#define MEM_STACK_PAINT	(0xDEADC0DE)
+
+/* the user mode stack grows down from __sp_usr towards the end of DTCM bss */
+extern u32 __sbss_end[], __sp_usr[];
+
+void mem_stack_init(void)
+{
+	u32 *p = __sbss_end;
+	u32 *sp = (u32*)__builtin_frame_address(0) - 64;
+
+	while(p < sp) *(p++) = MEM_STACK_PAINT;
+}
+
+static size_t _mem_stack_peak(void)
+{
+	u32 *p = __sbss_end;
+
+	while(p < __sp_usr && *p == MEM_STACK_PAINT) p++;
+	return (u8*)__sp_usr - (u8*)p;
+}
+#else
+void mem_stack_init(void)
+{
+}
+#endif
+
+/* appends to the report, keeps track of the space left */
+#define MEM_PRINTF(...) do { \
+	int _n = snprintf(&buf[pos], len - pos, __VA_ARGS__); \
+	if (_n < 0) _n = 0; \
+	pos += ((size_t)_n < (len - pos)) ? (size_t)_n : (len - pos - 1); \
+} while(0)
+
+size_t mem_format(char *buf, size_t len)
+{
+	size_t pos = 0;
+
+	if (len == 0) return 0;
+	buf[0] = '\0';
+
+	MEM_PRINTF("%-8s %8s %8s %6s %8s %5s\n", "tag", "used", "peak", "blocks", "allocs", "fails");
+	for (int t = 0; t < MEM_TAGS; t++) {
+		const mem_tagstat_t *ts = &tag_stats[t];
+		if (ts->allocs == 0 && ts->fails == 0) continue;
+
+		MEM_PRINTF("%-8s %8lu %8lu %6lu %8lu %5lu\n", mem_tag_names[t],
+			(unsigned long)ts->used, (unsigned long)ts->peak, (unsigned long)ts->blocks,
+			(unsigned long)ts->allocs, (unsigned long)ts->fails);
+	}
+	MEM_PRINTF("%-8s %8lu %8lu\n", "total", (unsigned long)mem_total, (unsigned long)mem_peak);
+
+#ifdef ARM9
+	{
+		struct mallinfo mi = mallinfo();
+		size_t unclaimed = getHeapLimit() - getHeapEnd();
+
+		MEM_PRINTF("\nheap %lu in use, %lu free in the arena, %lu never claimed\n",
+			(unsigned long)mi.uordblks, (unsigned long)mi.fordblks, (unsigned long)unclaimed);
+		MEM_PRINTF("stack peak %lu of %lu\n", (unsigned long)_mem_stack_peak(),
+			(unsigned long)((u8*)__sp_usr - (u8*)__sbss_end));
+		MEM_PRINTF("arena peak %lu of %lu, %lu fails\n", (unsigned long)arena_peak(),
+			(unsigned long)ARENA_SIZE, (unsigned long)arena_fails());
+	}
+#endif
+
+	MEM_PRINTF("\nleaks %lu\n", (unsigned long)leak_count);
+	for (u32 i = (leak_count > MEM_LEAKLOG) ? (leak_count - MEM_LEAKLOG) : 0; i < leak_count; i++) {
+		const mem_leak_t *l = &leak_log[i % MEM_LEAKLOG];
+		MEM_PRINTF("%-15s %8lu bytes", l->what, (unsigned long)l->bytes);
+		if (l->blocks) MEM_PRINTF(" %lu blocks", (unsigned long)l->blocks);
+		MEM_PRINTF("\n");
+	}
+
+	return pos;
+}
@@ -0,0 +1,70 @@
+#ifndef MEM_H__
+#define MEM_H__
+
+#include <nds.h>
+
+/*
+ * heap wrapper, every block is charged to the subsystem tag it was
+ * allocated with and to the current owner, so usage can be told apart
+ * and anything an owner forgets to free shows up as a leak
+ *
+ * the VFS makes each mount the owner while its operations run, the
+ * report is readable as "/heap" in the "Memory" drive
+ */
+
+enum {
+	MEM_MISC = 0,
+	MEM_POOL,		/**< Slab pools */
+	MEM_VFS,		/**< VFS helpers */
+	MEM_FAT,		/**< FAT backend */
+	MEM_ARCHIVE,	/**< NitroFS and ZIP backends */
+	MEM_DECOMP,		/**< Inflate and BIOS decompression */
+	MEM_FORMAT,		/**< File type handlers */
+	MEM_BLOCK,		/**< Loop devices */
+	MEM_TOOLS,		/**< Hashing and searching */
+	MEM_FE,			/**< File browser, path stores and bitmaps */
+
+	MEM_TAGS
+};
+
+#define MEM_NOOWNER	(0)
+#define MEM_OWNERS	(32)
+
+#define MEM_LEAKLOG	(8)
+#define MEM_TEXTSZ	(2048)
+
+/* gets to report what went wrong right before fail-fast aborts */
+typedef void (*mem_fail_fn)(const char *why, int tag, size_t size);
+
+void *mem_alloc(int tag, size_t size);
+void *mem_memalign(int tag, size_t align, size_t size);
+void mem_free(void *ptr);
+
+/*
+ * by default a failed allocation just returns NULL and freeing a block
+ * with a broken header leaks it, fail-fast aborts on either instead,
+ * make FAILFAST=1 turns it on from the start
+ */
+void mem_set_failfast(bool failfast);
+void mem_set_failhook(mem_fail_fn fn);
+
+const char *mem_tag_name(int tag);
+
+/* bytes currently allocated under `tag` */
+size_t mem_used(int tag);
+
+/* sets the owner charged for new blocks, returns the previous one */
+int mem_owner_set(int owner);
+
+/* logs whatever is still charged to `owner` as leaked by `what`, then forgets it */
+void mem_owner_check(int owner, const char *what);
+
+/* logs a leak by `what` if `tag` went above `base` bytes */
+void mem_tag_check(int tag, size_t base, const char *what);
+
+/* fills the unused stack with a pattern for the high water mark, once at boot */
+void mem_stack_init(void);
+
+size_t mem_format(char *buf, size_t len);
+
+#endif /* MEM_H__ */
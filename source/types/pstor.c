@@ -2,6 +2,7 @@
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
 
 #include "pstor.h"
 
@@ -14,7 +15,7 @@ int pstor_init(pstor_t *ps, size_t bufsz, size_t max)
 
 	cache_sz = ((max + PSTOR_CACHE_DIV - 1) / PSTOR_CACHE_DIV) * sizeof(char*);
 	wbufsz = bufsz + max + cache_sz;
-	wbuf = malloc(wbufsz);
+	wbuf = mem_alloc(MEM_FE, wbufsz);
 	if (wbuf == NULL) return -ERR_MEM;
 
 	ps->buflen = bufsz;
@@ -31,7 +32,7 @@ int pstor_init(pstor_t *ps, size_t bufsz, size_t max)
 
 void pstor_free(pstor_t *ps)
 {
-	free(ps->buf);
+	mem_free(ps->buf);
 }
 
 void pstor_reset(pstor_t *ps)
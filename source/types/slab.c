@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "mem.h"
+
+#include "slab.h"
+
+/* pools that got their backing block, for the report */
+static slab_t *slab_list = NULL;
+
+static int _slab_populate(slab_t *slab)
+{
+	u8 *obj;
+	int owner;
+
+	/* the block outlives whichever mount happened to need it first */
+	owner = mem_owner_set(MEM_NOOWNER);
+	slab->mem = mem_memalign(MEM_POOL, SLAB_ALIGN, slab->size * slab->count);
+	mem_owner_set(owner);
+	if (slab->mem == NULL) return -ERR_MEM;
+
+	/* thread the free list through the objects, lowest address first */
+	slab->free = NULL;
+	obj = &slab->mem[slab->size * slab->count];
+	for (size_t i = 0; i < slab->count; i++) {
+		obj -= slab->size;
+		*(void**)obj = slab->free;
+		slab->free = obj;
+	}
+
+	slab->next = slab_list;
+	slab_list = slab;
+	return 0;
+}
+
+void *slab_alloc(slab_t *slab)
+{
+	void *obj;
+
+	if (UNLIKELY(slab->mem == NULL) && IS_ERR(_slab_populate(slab))) {
+		slab->fails++;
+		return NULL;
+	}
+
+	obj = slab->free;
+	if (obj == NULL) {
+		slab->fails++;
+		return NULL;
+	}
+
+	slab->free = *(void**)obj;
+	slab->used++;
+	if (slab->used > slab->peak) slab->peak = slab->used;
+	return obj;
+}
+
+void slab_free(slab_t *slab, void *obj)
+{
+	if (obj == NULL) return;
+
+	*(void**)obj = slab->free;
+	slab->free = obj;
+	slab->used--;
+}
+
+size_t slab_format(char *buf, size_t len)
+{
+	size_t pos = 0;
+
+	if (len == 0) return 0;
+	buf[0] = '\0';
+
+	for (slab_t *slab = slab_list; slab != NULL; slab = slab->next) {
+		int n = snprintf(&buf[pos], len - pos, "%-10s %5u %4u/%-4u peak %4u fail %lu\n",
+			slab->name, (unsigned)slab->size, (unsigned)slab->used,
+			(unsigned)slab->count, (unsigned)slab->peak, (unsigned long)slab->fails);
+		if (n < 0) break;
+		pos += ((size_t)n < (len - pos)) ? (size_t)n : (len - pos - 1);
+	}
+
+	return pos;
+}
@@ -0,0 +1,52 @@
+#ifndef SLAB_H__
+#define SLAB_H__
+
+#include <nds.h>
+
+/* ARM9 data cache line, objects never share one */
+#define SLAB_ALIGN	(32)
+
+#define SLAB_OBJSZ(sz)	(((sz) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1))
+
+/*
+ * fixed pool of `count` equally sized objects, taken from the heap in a
+ * single block on the first allocation and kept for the whole session
+ * free objects are linked through their first word
+ */
+typedef struct slab_s {
+	const char *name;	/**< Pool name, for the usage report */
+	size_t size;		/**< Object size, rounded up to SLAB_ALIGN */
+	size_t count;		/**< Objects in the pool */
+
+	u8 *mem;			/**< Backing block, NULL until the first allocation */
+	void *free;			/**< Free object list */
+
+	size_t used;		/**< Objects handed out right now */
+	size_t peak;		/**< Most objects ever handed out at once */
+	u32 fails;			/**< Allocations refused because the pool was full */
+
+	struct slab_s *next;
+} slab_t;
+
+/* static initializer for a pool of `cnt` objects of type `type` */
+#define SLAB_INIT(n, type, cnt) { \
+	.name = (n), .size = SLAB_OBJSZ(sizeof(type)), .count = (cnt), \
+}
+
+/* returns an uninitialized object, NULL if the pool is exhausted */
+void *slab_alloc(slab_t *slab);
+
+/* returns an object to its pool, NULL is ignored */
+void slab_free(slab_t *slab, void *obj);
+
+/* position of `obj` in its pool, -1 if it doesn't belong to it */
+static inline int slab_index(const slab_t *slab, const void *obj) {
+	uintptr_t off = (uintptr_t)obj - (uintptr_t)slab->mem;
+	if (slab->mem == NULL || off >= slab->size * slab->count) return -1;
+	return off / slab->size;
+}
+
+/* one line per pool that has been used so far */
+size_t slab_format(char *buf, size_t len);
+
+#endif /* SLAB_H__ */
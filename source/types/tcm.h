@@ -0,0 +1,29 @@
+#ifndef TCM_H__
+#define TCM_H__
+
+/*
+ * tightly coupled memory placement for the hot loops, picked off the host
+ * profile (make -C tools/bench profile), the ARM9 build prints what's left
+ *
+ * plain attributes, same as the libnds ones, so FatFs can use them
+ * without pulling in nds.h
+ *
+ * main RAM can only reach ITCM through a long call, so this is for whole
+ * loops and not for small helpers that would otherwise be inlined
+ * noinline keeps a static loop from being inlined back into a main RAM
+ * caller, which would quietly drop the placement
+ *
+ * nothing that gets handed to a block driver belongs in DTCM, neither DMA
+ * nor the ARM7 can reach it
+ */
+#ifdef ARM9
+#define TCM_CODE	__attribute__((section(".itcm"), long_call, noinline))
+#define TCM_DATA	__attribute__((section(".dtcm")))
+#define TCM_BSS		__attribute__((section(".sbss")))
+#else
+#define TCM_CODE
+#define TCM_DATA
+#define TCM_BSS
+#endif
+
+#endif /* TCM_H__ */
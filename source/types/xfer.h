@@ -0,0 +1,32 @@
+#ifndef XFER_H__
+#define XFER_H__
+
+#include <nds.h>
+
+/* shorter transfers aren't worth the cache maintenance */
+#define XFER_DMA_MIN	(1024)
+#define XFER_DMA_CH		(3)
+
+/*
+ * bulk copies and fills, these live in ITCM (xfer.itcm.c)
+ *
+ * word aligned transfers between DMA reachable memory (main RAM, WRAM,
+ * VRAM, palettes) go through DMA with the caches flushed and invalidated
+ * around them, anything else (TCMs, BIOS, host builds) uses CPU loops
+ * that never do byte writes, so every function is safe to use on VRAM
+ * as long as the pointers are halfword aligned
+ */
+
+/* copies `len` bytes from `src` to `dst`, the areas must not overlap */
+void xfer_copy(void *dst, const void *src, size_t len);
+
+/* same as above, but never touches DMA, for interrupt handlers */
+void xfer_copy_cpu(void *dst, const void *src, size_t len);
+
+/* fills `count` halfwords at `dst` with `val` */
+void xfer_fill16(void *dst, u16 val, size_t count);
+
+/* fills `count` words at `dst` with `val` */
+void xfer_fill32(void *dst, u32 val, size_t count);
+
+#endif /* XFER_H__ */
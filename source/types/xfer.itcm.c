@@ -0,0 +1,113 @@
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+
+#include "xfer.h"
+
+/*
+ * the CPU loops go through volatile pointers, otherwise the compiler
+ * is free to turn them back into memcpy/memset calls that do byte
+ * writes, which VRAM silently drops
+ */
+
+#ifdef ARM9
+/* main RAM, shared WRAM, IO, palettes, VRAM and OAM, the TCMs and BIOS aren't on the bus */
+static inline bool _xfer_dmaable(const void *p, size_t len)
+{
+	uintptr_t a = (uintptr_t)p;
+	return (a >= 0x02000000) && ((a + len) <= 0x07000800);
+}
+#endif
+
+void xfer_copy_cpu(void *dst, const void *src, size_t len)
+{
+	uintptr_t align = (uintptr_t)dst | (uintptr_t)src | len;
+
+	if ((align & 3) == 0) {
+		vu32 *d = dst;
+		const u32 *s = src;
+		size_t n = len >> 2;
+
+		while(n >= 8) {
+			d[0] = s[0]; d[1] = s[1]; d[2] = s[2]; d[3] = s[3];
+			d[4] = s[4]; d[5] = s[5]; d[6] = s[6]; d[7] = s[7];
+			d += 8;
+			s += 8;
+			n -= 8;
+		}
+		while(n--) *(d++) = *(s++);
+	} else if ((align & 1) == 0) {
+		vu16 *d = dst;
+		const u16 *s = src;
+		size_t n = len >> 1;
+
+		while(n--) *(d++) = *(s++);
+	} else {
+		/* byte aligned data can't be in VRAM anyway */
+		memcpy(dst, src, len);
+	}
+}
+
+void xfer_copy(void *dst, const void *src, size_t len)
+{
+#ifdef ARM9
+	uintptr_t align = (uintptr_t)dst | (uintptr_t)src | len;
+
+	if (len >= XFER_DMA_MIN && (align & 3) == 0 &&
+		_xfer_dmaable(dst, len) && _xfer_dmaable(src, len)) {
+		/*
+		 * DMA only sees memory, so the source has to be written back first
+		 * the destination too, or dirty lines around its edges (or in it)
+		 * would be written back over the copy later on
+		 */
+		DC_FlushRange(src, len);
+		DC_FlushRange(dst, len);
+		dmaCopyWords(XFER_DMA_CH, src, dst, len);
+		DC_InvalidateRange(dst, len);
+		return;
+	}
+#endif
+
+	xfer_copy_cpu(dst, src, len);
+}
+
+void xfer_fill32(void *dst, u32 val, size_t count)
+{
+	vu32 *d = dst;
+
+#ifdef ARM9
+	size_t len = count << 2;
+
+	if (len >= XFER_DMA_MIN && _xfer_dmaable(dst, len)) {
+		DC_FlushRange(dst, len);
+		dmaFillWords(val, dst, len);
+		DC_InvalidateRange(dst, len);
+		return;
+	}
+#endif
+
+	while(count >= 8) {
+		d[0] = val; d[1] = val; d[2] = val; d[3] = val;
+		d[4] = val; d[5] = val; d[6] = val; d[7] = val;
+		d += 8;
+		count -= 8;
+	}
+	while(count--) *(d++) = val;
+}
+
+void xfer_fill16(void *dst, u16 val, size_t count)
+{
+	vu16 *d = dst;
+
+	if (count == 0) return;
+
+	/* line up with a word so the bulk goes two halfwords at a time */
+	if ((uintptr_t)d & 2) {
+		*(d++) = val;
+		count--;
+	}
+
+	xfer_fill32((void*)d, val | ((u32)val << 16), count >> 1);
+	if (count & 1) d[count - 1] = val;
+}
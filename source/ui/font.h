@@ -14,6 +14,12 @@
 #define CHR_VERSEP		(0xBA)
 #define CHR_HORSEP		(0xCD)
 
+/*
+ * 1bpp glyph data, 8 bytes per glyph, only looked at by tools/fontgen
+ * which expands it into the 4bpp tiles that get linked in (font_tiles.bin)
+ * index zero is transparent and index one a full block, no matter the data
+ */
+#ifdef FONT_GLYPHS
 static const unsigned char font[2048] = {
 	/* 0 0x00 UNUSED */
 	0x00, /* 00000000 */
@@ -2575,5 +2581,6 @@ static const unsigned char font[2048] = {
 	0x00, /* 00000000 */
 	0x00, /* 00000000 */
 };
+#endif /* FONT_GLYPHS */
 
 #endif /* FONT_H__ */
@@ -5,6 +5,7 @@
 #include <nds.h>
 
 #include "global.h"
+#include "xfer.h"
 
 #define KEY_FACE	(KEY_A | KEY_B | KEY_X | KEY_Y)
 #define KEY_DPAD	(KEY_UP | KEY_DOWN | KEY_LEFT | KEY_RIGHT)
@@ -16,6 +17,7 @@
 
 #define TFB_WIDTH	(32)
 #define TFB_HEIGHT	(24)
+#define TFB_SIZE	(TFB_WIDTH * TFB_HEIGHT)
 
 #define CHR_TRANSPARENT	(0x00)
 #define CHR_OPAQUE		(0x01)
@@ -67,9 +69,33 @@ int ui_waitkey(int keymask);
 /* sets the video modes, initializes tiles and palettes */
 void ui_reset(void);
 
-/* get the charmap for the selected screen and background layer */
+/* get the (shadow) charmap for the selected screen and background layer */
 vu16 *ui_map(int screen, int bg);
 
+/*
+ * every layer is drawn into a shadow map in main RAM and only the rows
+ * marked dirty get copied to VRAM, from the VBlank interrupt
+ * anything writing to a map directly has to mark the rows it touched
+ *
+ * the shadows are as big as the hardware maps (32x32), so text running
+ * past the bottom lands off screen like it always did
+ */
+#define UI_SHADOW_SIZE	(TFB_WIDTH * 32)
+
+extern u16 ui_shadow[2][4][UI_SHADOW_SIZE];
+extern vu32 ui_dirty[2][4];
+
+/* marks the rows set in the `rows` bitmask of the map as dirty */
+static inline void ui_mark_rows(vu16 *map, u32 rows) {
+	size_t layer = ((u16*)map - &ui_shadow[0][0][0]) / UI_SHADOW_SIZE;
+	(&ui_dirty[0][0])[layer] |= rows;
+}
+
+/* marks `h` rows starting at `y` as dirty */
+static inline void ui_mark(vu16 *map, size_t y, size_t h) {
+	ui_mark_rows(map, (BIT(h) - 1) << y);
+}
+
 static inline int cchr_is_pal(int c)
 {
 	return (c >= CCHR_MIN && c <= CCHR_MAX);
@@ -81,13 +107,13 @@ static inline u16 cchr_to_pal(int c)
 	return TILE_PALETTE(CCHR_MAX - c);
 }
 
-/* fills the map with `c` */
+/* fills the map with `c`, through DMA */
 static inline void ui_tilemap_set(vu16 *map, int c) {
-	size_t mapsz = TFB_WIDTH * TFB_HEIGHT;
 	if (UNLIKELY(cchr_is_pal(c))) {
 		c = cchr_to_pal(c) | CHR_OPAQUE;
 	}
-	while(mapsz--) *(map++) = c;
+	xfer_fill16((void*)map, c, TFB_SIZE);
+	ui_mark(map, 0, TFB_HEIGHT);
 }
 
 /*
@@ -98,14 +124,34 @@ static inline void ui_tilemap_clr(vu16 *map) {
 	ui_tilemap_set(map, CHR_TRANSPARENT);
 }
 
-/* draw a single character to the map at the specified coordinates */
+/*
+ * draw a single character to the map at the specified coordinates
+ * the row only gets dirty if the character actually changed
+ */
 static inline void ui_drawc(vu16 *map, int c, size_t x, size_t y) {
 	if (UNLIKELY(cchr_is_pal(c))) {
 		c = cchr_to_pal(c) | CHR_OPAQUE;
 	}
-	map[y * TFB_WIDTH + x] = c;
+	if (map[y * TFB_WIDTH + x] != c) {
+		map[y * TFB_WIDTH + x] = c;
+		ui_mark(map, y, 1);
+	}
 }
 
+/*
+ * 32x32 4bpp icons, made of 4x4 tiles in the NDS banner layout
+ * every slot gets its own tiles right after the font and its own palette
+ */
+#define UI_ICON_SLOTS	(4)
+#define UI_ICON_DIM		(4)
+#define UI_ICON_TILES	(UI_ICON_DIM * UI_ICON_DIM)
+
+/* uploads the tiles (512 bytes, word aligned) and palette of an icon slot */
+void ui_icon_load(int screen, int slot, const void *tiles, const u16 *pal);
+
+/* draws the icon in `slot` with its top left corner at the coordinates */
+void ui_drawicon(vu16 *map, int slot, size_t x, size_t y);
+
 /* draws a string to the map at the specified coordinates */
 void ui_drawstr(vu16 *map, size_t x, size_t y, const char *str);
 void ui_drawstrf(vu16 *map, size_t x, size_t y, const char *fmt, ...);
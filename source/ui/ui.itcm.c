@@ -3,13 +3,18 @@
 #include <nds.h>
 
 #include "global.h"
+#include "arena.h"
 
 #include "ui.h"
 
 #include "font.h"
+#include "font_tiles_bin.h"
 
 static int ui_bg[2][4];
 
+u16 ui_shadow[2][4][UI_SHADOW_SIZE];
+vu32 ui_dirty[2][4];
+
 #define UI_MSGSCR	(SUBSCR)
 #define UI_ASKSCR	(SUBSCR)
 #define UI_MENUSCR	(MAINSCR)
@@ -17,12 +22,28 @@ static int ui_bg[2][4];
 
 #define STRBUF_LEN	(64)
 
+#define UI_ICON_PALBASE		(8)
+
+/* icon tiles go right after the font, whatever its size */
+#define UI_ICON_TILEBASE	(font_tiles_bin_size / 32)
+
+/*
+ * formats into arena scratch memory, UI_FORMAT_DONE gives it back
+ * the bare format string gets shown if the arena is full
+ */
 #define UI_FORMAT_HELPER(f, s) \
 	va_list va; \
-	char s[STRBUF_LEN]; \
-	va_start(va, (f)); \
-	vsnprintf(s, STRBUF_LEN-1, (f), va);\
-	va_end(va); \
+	arena_mark_t s##_mark = arena_push(); \
+	char *s = arena_alloc(STRBUF_LEN); \
+	if (s != NULL) { \
+		va_start(va, (f)); \
+		vsnprintf(s, STRBUF_LEN-1, (f), va);\
+		va_end(va); \
+	} else { \
+		s = (char*)(f); \
+	} \
+
+#define UI_FORMAT_DONE(s)	arena_pop(s##_mark)
 
 /*
  * index zero is always transparent
@@ -45,52 +66,23 @@ static void _ui_init_palette(vu16 *pal)
 	pal[COL_MAGENTA*16 + 15]	= RGB15(0x1F, 0x00, 0x1F);
 }
 
-/*
- * char zero is always a transparent tile
- * char one is always a full opaque block
- * everything else is transcoded from the font
- */
-static void _ui_init_font(const unsigned char *font, size_t chars, vu16 *tile)
-{
-	vu32 *tile32 = (vu32*)tile;
-
-	for (int i = 0; i < 8; i++)
-		tile32[i] = 0;
-
-	for (int i = 8; i < 16; i++)
-		tile32[i] = 0x11111111;
-
-	for (size_t i = 2; i < chars; i++) {
-		const unsigned char *current_char = &font[i * 8];
-		vu32 *current_tile = &tile32[i * 8];
-		for (int j = 0; j < 8; j++) {
-			unsigned char c = current_char[j];
-			u32 tile_row = 0x11111111;
-			while(c) {
-				int ctz = (31 - __builtin_clz(c));
-				tile_row |= (0xF << ((7 - ctz) << 2));
-				c &= ~(1 << ctz);
-			}
-			current_tile[j] = tile_row;
-		}
-	}
-}
-
 static void _ui_rect(vu16 *map, int c, size_t x,
 					size_t y, size_t w, size_t h)
 {
-	map += y * TFB_WIDTH;
-	w += x;
+	vu16 *row = map + y * TFB_WIDTH;
 
 	if (UNLIKELY(cchr_is_pal(c))) {
 		c = cchr_to_pal(c) | CHR_OPAQUE;
 	}
 
-	while(h--) {
-		for (size_t _x = x; _x < w; _x++)
-			map[_x] = c;
-		map += TFB_WIDTH;
+	/* marked after drawing, a flush in between would drop the rows */
+	for (size_t i = 0; i < h; i++) {
+		for (size_t _x = x; _x < x + w; _x++)
+			row[_x] = c;
+		row += TFB_WIDTH;
 	}
+
+	if (h) ui_mark(map, y, h);
 }
 
 static size_t _ui_strdim(const char *str, u8 *width, size_t *height)
@@ -115,10 +107,12 @@ static size_t _ui_strdim(const char *str, u8 *width, size_t *height)
 	return (str - str_s);
 }
 
+/* only rows where a character changed end up dirty */
 static void ui_drawmwidthstr(vu16 *map, u8 *x, size_t y, const char *str)
 {
 	size_t line = 0, i = y * TFB_WIDTH + x[0];
 	u16 color = 0;
+	u32 rows = 0;
 
 	while(*str) {
 		char c = *str;
@@ -128,11 +122,52 @@ static void ui_drawmwidthstr(vu16 *map, u8 *x, size_t y, const char *str)
 		} else if (UNLIKELY(cchr_is_pal(c))) {
 			color = cchr_to_pal(c);
 		} else {
-			map[i++] = (u16)c | color;
+			u16 t = (u16)c | color;
+			if (UNLIKELY(i >= UI_SHADOW_SIZE)) break;
+			if (map[i] != t) {
+				map[i] = t;
+				rows |= BIT(i / TFB_WIDTH);
+			}
+			i++;
 		}
 
 		str++;
 	}
+
+	ui_mark_rows(map, rows);
+}
+
+/*
+ * copies the dirty rows of every layer to VRAM, runs on VBlank
+ * a DMA transfer might've been interrupted, so this stays on the CPU
+ */
+static void _ui_flush(void)
+{
+	for (int s = 0; s < 2; s++) {
+		for (int l = 0; l < 4; l++) {
+			u16 *vram = bgGetMapPtr(ui_bg[s][l]);
+			u32 d = ui_dirty[s][l];
+
+			if (d == 0) continue;
+			ui_dirty[s][l] = 0;
+
+			/*
+			 * the rows past the screen are never shown, leaving them out
+			 * also keeps the run below from ever reaching bit 31
+			 */
+			d &= BIT(TFB_HEIGHT) - 1;
+
+			/* runs of adjacent rows go in one copy */
+			while(d) {
+				int y = __builtin_ctz(d);
+				int h = __builtin_ctz(~(d >> y));
+				size_t off = y * TFB_WIDTH;
+
+				xfer_copy_cpu(&vram[off], &ui_shadow[s][l][off], h * TFB_WIDTH * sizeof(u16));
+				d &= ~((BIT(h) - 1) << y);
+			}
+		}
+	}
 }
 
 int ui_waitkey(int keymask) {
@@ -170,9 +205,9 @@ void ui_reset(void)
 	_ui_init_palette(BG_PALETTE);
 	_ui_init_palette(BG_PALETTE_SUB);
 
-	/* intitialize font tiles */
-	_ui_init_font(font, 256, bgGetGfxPtr(ui_bg[MAINSCR][0]));
-	_ui_init_font(font, 256, bgGetGfxPtr(ui_bg[SUBSCR][0]));
+	/* font tiles are expanded at build time, see tools/fontgen.c */
+	xfer_copy(bgGetGfxPtr(ui_bg[MAINSCR][0]), font_tiles_bin, font_tiles_bin_size);
+	xfer_copy(bgGetGfxPtr(ui_bg[SUBSCR][0]), font_tiles_bin, font_tiles_bin_size);
 
 	/* clear tilemaps, enable bg layer */
 	for (int l = 0; l < 4; l++) {
@@ -181,17 +216,57 @@ void ui_reset(void)
 		videoBgEnable(l);
 		videoBgEnableSub(l);
 	}
+
+	/* the first flush goes right away, the rest on every VBlank */
+	_ui_flush();
+	irqSet(IRQ_VBLANK, _ui_flush);
+	irqEnable(IRQ_VBLANK);
 }
 
 vu16 *ui_map(int screen, int bg)
 {
-	return bgGetMapPtr(ui_bg[screen][bg]);
+	return ui_shadow[screen][bg];
+}
+
+void ui_icon_load(int screen, int slot, const void *tiles, const u16 *pal)
+{
+	vu32 *tdst = (vu32*)bgGetGfxPtr(ui_bg[screen][0]);
+	vu16 *pdst = (screen == MAINSCR) ? BG_PALETTE : BG_PALETTE_SUB;
+	const u32 *tsrc = (const u32*)tiles;
+
+	sassert(slot >= 0 && slot < UI_ICON_SLOTS, "invalid icon slot");
+
+	/* VRAM doesn't take byte writes, go through words */
+	tdst += (UI_ICON_TILEBASE + slot * UI_ICON_TILES) * 8;
+	for (int i = 0; i < UI_ICON_TILES * 8; i++)
+		tdst[i] = tsrc[i];
+
+	pdst += (UI_ICON_PALBASE + slot) * 16;
+	for (int i = 0; i < 16; i++)
+		pdst[i] = pal[i];
+}
+
+void ui_drawicon(vu16 *map, int slot, size_t x, size_t y)
+{
+	u16 tile = (UI_ICON_TILEBASE + slot * UI_ICON_TILES) |
+		TILE_PALETTE(UI_ICON_PALBASE + slot);
+
+	vu16 *row = map + y * TFB_WIDTH + x;
+
+	for (int ty = 0; ty < UI_ICON_DIM; ty++) {
+		for (int tx = 0; tx < UI_ICON_DIM; tx++)
+			row[tx] = tile++;
+		row += TFB_WIDTH;
+	}
+
+	ui_mark(map, y, UI_ICON_DIM);
 }
 
 void ui_drawstr(vu16 *map, size_t x, size_t y, const char *str)
 {
 	size_t i = y * TFB_WIDTH + x;
 	u16 color = 0;
+	u32 rows = 0;
 
 	while(*str) {
 		char c = *str;
@@ -201,17 +276,26 @@ void ui_drawstr(vu16 *map, size_t x, size_t y, const char *str)
 		} else if (UNLIKELY(cchr_is_pal(c))) {
 			color = cchr_to_pal(c);
 		} else {
-			map[i++] = (u16)c | color;
+			u16 t = (u16)c | color;
+			if (UNLIKELY(i >= UI_SHADOW_SIZE)) break;
+			if (map[i] != t) {
+				map[i] = t;
+				rows |= BIT(i / TFB_WIDTH);
+			}
+			i++;
 		}
 
 		str++;
 	}
+
+	ui_mark_rows(map, rows);
 }
 
 void ui_drawstrf(vu16 *map, size_t x, size_t y, const char *fmt, ...)
 {
 	UI_FORMAT_HELPER(fmt, str);
 	ui_drawstr(map, x, y, str);
+	UI_FORMAT_DONE(str);
 }
 
 int ui_drawstr_center(vu16 *map, const char *str)
@@ -231,8 +315,11 @@ int ui_drawstr_center(vu16 *map, const char *str)
 
 int ui_drawstr_centerf(vu16 *map, const char *fmt, ...)
 {
+	int ret;
 	UI_FORMAT_HELPER(fmt, str);
-	return ui_drawstr_center(map, str);
+	ret = ui_drawstr_center(map, str);
+	UI_FORMAT_DONE(str);
+	return ret;
 }
 
 int ui_drawstr_xcenter(vu16 *map, size_t y, const char *str)
@@ -250,8 +337,11 @@ int ui_drawstr_xcenter(vu16 *map, size_t y, const char *str)
 
 int ui_drawstr_xcenterf(vu16 *map, size_t y, const char *fmt, ...)
 {
+	int ret;
 	UI_FORMAT_HELPER(fmt, str);
-	return ui_drawstr_xcenter(map, y, str);
+	ret = ui_drawstr_xcenter(map, y, str);
+	UI_FORMAT_DONE(str);
+	return ret;
 }
 
 int ui_drawstr_ycenter(vu16 *map, size_t x, const char *str)
@@ -270,8 +360,11 @@ int ui_drawstr_ycenter(vu16 *map, size_t x, const char *str)
 
 int ui_drawstr_ycenterf(vu16 *map, size_t x, const char *fmt, ...)
 {
+	int ret;
 	UI_FORMAT_HELPER(fmt, str);
-	return ui_drawstr_ycenter(map, x, str);
+	ret = ui_drawstr_ycenter(map, x, str);
+	UI_FORMAT_DONE(str);
+	return ret;
 }
 
 void ui_msg(const char *str)
@@ -288,6 +381,7 @@ void ui_msgf(const char *fmt, ...)
 {
 	UI_FORMAT_HELPER(fmt, str);
 	ui_msg(str);
+	UI_FORMAT_DONE(str);
 }
 
 bool ui_ask(const char *str)
@@ -306,8 +400,11 @@ bool ui_ask(const char *str)
 
 bool ui_askf(const char *fmt, ...)
 {
+	bool ret;
 	UI_FORMAT_HELPER(fmt, str);
-	return ui_ask(str);
+	ret = ui_ask(str);
+	UI_FORMAT_DONE(str);
+	return ret;
 }
 
 /* shamelessly ""inspired"" by gm9 */
@@ -432,8 +529,11 @@ int ui_menu(int nopt, const ui_menu_entry *opt, const char *str)
 
 int ui_menuf(int nopt, const ui_menu_entry *opt, const char *fmt, ...)
 {
+	int ret;
 	UI_FORMAT_HELPER(fmt, str);
-	return ui_menu(nopt, opt, str);
+	ret = ui_menu(nopt, opt, str);
+	UI_FORMAT_DONE(str);
+	return ret;
 }
 
 void ui_progress(uint64_t cur, uint64_t tot, const char *un, const char *str)
@@ -476,4 +576,5 @@ void ui_progressf(uint64_t cur, uint64_t tot, const char *un, const char *fmt, .
 {
 	UI_FORMAT_HELPER(fmt, str);
 	ui_progress(cur, tot, un, str);
+	UI_FORMAT_DONE(str);
 }
@@ -2,16 +2,37 @@
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
 
 #include "vfs.h"
 
+#include "slab.h"
 #include "vfd.h"
+#include "vfs_stats.h"
 
-#define VFS_CALL_OP(mnt, op, ...) ({ \
+#define _VFS_RAW_OP(mnt, op, ...) ({ \
 	const vfs_ops_t *o = (mnt)->ops; \
 	(UNLIKELY(o->op == NULL)) ?      \
 	-ERR_UNSUPP : o->op(__VA_ARGS__);})
 
+/* whatever the backend allocates meanwhile is charged to the mount */
+#define _VFS_CALL_OP(mnt, op, ...) ({ \
+	int _owner = mem_owner_set(_vfs_mount_owner(mnt)); \
+	typeof(_VFS_RAW_OP(mnt, op, __VA_ARGS__)) _o = _VFS_RAW_OP(mnt, op, __VA_ARGS__); \
+	mem_owner_set(_owner); \
+	_o;})
+
+#ifdef VFS_STATS
+/* same as below, with the time taken and the result counted */
+#define VFS_CALL_OP(mnt, op, ...) ({ \
+	u32 _start = vfs_stats_now(); \
+	typeof(_VFS_CALL_OP(mnt, op, __VA_ARGS__)) _r = _VFS_CALL_OP(mnt, op, __VA_ARGS__); \
+	vfs_stats_op(_vfs_mount_idx(mnt), VFS_OP_##op, _start, _r); \
+	_r;})
+#else
+#define VFS_CALL_OP(mnt, op, ...) _VFS_CALL_OP(mnt, op, __VA_ARGS__)
+#endif
+
 static struct {
 	mount_t *mount;
 	int open_handles;
@@ -19,6 +40,14 @@ static struct {
 
 static int mounted_filesystems;
 
+/* bumped by anything that can change what a path refers to */
+static u32 vfs_changes;
+
+static vfs_unpack_fn vfs_unpack;
+
+/* one spare for a mount being set up while every drive is taken */
+static slab_t mount_slab = SLAB_INIT("mount", mount_t, VFS_MOUNTPOINTS + 1);
+
 static inline int _vfs_drvlet_to_idx(int drv)
 {
 	if (VFS_DRVVALID(drv)) return (drv - VFS_FIRSTMOUNT);
@@ -53,6 +82,17 @@ static inline void _vfs_actives_dec(int idx)
 	(mount_state[idx].open_handles)--;
 }
 
+#ifdef VFS_STATS
+/* mount being set up or torn down aren't in the table, that gives -1 */
+static int _vfs_mount_idx(const mount_t *mnt)
+{
+	for (int i = 0; i < VFS_MOUNTPOINTS; i++) {
+		if (mount_state[i].mount == mnt) return i;
+	}
+	return -1;
+}
+#endif
+
 static inline void _vfs_reset_mount(int drv)
 {
 	int idx = _vfs_drvlet_to_idx(drv);
@@ -69,6 +109,7 @@ static inline void _vfs_set_mount(int drv, mount_t *mnt)
 
 	mount_state[idx].mount = mnt;
 	mount_state[idx].open_handles = 0;
+	vfs_stats_reset_mount(idx);
 }
 
 static void __attribute__((constructor)) __vfs_ctor(void)
@@ -97,6 +138,24 @@ static int _vfs_check_lpath(const char *lp)
 
 
 
+static inline int _vfs_mount_owner(const mount_t *mnt)
+{
+	return mnt->owner;
+}
+
+/* the pool slot identifies the mount to the allocator */
+mount_t *vfs_mount_alloc(void)
+{
+	mount_t *mnt = slab_alloc(&mount_slab);
+	if (mnt != NULL) mnt->owner = slab_index(&mount_slab, mnt) + 1;
+	return mnt;
+}
+
+void vfs_mount_free(mount_t *mnt)
+{
+	slab_free(&mount_slab, mnt);
+}
+
 int vfs_mountedcnt(void)
 {
 	return mounted_filesystems;
@@ -107,6 +166,16 @@ int vfs_state(int drive)
 	return _vfs_actives(drive);
 }
 
+u32 vfs_generation(void)
+{
+	return vfs_changes;
+}
+
+void vfs_set_unpack(vfs_unpack_fn fn)
+{
+	vfs_unpack = fn;
+}
+
 int vfs_mount(int drive, mount_t *mnt_info)
 {
 	int res;
@@ -121,6 +190,7 @@ int vfs_mount(int drive, mount_t *mnt_info)
 	} else {
 		_vfs_set_mount(drive, mnt_info);
 		mounted_filesystems++;
+		vfs_changes++;
 	}
 
 	return res;
@@ -128,19 +198,26 @@ int vfs_mount(int drive, mount_t *mnt_info)
 
 int vfs_unmount(int drive)
 {
-	int res;
+	int res, owner;
 	mount_t *mnt;
+	char what[] = "unmount ?:";
 
 	/* make sure the index is valid, the fs is mounted and no files are open */
 	if (!_vfs_mounted(drive)) return -ERR_NOTREADY;
 	if (_vfs_actives(drive) > 0) return -ERR_BUSY;
 	mnt = _vfs_mount(drive);
 
-	/* call the unmount operation */
+	/* the backend hands mnt back to the pool on success, keep the owner */
+	owner = _vfs_mount_owner(mnt);
+
+	/* call the unmount operation, the backend should've freed everything */
 	res = VFS_CALL_OP(mnt, unmount, mnt);
 	if (!IS_ERR(res)) {
+		what[8] = drive;
+		mem_owner_check(owner, what);
 		_vfs_reset_mount(drive);
 		mounted_filesystems--;
+		vfs_changes++;
 	}
 
 	return res;
@@ -152,11 +229,17 @@ int vfs_open(const char *path, int mode)
 	mount_t *mnt;
 	const char *lp;
 
-	int res, fd, drv;
+	int res, fd, drv, unpack;
 
 	/* sanity checks */
 	if (path == NULL) return -ERR_MEM;
 
+	/* decompressed views are read-only and not a mount capability */
+	unpack = mode & VFS_UNPACK;
+	mode &= ~VFS_UNPACK;
+	if (unpack && (mode & VFS_WO)) return -ERR_ARG;
+	if (unpack && vfs_unpack == NULL) return -ERR_UNSUPP;
+
 	drv = *path;
 	if (!_vfs_mounted(drv)) return -ERR_NOTREADY;
 
@@ -180,9 +263,16 @@ int vfs_open(const char *path, int mode)
 
 	/* call the open operation, inc actives if successful */
 	res = VFS_CALL_OP(mnt, open, mnt, file, lp, mode);
+	if (!IS_ERR(res) && unpack) {
+		res = vfs_unpack(file);
+		if (IS_ERR(res)) VFS_CALL_OP(mnt, close, mnt, file);
+	}
+
 	if (IS_ERR(res)) {
 		vfd_return(fd);
 	} else {
+		/* creating truncates, that's a change already */
+		if (mode & VFS_WO) vfs_changes++;
 		_vfs_actives_inc(file->idx);
 		res = fd;
 	}
@@ -205,8 +295,9 @@ int vfs_close(int fd)
 	mnt = file->mnt;
 	res = VFS_CALL_OP(mnt, close, mnt, file);
 	if (!IS_ERR(res)) {
-		vfd_return(fd);
+		/* vfd_return clears the file, drop the mount reference first */
 		_vfs_actives_dec(file->idx);
+		vfd_return(fd);
 	}
 
 	return res;
@@ -227,6 +318,7 @@ int vfs_unlink(const char *path)
 	if (!_vfs_check_lpath(lp)) return -ERR_ARG;
 
 	mnt = _vfs_mount(drv);
+	vfs_changes++;
 	return VFS_CALL_OP(mnt, unlink, mnt, lp);
 }
 
@@ -251,9 +343,42 @@ int vfs_rename(const char *oldp, const char *newp)
 	if (!_vfs_check_lpath(lop) || !_vfs_check_lpath(lnp)) return -ERR_ARG;
 
 	mnt = _vfs_mount(odrv);
+	vfs_changes++;
 	return VFS_CALL_OP(mnt, rename, mnt, lop, lnp);
 }
 
+int vfs_stat(const char *path, vfs_stat_t *st)
+{
+	int drv;
+	mount_t *mnt;
+	const char *lp;
+
+	if (path == NULL || st == NULL) return -ERR_MEM;
+
+	drv = *path;
+	if (!_vfs_mounted(drv)) return -ERR_NOTREADY;
+
+	lp = _vfs_get_lpath(path);
+	if (!_vfs_check_lpath(lp)) return -ERR_ARG;
+
+	mnt = _vfs_mount(drv);
+	return VFS_CALL_OP(mnt, stat, mnt, lp, st);
+}
+
+off_t vfs_pread(int fd, void *buf, off_t size, off_t pos)
+{
+	vf_t *file;
+
+	if (!vfd_valid_fd(fd) || pos < 0) return -ERR_ARG;
+
+	file = vfd_get(fd);
+	if (!_vf_opened(file) || !_vf_file(file)) return -ERR_NOTREADY;
+
+	/* backends always read from file->pos, no need for a size lookup */
+	file->pos = pos;
+	return vfs_read(fd, buf, size);
+}
+
 off_t vfs_read(int fd, void *buf, off_t size)
 {
 	mount_t *mnt;
@@ -302,6 +427,7 @@ off_t vfs_write(int fd, const void *buf, off_t size)
 	}
 
 	mnt = file->mnt;
+	vfs_changes++;
 	wb = VFS_CALL_OP(mnt, write, mnt, file, buf, size);
 	if (!IS_ERR(wb)) {
 		file->pos += wb;
@@ -309,6 +435,19 @@ off_t vfs_write(int fd, const void *buf, off_t size)
 	return wb;
 }
 
+off_t vfs_pwrite(int fd, const void *buf, off_t size, off_t pos)
+{
+	vf_t *file;
+
+	if (!vfd_valid_fd(fd) || pos < 0) return -ERR_ARG;
+
+	file = vfd_get(fd);
+	if (!_vf_opened(file) || !_vf_file(file)) return -ERR_NOTREADY;
+
+	file->pos = pos;
+	return vfs_write(fd, buf, size);
+}
+
 off_t vfs_seek(int fd, off_t off, int whence)
 {
 	vf_t *file;
@@ -363,6 +502,40 @@ off_t vfs_size(int fd)
 	return VFS_CALL_OP(mnt, size, mnt, file);
 }
 
+int vfs_map(int fd, off_t pos, const void **ptr, off_t *len)
+{
+	mount_t *mnt;
+	vf_t *file;
+
+	if (!vfd_valid_fd(fd) || pos < 0) return -ERR_ARG;
+	if (ptr == NULL || len == NULL) return -ERR_MEM;
+
+	file = vfd_get(fd);
+	if (!_vf_opened(file) || !_vf_file(file)) return -ERR_NOTREADY;
+	if (!_vf_readable(file)) return -ERR_ARG;
+
+	mnt = file->mnt;
+	return VFS_CALL_OP(mnt, map, mnt, file, pos, ptr, len);
+}
+
+int vfs_unmap(int fd, const void *ptr)
+{
+	const vfs_ops_t *ops;
+	mount_t *mnt;
+	vf_t *file;
+
+	if (!vfd_valid_fd(fd)) return -ERR_ARG;
+
+	file = vfd_get(fd);
+	if (!_vf_opened(file) || !_vf_file(file)) return -ERR_NOTREADY;
+
+	/* windows without an unmap op don't hold anything */
+	mnt = file->mnt;
+	ops = mnt->ops;
+	if (ops->unmap == NULL) return 0;
+	return VFS_CALL_OP(mnt, unmap, mnt, file, ptr);
+}
+
 int vfs_mkdir(const char *path)
 {
 	mount_t *mnt;
@@ -68,6 +68,7 @@ typedef struct {
 	const void *ops;	/**< Filesystem operations */
 	vfs_info_t info;	/**< Filesystem information */
 	int caps;			/**< Capability bitmask */
+	int owner;			/**< Heap owner id, set by vfs_mount_alloc */
 
 	void *priv;
 } mount_t;
@@ -84,10 +85,18 @@ typedef struct {
 typedef struct {
 	char path[MAX_PATH + 1];	/**< Directory item path */
 	int flags;					/**< Directory item flags */
+	off_t size;					/**< Item size, zero for directories */
+	u32 mtime;					/**< Modification timestamp, zero if unknown */
 
 	void *priv;
 } dirinf_t;
 
+typedef struct {
+	int flags;		/**< Item flags */
+	off_t size;		/**< Item size, zero for directories */
+	u32 mtime;		/**< Modification timestamp, zero if unknown */
+} vfs_stat_t;
+
 typedef struct {
 	int (*mount)(mount_t *mnt);
 	int (*unmount)(mount_t *mnt);
@@ -97,11 +106,20 @@ typedef struct {
 
 	int (*unlink)(mount_t *mnt, const char *path);
 	int (*rename)(mount_t *mnt, const char *oldp, const char *newp);
+	int (*stat)(mount_t *mnt, const char *path, vfs_stat_t *st);
 
 	off_t (*read)(mount_t *mnt, vf_t *file, void *buf, off_t size);
 	off_t (*write)(mount_t *mnt, vf_t *file, const void *buf, off_t size);
 	off_t (*size)(mount_t *mnt, vf_t *file);
 
+	/*
+	 * optional, gives a read-only window straight into the file contents
+	 * starting at `pos`, for backends that keep the data in memory
+	 * unmap can be left out if there's nothing to release
+	 */
+	int (*map)(mount_t *mnt, vf_t *file, off_t pos, const void **ptr, off_t *len);
+	int (*unmap)(mount_t *mnt, vf_t *file, const void *ptr);
+
 	int (*mkdir)(mount_t *mnt, const char *path);
 	int (*diropen)(mount_t *mnt, vf_t *dir, const char *path);
 	int (*dirclose)(mount_t *mnt, vf_t *dir);
@@ -118,24 +136,63 @@ enum {
 
 	VFS_FILE	= BIT(4),			/**< Entity is a file */
 	VFS_DIR		= BIT(5),			/**< Entity is a dir */
+
+	VFS_UNPACK	= BIT(6),			/**< Open the unpacked contents, see vfs_set_unpack */
 };
 
+/*
+ * turns a freshly opened file into a read-only view of its unpacked
+ * contents, vfs_open calls it for VFS_UNPACK, closing the file drops the view
+ */
+typedef int (*vfs_unpack_fn)(vf_t *file);
+
+/* installs the VFS_UNPACK handler, without one those opens fail */
+void vfs_set_unpack(vfs_unpack_fn fn);
+
 int vfs_mountedcnt(void);
 int vfs_state(int drive);
 
+/*
+ * changes on every mount, unmount, write, unlink and rename, caches keyed
+ * by path keep the value they were filled at and drop everything once it moves
+ */
+u32 vfs_generation(void);
+
 int vfs_mount(int drive, mount_t *mnt);
 int vfs_unmount(int drive);
 
+/* mount descriptors for the filesystem backends, from a fixed pool */
+mount_t *vfs_mount_alloc(void);
+void vfs_mount_free(mount_t *mnt);
+
 int vfs_open(const char *path, int mode);
 int vfs_close(int fd);
 int vfs_unlink(const char *path);
 int vfs_rename(const char *oldp, const char *newp);
+int vfs_stat(const char *path, vfs_stat_t *st);
 
 off_t vfs_read(int fd, void *buf, off_t size);
+
+/*
+ * reads from `pos`, unlike POSIX pread the file position moves too and
+ * ends up at `pos` plus whatever was read, so a vfs_read carries on after it
+ */
+off_t vfs_pread(int fd, void *buf, off_t size, off_t pos);
 off_t vfs_write(int fd, const void *buf, off_t size);
+
+/* writes at `pos`, the file position moves along just like vfs_pread's */
+off_t vfs_pwrite(int fd, const void *buf, off_t size, off_t pos);
 off_t vfs_seek(int fd, off_t off, int whence);
 off_t vfs_size(int fd);
 
+/*
+ * maps the file contents from `pos` on, `len` gets the window size
+ * which can be shorter than the rest of the file
+ * returns -ERR_UNSUPP when the backend can't, callers fall back to reading
+ */
+int vfs_map(int fd, off_t pos, const void **ptr, off_t *len);
+int vfs_unmap(int fd, const void *ptr);
+
 int vfs_mkdir(const char *path);
 int vfs_diropen(const char *path);
 int vfs_dirclose(int dd);
@@ -0,0 +1,231 @@
+#ifndef ARM9
+#define _POSIX_C_SOURCE	199309L	/* clock_gettime on host builds */
+#include <time.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+#include "arena.h"
+
+#include "vfs.h"
+
+#include "devfs.h"
+#include "slab.h"
+#include "vfs_stats.h"
+
+#ifdef VFS_STATS
+
+static const char *const vfs_op_names[VFS_OP_COUNT] = {
+	"mount", "unmount", "open", "close", "unlink", "rename", "stat",
+	"read", "write", "size", "map", "unmap",
+	"mkdir", "diropen", "dirclose", "dirnext",
+};
+
+static vfs_opstat_t op_stats[VFS_OP_COUNT];
+static vfs_mntstat_t mnt_stats[VFS_MOUNTPOINTS][VFS_OP_COUNT];
+static vfs_diskstat_t disk_stats[VFS_STATS_DISKS][2];
+
+#ifdef ARM9
+static void __attribute__((constructor)) __vfs_stats_ctor(void)
+{
+	cpuStartTiming(VFS_STATS_TIMER);
+}
+
+u32 vfs_stats_now(void)
+{
+	return cpuGetTiming();
+}
+
+/* 2^16 / 33.513982 ~= 1955, close enough for a histogram */
+static inline u32 _vfs_stats_us(u32 start)
+{
+	return ((u64)(cpuGetTiming() - start) * 1955) >> 16;
+}
+#else
+u32 vfs_stats_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u32)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline u32 _vfs_stats_us(u32 start)
+{
+	return vfs_stats_now() - start;
+}
+#endif
+
+static inline int _vfs_stats_bucket(u32 us)
+{
+	int b = us ? (32 - __builtin_clz(us)) : 0;
+	return (b < VFS_STATS_BUCKETS) ? b : (VFS_STATS_BUCKETS - 1);
+}
+
+void vfs_stats_op(int idx, int op, u32 start, off_t res)
+{
+	u32 us = _vfs_stats_us(start);
+	vfs_opstat_t *os = &op_stats[op];
+	u64 bytes = 0;
+
+	if (!IS_ERR(res) && (op == VFS_OP_read || op == VFS_OP_write))
+		bytes = res;
+
+	os->calls++;
+	os->errors += IS_ERR(res);
+	os->bytes += bytes;
+	os->time_us += us;
+	if (us > os->max_us) os->max_us = us;
+	os->hist[_vfs_stats_bucket(us)]++;
+
+	if (VFS_IDXVALID(idx)) {
+		vfs_mntstat_t *ms = &mnt_stats[idx][op];
+
+		ms->calls++;
+		ms->errors += IS_ERR(res);
+		ms->bytes += bytes;
+		ms->time_us += us;
+	}
+}
+
+void vfs_stats_disk(int pdrv, bool write, u32 count, u32 start, bool ok)
+{
+	vfs_diskstat_t *ds;
+	u32 us = _vfs_stats_us(start);
+
+	if (pdrv < 0 || pdrv >= VFS_STATS_DISKS) return;
+
+	ds = &disk_stats[pdrv][write];
+	ds->calls++;
+	ds->errors += !ok;
+	ds->sectors += count;
+	ds->time_us += us;
+}
+
+void vfs_stats_reset_mount(int idx)
+{
+	if (VFS_IDXVALID(idx)) memset(mnt_stats[idx], 0, sizeof(mnt_stats[idx]));
+}
+
+void vfs_stats_reset(void)
+{
+	memset(op_stats, 0, sizeof(op_stats));
+	memset(mnt_stats, 0, sizeof(mnt_stats));
+	memset(disk_stats, 0, sizeof(disk_stats));
+}
+
+/* appends to the report, keeps track of the space left */
+#define STATS_PRINTF(...) do { \
+	int _n = snprintf(&buf[pos], len - pos, __VA_ARGS__); \
+	if (_n < 0) _n = 0; \
+	pos += ((size_t)_n < (len - pos)) ? (size_t)_n : (len - pos - 1); \
+} while(0)
+
+size_t vfs_stats_format(char *buf, size_t len)
+{
+	size_t pos = 0;
+
+	if (len == 0) return 0;
+	buf[0] = '\0';
+
+	STATS_PRINTF("%-8s %8s %5s %10s %10s %8s\n",
+		"op", "calls", "errs", "bytes", "total_us", "max_us");
+	for (int op = 0; op < VFS_OP_COUNT; op++) {
+		const vfs_opstat_t *os = &op_stats[op];
+		if (os->calls == 0) continue;
+
+		STATS_PRINTF("%-8s %8lu %5lu %10llu %10llu %8lu\n", vfs_op_names[op],
+			(unsigned long)os->calls, (unsigned long)os->errors,
+			(unsigned long long)os->bytes, (unsigned long long)os->time_us,
+			(unsigned long)os->max_us);
+	}
+
+	STATS_PRINTF("\nlatency (us lower bound:calls)\n");
+	for (int op = 0; op < VFS_OP_COUNT; op++) {
+		const vfs_opstat_t *os = &op_stats[op];
+		if (os->calls == 0) continue;
+
+		STATS_PRINTF("%-8s", vfs_op_names[op]);
+		for (int b = 0; b < VFS_STATS_BUCKETS; b++) {
+			if (os->hist[b] == 0) continue;
+			STATS_PRINTF(" %lu:%lu", b ? (1UL << (b - 1)) : 0UL, (unsigned long)os->hist[b]);
+		}
+		STATS_PRINTF("\n");
+	}
+
+	STATS_PRINTF("\nper drive\n");
+	for (int idx = 0; idx < VFS_MOUNTPOINTS; idx++) {
+		for (int op = 0; op < VFS_OP_COUNT; op++) {
+			const vfs_mntstat_t *ms = &mnt_stats[idx][op];
+			if (ms->calls == 0) continue;
+
+			STATS_PRINTF("%c: %-8s %8lu %5lu %10llu %10llu\n",
+				VFS_FIRSTMOUNT + idx, vfs_op_names[op],
+				(unsigned long)ms->calls, (unsigned long)ms->errors,
+				(unsigned long long)ms->bytes, (unsigned long long)ms->time_us);
+		}
+	}
+
+	STATS_PRINTF("\ndisk (sectors)\n");
+	for (int d = 0; d < VFS_STATS_DISKS; d++) {
+		for (int w = 0; w < 2; w++) {
+			const vfs_diskstat_t *ds = &disk_stats[d][w];
+			if (ds->calls == 0) continue;
+
+			STATS_PRINTF("%d: %-5s %8lu %5lu %10lu %10llu\n", d, w ? "write" : "read",
+				(unsigned long)ds->calls, (unsigned long)ds->errors,
+				(unsigned long)ds->sectors, (unsigned long long)ds->time_us);
+		}
+	}
+
+	STATS_PRINTF("\npools (objsz used/max)\n");
+	pos += slab_format(&buf[pos], len - pos);
+
+	STATS_PRINTF("\narena peak %u/%u fail %lu\n",
+		(unsigned)arena_peak(), (unsigned)ARENA_SIZE, (unsigned long)arena_fails());
+
+	return pos;
+}
+
+static char stats_text[VFS_STATS_TEXTSZ];
+
+/* takes a fresh snapshot, so the size stays put while the file is open */
+static int stats_dev_open(devfs_entry_t *entry)
+{
+	entry->size = vfs_stats_format(stats_text, sizeof(stats_text));
+	return 0;
+}
+
+static off_t stats_dev_read(devfs_entry_t *entry, void *buf, off_t pos, off_t size)
+{
+	memcpy(buf, &stats_text[pos], size);
+	return size;
+}
+
+static off_t stats_dev_write(devfs_entry_t *entry, const void *buf, off_t pos, off_t size)
+{
+	return -ERR_UNSUPP;
+}
+
+static devfs_entry_t stats_entries[] = {
+	{.name = "/vfs", .size = 0, .flags = VFS_FILE | VFS_RO},
+};
+
+static devfs_t stats_devfs = {
+	.dev_entry = stats_entries,
+	.n_entries = ARRAY_SIZE(stats_entries),
+	.label = "Stats",
+	.dev_open = stats_dev_open,
+	.dev_read = stats_dev_read,
+	.dev_write = stats_dev_write,
+};
+
+int vfs_stats_init(char drive)
+{
+	return devfs_mount(drive, &stats_devfs);
+}
+
+#endif /* VFS_STATS */
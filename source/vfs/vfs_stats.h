@@ -0,0 +1,110 @@
+#ifndef VFS_STATS_H__
+#define VFS_STATS_H__
+
+#include <nds.h>
+
+#include "vfs.h"
+
+/*
+ * VFS and disk I/O counters, only built with -DVFS_STATS (make STATS=1)
+ * without it every hook below expands to nothing
+ *
+ * every backend op dispatched by vfs.c gets its calls, errors, bytes
+ * moved (read/write) and time spent counted globally and per drive
+ * the global counters also keep a log2 latency histogram
+ */
+
+/* one per vfs_ops_t member, in the same order */
+enum {
+	VFS_OP_mount = 0,
+	VFS_OP_unmount,
+	VFS_OP_open,
+	VFS_OP_close,
+	VFS_OP_unlink,
+	VFS_OP_rename,
+	VFS_OP_stat,
+	VFS_OP_read,
+	VFS_OP_write,
+	VFS_OP_size,
+	VFS_OP_map,
+	VFS_OP_unmap,
+	VFS_OP_mkdir,
+	VFS_OP_diropen,
+	VFS_OP_dirclose,
+	VFS_OP_dirnext,
+	VFS_OP_COUNT,
+};
+
+/* bucket 0 is under 1us, bucket n is [2^(n-1), 2^n) us, the last one takes the rest */
+#define VFS_STATS_BUCKETS	(20)
+
+/* FatFs physical drives tracked by the disk counters */
+#define VFS_STATS_DISKS		(10)
+
+/* size of the text snapshot behind the devfs entry */
+#define VFS_STATS_TEXTSZ	(SIZE_KIB(8))
+
+#ifdef VFS_STATS
+
+/* timers 2 and 3 are cascaded for the timestamps on ARM9 */
+#define VFS_STATS_TIMER		(2)
+
+typedef struct {
+	u32 calls;
+	u32 errors;
+	u64 bytes;
+	u64 time_us;
+	u32 max_us;
+	u32 hist[VFS_STATS_BUCKETS];
+} vfs_opstat_t;
+
+typedef struct {
+	u32 calls;
+	u32 errors;
+	u64 bytes;
+	u64 time_us;
+} vfs_mntstat_t;
+
+typedef struct {
+	u32 calls;
+	u32 errors;
+	u32 sectors;
+	u64 time_us;
+} vfs_diskstat_t;
+
+/* opaque timestamp, only meaningful as the `start` of the calls below */
+u32 vfs_stats_now(void);
+
+/* counts an op that began at `start`, `idx` is the drive index or -1 */
+void vfs_stats_op(int idx, int op, u32 start, off_t res);
+
+/* counts a disk_read/disk_write of `count` sectors */
+void vfs_stats_disk(int pdrv, bool write, u32 count, u32 start, bool ok);
+
+/* clears the counters of a drive, called when it gets mounted */
+void vfs_stats_reset_mount(int idx);
+
+/* clears everything */
+void vfs_stats_reset(void);
+
+/*
+ * writes a text report of every non-zero counter into `buf`
+ * returns its length, the text gets cut short if it doesn't fit
+ */
+size_t vfs_stats_format(char *buf, size_t len);
+
+/* mounts a devfs drive with the report as "/vfs", refreshed on every open */
+int vfs_stats_init(char drive);
+
+#else
+
+/* the start timestamps still get used, callers keep them in plain locals */
+#define vfs_stats_now()						(0)
+#define vfs_stats_op(idx, op, start, res)	do { (void)(start); } while(0)
+#define vfs_stats_disk(pdrv, w, c, s, ok)	do { (void)(s); } while(0)
+#define vfs_stats_reset_mount(idx)			do {} while(0)
+#define vfs_stats_reset()					do {} while(0)
+
+#endif /* VFS_STATS */
+
+#endif /* VFS_STATS_H__ */
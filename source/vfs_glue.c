@@ -1,9 +1,12 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <strings.h>
 #include <nds.h>
 
 #include "global.h"
 #include "err.h"
+#include "mem.h"
+#include "arena.h"
 
 #include "ui.h"
 #include "vfs.h"
@@ -24,6 +27,14 @@ size_t path_basedir(char *path)
 	return (path - path_s);
 }
 
+int vfs_free_drive(void)
+{
+	for (int i = VFS_FIRSTMOUNT; i <= VFS_LASTMOUNT; i++) {
+		if (vfs_state(i) < 0) return i;
+	}
+	return -ERR_BUSY;
+}
+
 int open_compound_path(int mode, const char *fmt, ...)
 {
 	char path[MAX_PATH + 1];
@@ -36,6 +47,19 @@ int open_compound_path(int mode, const char *fmt, ...)
 	return vfs_open(path, mode);
 }
 
+const char *path_extension(const char *path)
+{
+	const char *ext = NULL;
+
+	while(*path) {
+		if (*path == '/') ext = NULL;
+		else if (*path == '.') ext = path + 1;
+		path++;
+	}
+
+	return (ext && *ext) ? ext : NULL;
+}
+
 /* this should be a gcc intrinsic tbh... */
 static inline size_t ctz64(uint64_t n) {
 	size_t lower = n, upper = n >> 32;
@@ -69,3 +93,372 @@ size_t size_format(char *out, off_t size)
 
 	return sprintf(out, "%d.%d %ciB", (int)intp, (int)decp, sizepre[mag/10]);
 }
+
+#define TREE_COPYBUF	(SIZE_KIB(32))
+
+typedef struct {
+	int dd;			/* open directory descriptor */
+	size_t plen;	/* path length up to and including the trailing slash */
+} tree_frame_t;
+
+typedef struct {
+	char path[MAX_PATH + 1];
+	dirinf_t inf;
+	tree_frame_t stack[TREE_MAXDEPTH];
+} tree_state_t;
+
+static inline bool tree_path_is_dir(const char *p, size_t l) {
+	return l > 0 && p[l - 1] == '/';
+}
+
+static int tree_walk_file(const char *path, tree_walk_fn fn, void *priv)
+{
+	dirinf_t *inf;
+	vfs_stat_t st;
+	off_t size;
+	int fd, res;
+	arena_mark_t mark;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+	size = vfs_size(fd);
+	vfs_close(fd);
+	if (IS_ERR(size)) return size;
+
+	/* dirinf_t carries a full path, keep it off the stack */
+	mark = arena_push();
+	inf = arena_alloc(sizeof(*inf));
+	if (inf == NULL) return -ERR_MEM;
+
+	strcpy(inf->path, path);
+	inf->flags = VFS_FILE;
+	inf->size = size;
+
+	/* not every backend can stat, the timestamp is optional anyway */
+	inf->mtime = 0;
+	if (!IS_ERR(vfs_stat(path, &st))) inf->mtime = st.mtime;
+
+	res = fn(path, inf, VFS_FILE, priv);
+	arena_pop(mark);
+	return res;
+}
+
+int tree_walk(const char *root, int order, tree_walk_fn fn, void *priv)
+{
+	tree_state_t *st;
+	tree_frame_t *top;
+	int res, dd, depth;
+	size_t rlen;
+	arena_mark_t mark;
+
+	if (root == NULL || fn == NULL) return -ERR_MEM;
+
+	rlen = strlen(root);
+	if (rlen == 0 || rlen > MAX_PATH) return -ERR_ARG;
+
+	/* a lone file is a tree with a single leaf */
+	if (!tree_path_is_dir(root, rlen))
+		return tree_walk_file(root, fn, priv);
+
+	mark = arena_push();
+	st = arena_alloc(sizeof(*st));
+	if (st == NULL) return -ERR_MEM;
+
+	strcpy(st->path, root);
+	strcpy(st->inf.path, root);
+	st->inf.flags = VFS_DIR;
+	st->inf.size = 0;
+	st->inf.mtime = 0;
+
+	res = 0;
+	depth = 0;
+
+	if (order & TREE_PRE) {
+		res = fn(st->path, &st->inf, VFS_DIR | TREE_PRE, priv);
+		if (IS_ERR(res)) goto out;
+	}
+
+	dd = vfs_diropen(st->path);
+	if (IS_ERR(dd)) {
+		res = dd;
+		goto out;
+	}
+
+	st->stack[0].dd = dd;
+	st->stack[0].plen = rlen;
+	depth = 1;
+
+	while(depth > 0) {
+		size_t elen, nlen;
+
+		top = &st->stack[depth - 1];
+		res = vfs_dirnext(top->dd, &st->inf);
+
+		if (res == -ERR_NOTFOUND) {
+			/* directory exhausted, pop it and restore the parent path */
+			vfs_dirclose(top->dd);
+			depth--;
+			st->path[top->plen] = '\0';
+			res = 0;
+
+			if (order & TREE_POST) {
+				st->inf.flags = VFS_DIR;
+				st->inf.size = 0;
+				res = fn(st->path, &st->inf, VFS_DIR | TREE_POST, priv);
+				if (IS_ERR(res)) break;
+			}
+
+			if (depth > 0) st->path[st->stack[depth - 1].plen] = '\0';
+			continue;
+		} else if (IS_ERR(res)) {
+			break;
+		}
+
+		/* append the entry name to the shared path in place */
+		elen = strlen(st->inf.path);
+		nlen = top->plen + elen;
+		if (nlen > MAX_PATH) {
+			res = -ERR_ARG;
+			break;
+		}
+		memcpy(&st->path[top->plen], st->inf.path, elen + 1);
+
+		if (st->inf.flags & VFS_DIR) {
+			if (depth == TREE_MAXDEPTH) {
+				res = -ERR_MEM;
+				break;
+			}
+
+			if (order & TREE_PRE) {
+				res = fn(st->path, &st->inf, VFS_DIR | TREE_PRE, priv);
+				if (IS_ERR(res)) break;
+			}
+
+			dd = vfs_diropen(st->path);
+			if (IS_ERR(dd)) {
+				res = dd;
+				break;
+			}
+
+			st->stack[depth].dd = dd;
+			st->stack[depth].plen = nlen;
+			depth++;
+		} else {
+			res = fn(st->path, &st->inf, VFS_FILE, priv);
+			if (IS_ERR(res)) break;
+			st->path[top->plen] = '\0';
+		}
+	}
+
+out:
+	/* unwind whatever is left open after an early exit */
+	while(depth > 0)
+		vfs_dirclose(st->stack[--depth].dd);
+
+	arena_pop(mark);
+	return IS_ERR(res) ? res : 0;
+}
+
+typedef struct {
+	off_t size;
+	size_t files;
+	size_t dirs;
+} tree_size_ctx;
+
+static int tree_size_cb(const char *path, const dirinf_t *inf, int flags, void *priv)
+{
+	tree_size_ctx *ctx = (tree_size_ctx*)priv;
+
+	if (flags & VFS_DIR) {
+		ctx->dirs++;
+	} else {
+		ctx->files++;
+		ctx->size += inf->size;
+	}
+	return 0;
+}
+
+off_t tree_size(const char *root, size_t *files, size_t *dirs)
+{
+	tree_size_ctx ctx = {0};
+	int res;
+
+	res = tree_walk(root, TREE_PRE, tree_size_cb, &ctx);
+	if (IS_ERR(res)) return res;
+
+	if (files) *files = ctx.files;
+	if (dirs) *dirs = ctx.dirs;
+	return ctx.size;
+}
+
+static int tree_delete_cb(const char *path, const dirinf_t *inf, int flags, void *priv)
+{
+	/* directories are only reported once they're empty and closed */
+	return vfs_unlink(path);
+}
+
+int tree_delete(const char *root)
+{
+	if (root == NULL) return -ERR_MEM;
+	if (path_is_topdir(root)) return -ERR_ARG;
+	return tree_walk(root, TREE_POST, tree_delete_cb, NULL);
+}
+
+#define PATH_OTHER	(0)
+#define PATH_SAME	(1)
+#define PATH_INSIDE	(2)
+
+/* start of the next component, skips repeated slashes and "." */
+static const char *path_component(const char *p, size_t *len)
+{
+	while(1) {
+		while(*p == '/') p++;
+		*len = strcspn(p, "/");
+		if (*len != 1 || *p != '.') return p;
+		p++;
+	}
+}
+
+/*
+ * compares two paths component by component, FAT doesn't care about
+ * case so neither does this, returns PATH_SAME if both name the same
+ * entry, PATH_INSIDE if `b` is somewhere below `a` and PATH_OTHER otherwise
+ */
+static int path_relation(const char *a, const char *b)
+{
+	size_t la, lb;
+
+	while(1) {
+		a = path_component(a, &la);
+		b = path_component(b, &lb);
+
+		if (la == 0) return (lb == 0) ? PATH_SAME : PATH_INSIDE;
+		if (la != lb || strncasecmp(a, b, la)) return PATH_OTHER;
+
+		a += la;
+		b += lb;
+	}
+}
+
+typedef struct {
+	char dst[MAX_PATH + 1];
+	size_t dlen;	/* destination directory length */
+	size_t soff;	/* offset of the copied base name in the source path */
+	void *buf;
+} tree_copy_ctx;
+
+static int tree_copy_file(const char *src, const char *dst, void *buf)
+{
+	int sfd, dfd, res = 0;
+	off_t rb, wb;
+
+	sfd = vfs_open(src, VFS_RO);
+	if (IS_ERR(sfd)) return sfd;
+
+	dfd = vfs_open(dst, VFS_CREATE);
+	if (IS_ERR(dfd)) {
+		vfs_close(sfd);
+		return dfd;
+	}
+
+	while(1) {
+		rb = vfs_read(sfd, buf, TREE_COPYBUF);
+		if (rb <= 0) {
+			res = rb;
+			break;
+		}
+
+		wb = vfs_write(dfd, buf, rb);
+		if (wb != rb) {
+			res = IS_ERR(wb) ? wb : -ERR_IO;
+			break;
+		}
+	}
+
+	vfs_close(dfd);
+	vfs_close(sfd);
+	return res;
+}
+
+static int tree_copy_cb(const char *path, const dirinf_t *inf, int flags, void *priv)
+{
+	tree_copy_ctx *ctx = (tree_copy_ctx*)priv;
+	const char *tail = &path[ctx->soff];
+	size_t tlen = strlen(tail);
+	int res, dd;
+
+	/* both trees share the same relative tail */
+	if (ctx->dlen + tlen > MAX_PATH) return -ERR_ARG;
+	memcpy(&ctx->dst[ctx->dlen], tail, tlen + 1);
+
+	if (flags & VFS_FILE)
+		return tree_copy_file(path, ctx->dst, ctx->buf);
+
+	/* merge into already existing directories */
+	res = vfs_mkdir(ctx->dst);
+	if (IS_ERR(res)) {
+		dd = vfs_diropen(ctx->dst);
+		if (IS_ERR(dd)) return res;
+		vfs_dirclose(dd);
+	}
+	return 0;
+}
+
+int tree_copy(const char *src, const char *dstdir)
+{
+	tree_copy_ctx *ctx;
+	size_t slen;
+	int res;
+	arena_mark_t mark;
+
+	if (src == NULL || dstdir == NULL) return -ERR_MEM;
+
+	slen = strlen(src);
+	if (slen == 0 || path_is_topdir(src)) return -ERR_ARG;
+
+	/* refuse to copy a directory into itself */
+	if (path_relation(src, dstdir) != PATH_OTHER) return -ERR_ARG;
+
+	/* the copy buffer is far too big for the arena */
+	mark = arena_push();
+	ctx = arena_alloc(sizeof(*ctx));
+	if (ctx == NULL) return -ERR_MEM;
+
+	ctx->buf = mem_alloc(MEM_VFS, TREE_COPYBUF);
+	if (ctx->buf == NULL) {
+		arena_pop(mark);
+		return -ERR_MEM;
+	}
+
+	ctx->dlen = strlen(dstdir);
+	if (ctx->dlen > MAX_PATH || !tree_path_is_dir(dstdir, ctx->dlen)) {
+		res = -ERR_ARG;
+		goto out;
+	}
+	strcpy(ctx->dst, dstdir);
+
+	/* find where the base name starts, skipping a trailing slash */
+	ctx->soff = slen - 1;
+	while(ctx->soff > 0 && src[ctx->soff - 1] != '/') ctx->soff--;
+
+	/*
+	 * pasting into the same directory would open the source for writing,
+	 * which truncates it before a single byte was read
+	 */
+	if (ctx->dlen + (slen - ctx->soff) > MAX_PATH) {
+		res = -ERR_ARG;
+		goto out;
+	}
+	strcpy(&ctx->dst[ctx->dlen], &src[ctx->soff]);
+	if (path_relation(src, ctx->dst) == PATH_SAME) {
+		res = -ERR_ARG;
+		goto out;
+	}
+
+	res = tree_walk(src, TREE_PRE, tree_copy_cb, ctx);
+
+out:
+	mem_free(ctx->buf);
+	arena_pop(mark);
+	return res;
+}
@@ -5,14 +5,62 @@
 
 #include <nds.h>
 
+#include "vfs.h"
+
 /* null terminates the last '/' char */
 size_t path_basedir(char *path);
 
+/* returns the first drive letter with nothing mounted on it */
+int vfs_free_drive(void);
+
 /* opens a file with a special path, pretty much auxiliary */
 int open_compound_path(int mode, const char *fmt, ...);
 
 size_t size_format(char *out, off_t size);
 
+/* returns the extension of the last path component (without the dot) or NULL */
+const char *path_extension(const char *path);
+
+/*
+ * tree walker flags, passed to the callback along with the entry flags
+ * TREE_PRE: directory is being entered, none of its children were visited
+ * TREE_POST: directory is being left, all of its children were visited
+ */
+#define TREE_PRE	BIT(16)
+#define TREE_POST	BIT(17)
+
+/* deepest directory level the walker will descend into */
+#define TREE_MAXDEPTH	(MAX_PATH / 2)
+
+/*
+ * called for every entry found by tree_walk, with the full global path
+ * returning an error code stops the walk and gets propagated back
+ */
+typedef int (*tree_walk_fn)(const char *path, const dirinf_t *inf, int flags, void *priv);
+
+/*
+ * iteratively walks the tree starting at `root`
+ * `order` selects whether directories are reported on entry (TREE_PRE),
+ * on exit (TREE_POST) or both, files are always reported once
+ *
+ * the directory stack and the path buffer live on the heap, so
+ * the call stack usage is constant regardless of the tree depth
+ */
+int tree_walk(const char *root, int order, tree_walk_fn fn, void *priv);
+
+/* accumulates the size, file count and directory count of a tree */
+off_t tree_size(const char *root, size_t *files, size_t *dirs);
+
+/* deletes a file or a directory along with all of its contents */
+int tree_delete(const char *root);
+
+/*
+ * copies a file or a directory along with all of its contents
+ * into the `dstdir` directory, keeping the same base name
+ * fails with -ERR_ARG if that would copy something onto or into itself
+ */
+int tree_copy(const char *src, const char *dstdir);
+
 static inline bool path_is_topdir(const char *p) {
 	if (p[0] < VFS_FIRSTMOUNT || p[0] > VFS_LASTMOUNT) return false;
 	if (p[1] != ':') return false;
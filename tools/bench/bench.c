@@ -0,0 +1,659 @@
+/*
+ * synthetic VFS/FAT workloads against RAM backed FAT images
+ *
+ * usage: vfsbench [-c cluster] [-f frag] [-s image_mib] [-m file_mib] [workload...]
+ *
+ *   -c  cluster size in bytes (default 4096)
+ *   -f  fragmentation, 0 leaves the volume pristine, N fills it with
+ *       single cluster files and deletes N out of every N+1 so free
+ *       space only comes in N cluster holes (default 0)
+ *   -s  size of each image in MiB (default 64)
+ *   -m  size of the streamed file in MiB (default 8)
+ *
+ * workloads (all of them by default):
+ *   seq_write seq_read rand_read rand_write small_create small_delete
+ *   readdir deep_open copy loop
+ *
+ * small_delete removes the files small_create made, the rest set up
+ * what they need themselves
+ *
+ * loop stores a FAT image as a file on A:, mounts it through the loop
+ * device and reads, writes and lists the inner drive, then checks what
+ * ended up in the image by mounting a copy of it straight from memory,
+ * the disk counts are those of the outer drive
+ *
+ * every result is a line of JSON on stdout, with disk transactions
+ * counted at the driver, timings on the host clock
+ */
+
+#define _POSIX_C_SOURCE	199309L	/* clock_gettime */
+#include <time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "vfs.h"
+
+#include "fat.h"
+#include "loop.h"
+#include "ramdisk.h"
+
+#define BENCH_SMALL		(1000)		/* files for small_create/small_delete */
+#define BENCH_SMALLSZ	(1024)
+#define BENCH_DEPTH		(8)			/* directories above the deep_open file */
+#define BENCH_OPENS		(1000)
+#define BENCH_COPYBUF	(SIZE_KIB(32))
+#define BENCH_DIRMIN	(20000)		/* readdir repeats until this many entries */
+
+#define BENCH_FRAGDIR	(500)		/* filler files per directory */
+
+#define BENCH_LOOPMIB	(16)		/* inner image, FAT16 with 2KiB clusters */
+#define BENCH_LOOPCLUS	(2048)
+#define BENCH_LOOPFILE	(SIZE_MIB(2))
+#define BENCH_LOOPREAD	(4096)		/* random read size on the inner drive */
+#define BENCH_LOOPDIR	(200)
+
+static const u32 chunks[] = {512, 4096, 32768, 262144};
+static const u32 fanouts[] = {10, 1000, 10000};
+
+static struct {
+	u32 cluster, frag, image_mib, file_mib;
+} cfg = {4096, 0, 64, 8};
+
+static ramdisk_t disk_a, disk_b;
+static u8 *iobuf;
+static u32 rng = 0x2545F491;
+
+typedef struct {
+	double t;
+	u64 rd, wr, srd, swr;
+} mark_t;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* fixed seed, the same offsets every run */
+static u32 rand32(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static void mark(mark_t *m)
+{
+	m->t = now();
+	m->rd = disk_a.reads + disk_b.reads;
+	m->wr = disk_a.writes + disk_b.writes;
+	m->srd = disk_a.sect_rd + disk_b.sect_rd;
+	m->swr = disk_a.sect_wr + disk_b.sect_wr;
+}
+
+static void report(const char *name, const char *param, u32 val, u64 bytes, u64 ops, const mark_t *m0)
+{
+	mark_t m1;
+	double secs;
+
+	mark(&m1);
+	secs = m1.t - m0->t;
+	if (secs <= 0) secs = 1e-9;
+
+	printf("{\"bench\":\"%s\",\"cluster\":%lu,\"frag\":%lu,", name,
+		(unsigned long)cfg.cluster, (unsigned long)cfg.frag);
+	if (param != NULL) printf("\"%s\":%lu,", param, (unsigned long)val);
+	printf("\"bytes\":%llu,\"ops\":%llu,\"secs\":%.6f,\"mib_s\":%.2f,\"ops_s\":%.1f,"
+		"\"disk_rd\":%llu,\"disk_wr\":%llu,\"sect_rd\":%llu,\"sect_wr\":%llu,\"tx_per_op\":%.3f}\n",
+		(unsigned long long)bytes, (unsigned long long)ops, secs,
+		bytes / secs / SIZE_MIB(1), ops / secs,
+		(unsigned long long)(m1.rd - m0->rd), (unsigned long long)(m1.wr - m0->wr),
+		(unsigned long long)(m1.srd - m0->srd), (unsigned long long)(m1.swr - m0->swr),
+		ops ? (double)((m1.rd - m0->rd) + (m1.wr - m0->wr)) / ops : 0.0);
+	fflush(stdout);
+}
+
+static int fail(const char *what, int err)
+{
+	fprintf(stderr, "vfsbench: %s: %s\n", what, err_getstr(err));
+	return err;
+}
+
+static off_t file_size(void)
+{
+	return SIZE_MIB(cfg.file_mib);
+}
+
+/* fills the volume with one cluster files, then punches holes in it */
+static int fragment(void)
+{
+	char path[64];
+	u32 n = 0;
+	int fd;
+
+	if (cfg.frag == 0) return 0;
+
+	vfs_mkdir("A:/frag/");
+	while(1) {
+		if ((n % BENCH_FRAGDIR) == 0) {
+			snprintf(path, sizeof(path), "A:/frag/%04lu/", (unsigned long)(n / BENCH_FRAGDIR));
+			if (IS_ERR(vfs_mkdir(path))) break;
+		}
+
+		snprintf(path, sizeof(path), "A:/frag/%04lu/%04lu.f",
+			(unsigned long)(n / BENCH_FRAGDIR), (unsigned long)(n % BENCH_FRAGDIR));
+		fd = vfs_open(path, VFS_CREATE);
+		if (IS_ERR(fd)) break;
+		if (vfs_write(fd, iobuf, cfg.cluster) != cfg.cluster) {
+			vfs_close(fd);
+			vfs_unlink(path);
+			break;
+		}
+		vfs_close(fd);
+		n++;
+	}
+
+	for (u32 i = 0; i < n; i++) {
+		if ((i % (cfg.frag + 1)) == 0) continue;
+		snprintf(path, sizeof(path), "A:/frag/%04lu/%04lu.f",
+			(unsigned long)(i / BENCH_FRAGDIR), (unsigned long)(i % BENCH_FRAGDIR));
+		vfs_unlink(path);
+	}
+
+	return 0;
+}
+
+static int bench_seq_write(void)
+{
+	for (size_t c = 0; c < ARRAY_SIZE(chunks); c++) {
+		u64 ops = 0;
+		off_t done;
+		mark_t m;
+		int fd;
+
+		mark(&m);
+		fd = vfs_open("A:/seq.bin", VFS_CREATE);
+		if (IS_ERR(fd)) return fail("seq_write", fd);
+
+		for (done = 0; done < file_size(); done += chunks[c], ops++) {
+			off_t wb = vfs_write(fd, iobuf, chunks[c]);
+			if (wb != chunks[c]) {
+				vfs_close(fd);
+				return fail("seq_write", IS_ERR(wb) ? wb : -ERR_IO);
+			}
+		}
+		vfs_close(fd);
+		report("seq_write", "chunk", chunks[c], done, ops, &m);
+	}
+	return 0;
+}
+
+static int bench_seq_read(void)
+{
+	for (size_t c = 0; c < ARRAY_SIZE(chunks); c++) {
+		u64 ops = 0, done = 0;
+		mark_t m;
+		off_t rb;
+		int fd;
+
+		mark(&m);
+		fd = vfs_open("A:/seq.bin", VFS_RO);
+		if (IS_ERR(fd)) return fail("seq_read", fd);
+
+		while((rb = vfs_read(fd, iobuf, chunks[c])) > 0) {
+			done += rb;
+			ops++;
+		}
+		vfs_close(fd);
+		if (IS_ERR(rb)) return fail("seq_read", rb);
+		report("seq_read", "chunk", chunks[c], done, ops, &m);
+	}
+	return 0;
+}
+
+static int bench_rand(bool write)
+{
+	const char *name = write ? "rand_write" : "rand_read";
+
+	for (size_t c = 0; c < ARRAY_SIZE(chunks); c++) {
+		u32 slots = file_size() / chunks[c];
+		u64 ops = slots;
+		mark_t m;
+		int fd;
+
+		mark(&m);
+		fd = vfs_open("A:/seq.bin", write ? VFS_RW : VFS_RO);
+		if (IS_ERR(fd)) return fail(name, fd);
+
+		for (u32 i = 0; i < slots; i++) {
+			off_t pos = (off_t)(rand32() % slots) * chunks[c], res;
+
+			res = write ? vfs_pwrite(fd, iobuf, chunks[c], pos) :
+						vfs_pread(fd, iobuf, chunks[c], pos);
+			if (res != chunks[c]) {
+				vfs_close(fd);
+				return fail(name, IS_ERR(res) ? res : -ERR_IO);
+			}
+		}
+		vfs_close(fd);
+		report(name, "chunk", chunks[c], (u64)slots * chunks[c], ops, &m);
+	}
+	return 0;
+}
+
+static int bench_rand_read(void)
+{
+	return bench_rand(false);
+}
+
+static int bench_rand_write(void)
+{
+	return bench_rand(true);
+}
+
+static int bench_small_create(void)
+{
+	char path[64];
+	mark_t m;
+
+	vfs_mkdir("A:/small/");
+
+	mark(&m);
+	for (int i = 0; i < BENCH_SMALL; i++) {
+		int fd;
+
+		snprintf(path, sizeof(path), "A:/small/file%04d.dat", i);
+		fd = vfs_open(path, VFS_CREATE);
+		if (IS_ERR(fd)) return fail("small_create", fd);
+		vfs_write(fd, iobuf, BENCH_SMALLSZ);
+		vfs_close(fd);
+	}
+	report("small_create", NULL, 0, (u64)BENCH_SMALL * BENCH_SMALLSZ, BENCH_SMALL, &m);
+	return 0;
+}
+
+static int bench_small_delete(void)
+{
+	char path[64];
+	mark_t m;
+
+	mark(&m);
+	for (int i = 0; i < BENCH_SMALL; i++) {
+		int res;
+
+		snprintf(path, sizeof(path), "A:/small/file%04d.dat", i);
+		res = vfs_unlink(path);
+		if (IS_ERR(res)) return fail("small_delete", res);
+	}
+	report("small_delete", NULL, 0, 0, BENCH_SMALL, &m);
+	return 0;
+}
+
+static int bench_readdir(void)
+{
+	char path[64];
+	dirinf_t ent;
+
+	for (size_t f = 0; f < ARRAY_SIZE(fanouts); f++) {
+		u32 reps = (BENCH_DIRMIN + fanouts[f] - 1) / fanouts[f];
+		u64 ops = 0;
+		mark_t m;
+
+		/* empty files, the setup isn't timed */
+		snprintf(path, sizeof(path), "A:/dir%lu/", (unsigned long)fanouts[f]);
+		vfs_mkdir(path);
+		for (u32 i = 0; i < fanouts[f]; i++) {
+			int fd;
+
+			snprintf(path, sizeof(path), "A:/dir%lu/e%05lu.dat",
+				(unsigned long)fanouts[f], (unsigned long)i);
+			fd = vfs_open(path, VFS_CREATE);
+			if (IS_ERR(fd)) return fail("readdir setup", fd);
+			vfs_close(fd);
+		}
+
+		snprintf(path, sizeof(path), "A:/dir%lu/", (unsigned long)fanouts[f]);
+		mark(&m);
+		for (u32 r = 0; r < reps; r++) {
+			int dd = vfs_diropen(path);
+			if (IS_ERR(dd)) return fail("readdir", dd);
+			while(!IS_ERR(vfs_dirnext(dd, &ent))) ops++;
+			vfs_dirclose(dd);
+		}
+		report("readdir", "entries", fanouts[f], 0, ops, &m);
+	}
+	return 0;
+}
+
+static int bench_deep_open(void)
+{
+	char path[MAX_PATH + 1] = "A:/";
+	mark_t m;
+	int fd;
+
+	for (int d = 0; d < BENCH_DEPTH; d++) {
+		size_t len = strlen(path);
+		snprintf(&path[len], sizeof(path) - len, "level%d/", d);
+		vfs_mkdir(path);
+	}
+	strcat(path, "leaf.bin");
+
+	fd = vfs_open(path, VFS_CREATE);
+	if (IS_ERR(fd)) return fail("deep_open setup", fd);
+	vfs_close(fd);
+
+	mark(&m);
+	for (int i = 0; i < BENCH_OPENS; i++) {
+		fd = vfs_open(path, VFS_RO);
+		if (IS_ERR(fd)) return fail("deep_open", fd);
+		vfs_close(fd);
+	}
+	report("deep_open", "depth", BENCH_DEPTH, 0, BENCH_OPENS, &m);
+	return 0;
+}
+
+static int bench_copy(void)
+{
+	int in, out, res = 0;
+	u64 ops = 0, done = 0;
+	mark_t m;
+	off_t rb;
+
+	mark(&m);
+	in = vfs_open("A:/seq.bin", VFS_RO);
+	if (IS_ERR(in)) return fail("copy", in);
+	out = vfs_open("B:/copy.bin", VFS_CREATE);
+	if (IS_ERR(out)) {
+		vfs_close(in);
+		return fail("copy", out);
+	}
+
+	while((rb = vfs_read(in, iobuf, BENCH_COPYBUF)) > 0) {
+		if (vfs_write(out, iobuf, rb) != rb) {
+			res = fail("copy", -ERR_IO);
+			break;
+		}
+		done += rb;
+		ops++;
+	}
+
+	vfs_close(out);
+	vfs_close(in);
+	if (res == 0) report("copy", "chunk", BENCH_COPYBUF, done, ops, &m);
+	return res;
+}
+
+/* differs from sector to sector and from seed to seed */
+static void loop_pattern(u8 *buf, off_t pos, size_t len, u32 seed)
+{
+	for (size_t i = 0; i < len; i++) {
+		u32 o = pos + i;
+		buf[i] = (o >> 9) * seed + o;
+	}
+}
+
+static int loop_write_file(const char *path, u32 seed)
+{
+	off_t done;
+	int fd;
+
+	fd = vfs_open(path, VFS_CREATE);
+	if (IS_ERR(fd)) return fd;
+
+	for (done = 0; done < BENCH_LOOPFILE; done += BENCH_COPYBUF) {
+		loop_pattern(iobuf, done, BENCH_COPYBUF, seed);
+		if (vfs_write(fd, iobuf, BENCH_COPYBUF) != BENCH_COPYBUF) {
+			vfs_close(fd);
+			return -ERR_IO;
+		}
+	}
+	return vfs_close(fd);
+}
+
+static int loop_check_file(const char *path, u32 seed)
+{
+	u8 *want = &iobuf[BENCH_COPYBUF];
+	off_t done = 0, rb;
+	int fd;
+
+	fd = vfs_open(path, VFS_RO);
+	if (IS_ERR(fd)) return fd;
+
+	while((rb = vfs_read(fd, iobuf, BENCH_COPYBUF)) > 0) {
+		loop_pattern(want, done, rb, seed);
+		if (memcmp(iobuf, want, rb)) break;
+		done += rb;
+	}
+	vfs_close(fd);
+
+	if (IS_ERR(rb)) return rb;
+	return (rb == 0 && done == BENCH_LOOPFILE) ? 0 : -ERR_IO;
+}
+
+static int loop_count_dir(const char *path)
+{
+	dirinf_t ent;
+	int dd, n = 0;
+
+	dd = vfs_diropen(path);
+	if (IS_ERR(dd)) return dd;
+	while(!IS_ERR(vfs_dirnext(dd, &ent))) n++;
+	vfs_dirclose(dd);
+	return n;
+}
+
+/* a fresh volume with one file on it, copied to A: as the image */
+static int loop_setup(ramdisk_t *inner)
+{
+	int res, fd;
+
+	if (IS_ERR(res = ramdisk_create(inner, BENCH_LOOPMIB))) return res;
+	if (IS_ERR(res = ramdisk_format(inner, BENCH_LOOPCLUS))) return res;
+
+	if (IS_ERR(res = fat_mount('D', &ramdisk_ops, inner))) return res;
+	res = loop_write_file("D:/seed.bin", 0x9E37);
+	vfs_unmount('D');
+	if (IS_ERR(res)) return res;
+
+	fd = vfs_open("A:/loop.img", VFS_CREATE);
+	if (IS_ERR(fd)) return fd;
+	res = vfs_write(fd, inner->data, (off_t)inner->sectors * RAMDISK_SECT);
+	vfs_close(fd);
+	return (res == (off_t)inner->sectors * RAMDISK_SECT) ? 0 : -ERR_IO;
+}
+
+/* reads the image back off A: and mounts it without the loop device */
+static int loop_verify(ramdisk_t *inner)
+{
+	off_t size = (off_t)inner->sectors * RAMDISK_SECT;
+	int res, fd;
+
+	fd = vfs_open("A:/loop.img", VFS_RO);
+	if (IS_ERR(fd)) return fd;
+	res = vfs_read(fd, inner->data, size);
+	vfs_close(fd);
+	if (res != size) return IS_ERR(res) ? res : -ERR_IO;
+
+	if (IS_ERR(res = fat_mount('D', &ramdisk_ops, inner))) return res;
+	res = loop_check_file("D:/seed.bin", 0x9E37);
+	if (!IS_ERR(res)) res = loop_check_file("D:/new.bin", 0x6A09);
+	if (!IS_ERR(res)) res = loop_count_dir("D:/dir/");
+	if (!IS_ERR(res)) res = (res == BENCH_LOOPDIR) ? 0 : -ERR_IO;
+	vfs_unmount('D');
+	return res;
+}
+
+static int bench_loop(void)
+{
+	u32 slots = BENCH_LOOPFILE / BENCH_LOOPREAD;
+	u8 *want = &iobuf[BENCH_COPYBUF];
+	char path[64];
+	ramdisk_t inner;
+	mark_t m;
+	int res, fd;
+
+	res = loop_setup(&inner);
+	if (IS_ERR(res)) {
+		ramdisk_free(&inner);
+		return fail("loop setup", res);
+	}
+
+	res = loop_mount('C', "A:/loop.img");
+	if (IS_ERR(res)) {
+		ramdisk_free(&inner);
+		return fail("loop mount", res);
+	}
+
+	mark(&m);
+	res = loop_check_file("C:/seed.bin", 0x9E37);
+	if (IS_ERR(res)) goto fail;
+	report("loop_seq_read", "chunk", BENCH_COPYBUF, BENCH_LOOPFILE, BENCH_LOOPFILE / BENCH_COPYBUF, &m);
+
+	/* random positions go through the link maps of both files */
+	mark(&m);
+	fd = vfs_open("C:/seed.bin", VFS_RO);
+	if (IS_ERR(res = fd)) goto fail;
+	for (u32 i = 0; i < slots; i++) {
+		off_t pos = (off_t)(rand32() % slots) * BENCH_LOOPREAD;
+
+		loop_pattern(want, pos, BENCH_LOOPREAD, 0x9E37);
+		if (vfs_pread(fd, iobuf, BENCH_LOOPREAD, pos) != BENCH_LOOPREAD ||
+			memcmp(iobuf, want, BENCH_LOOPREAD)) {
+			res = -ERR_IO;
+			break;
+		}
+	}
+	vfs_close(fd);
+	if (IS_ERR(res)) goto fail;
+	report("loop_rand_read", "chunk", BENCH_LOOPREAD, (u64)slots * BENCH_LOOPREAD, slots, &m);
+
+	mark(&m);
+	res = loop_write_file("C:/new.bin", 0x6A09);
+	if (IS_ERR(res)) goto fail;
+	report("loop_seq_write", "chunk", BENCH_COPYBUF, BENCH_LOOPFILE, BENCH_LOOPFILE / BENCH_COPYBUF, &m);
+
+	vfs_mkdir("C:/dir/");
+	for (int i = 0; i < BENCH_LOOPDIR; i++) {
+		snprintf(path, sizeof(path), "C:/dir/e%04d.dat", i);
+		fd = vfs_open(path, VFS_CREATE);
+		if (IS_ERR(res = fd)) goto fail;
+		vfs_close(fd);
+	}
+
+	mark(&m);
+	res = loop_count_dir("C:/dir/");
+	if (IS_ERR(res)) goto fail;
+	res = (res == BENCH_LOOPDIR) ? 0 : -ERR_IO;
+	if (IS_ERR(res)) goto fail;
+	report("loop_readdir", "entries", BENCH_LOOPDIR, 0, BENCH_LOOPDIR, &m);
+
+	/* everything has to be flushed into the image before it's looked at */
+	res = vfs_unmount('C');
+	if (!IS_ERR(res)) res = loop_verify(&inner);
+	ramdisk_free(&inner);
+	vfs_unlink("A:/loop.img");
+	return IS_ERR(res) ? fail("loop verify", res) : 0;
+
+fail:
+	vfs_unmount('C');
+	ramdisk_free(&inner);
+	return fail("loop", res);
+}
+
+static const struct {
+	const char *name;
+	int (*run)(void);
+} workloads[] = {
+	{"seq_write", bench_seq_write},
+	{"seq_read", bench_seq_read},
+	{"rand_read", bench_rand_read},
+	{"rand_write", bench_rand_write},
+	{"small_create", bench_small_create},
+	{"small_delete", bench_small_delete},
+	{"readdir", bench_readdir},
+	{"deep_open", bench_deep_open},
+	{"copy", bench_copy},
+	{"loop", bench_loop},
+};
+
+static int usage(const char *argv0)
+{
+	fprintf(stderr, "usage: %s [-c cluster] [-f frag] [-s image_mib] [-m file_mib] [workload...]\n", argv0);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	bool picked[ARRAY_SIZE(workloads)] = {false}, any = false;
+	int res;
+
+	for (int i = 1; i < argc; i++) {
+		u32 *opt = NULL;
+
+		if (!strcmp(argv[i], "-c")) opt = &cfg.cluster;
+		else if (!strcmp(argv[i], "-f")) opt = &cfg.frag;
+		else if (!strcmp(argv[i], "-s")) opt = &cfg.image_mib;
+		else if (!strcmp(argv[i], "-m")) opt = &cfg.file_mib;
+
+		if (opt != NULL) {
+			if (++i == argc) return usage(argv[0]);
+			*opt = strtoul(argv[i], NULL, 0);
+			continue;
+		}
+
+		size_t w;
+		for (w = 0; w < ARRAY_SIZE(workloads); w++) {
+			if (!strcmp(argv[i], workloads[w].name)) break;
+		}
+		if (w == ARRAY_SIZE(workloads)) return usage(argv[0]);
+		picked[w] = any = true;
+	}
+
+	iobuf = malloc(chunks[ARRAY_SIZE(chunks) - 1]);
+	if (iobuf == NULL) return 1;
+	memset(iobuf, 0xA5, chunks[ARRAY_SIZE(chunks) - 1]);
+
+	if (IS_ERR(ramdisk_create(&disk_a, cfg.image_mib)) ||
+		IS_ERR(ramdisk_create(&disk_b, cfg.image_mib))) return fail("image", -ERR_MEM);
+
+	if (IS_ERR(res = ramdisk_format(&disk_a, cfg.cluster)) ||
+		IS_ERR(res = ramdisk_format(&disk_b, cfg.cluster))) return fail("format", res);
+
+	if (IS_ERR(res = fat_mount('A', &ramdisk_ops, &disk_a)) ||
+		IS_ERR(res = fat_mount('B', &ramdisk_ops, &disk_b))) return fail("mount", res);
+
+	fragment();
+
+	/* the read and copy workloads need the file from seq_write */
+	for (size_t w = 0; w < ARRAY_SIZE(workloads); w++) {
+		if (any && !picked[w] && strcmp(workloads[w].name, "seq_write")) continue;
+		if (any && !picked[w]) {
+			int fd = vfs_open("A:/seq.bin", VFS_CREATE);
+			off_t done;
+
+			if (IS_ERR(fd)) return fail("setup", fd);
+			for (done = 0; done < file_size(); done += BENCH_COPYBUF)
+				vfs_write(fd, iobuf, BENCH_COPYBUF);
+			vfs_close(fd);
+			continue;
+		}
+
+		res = workloads[w].run();
+		if (IS_ERR(res)) return 1;
+	}
+
+	vfs_unmount('B');
+	vfs_unmount('A');
+	ramdisk_free(&disk_b);
+	ramdisk_free(&disk_a);
+	free(iobuf);
+	return 0;
+}
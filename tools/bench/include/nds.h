@@ -0,0 +1,35 @@
+/*
+ * just enough of libnds for the VFS and FAT code to build on the host
+ * only used by the host tools, the real thing comes from devkitPro
+ */
+
+#ifndef NDS_H__
+#define NDS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef volatile u8 vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile u64 vu64;
+
+#define BIT(n)	(1 << (n))
+
+#define TILE_PALETTE(n)	((n) << 12)
+
+#endif /* NDS_H__ */
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <string.h>
+#include <nds.h>
+
+#include "err.h"
+
+#include "fat.h"
+
+#include "ramdisk.h"
+
+/* cluster count limits, same as FatFs uses to tell the types apart */
+#define FAT12_MAX	(0xFF5)
+#define FAT16_MAX	(0xFFF5)
+
+static int ramdisk_init(void *priv)
+{
+	return 1;
+}
+
+static int ramdisk_online(void *priv)
+{
+	return 1;
+}
+
+static int ramdisk_read(void *priv, BYTE *buf, DWORD start, UINT count)
+{
+	ramdisk_t *rd = priv;
+
+	if (start + count > rd->sectors) return -ERR_IO;
+	memcpy(buf, &rd->data[(size_t)start * RAMDISK_SECT], count * RAMDISK_SECT);
+	rd->reads++;
+	rd->sect_rd += count;
+	return 0;
+}
+
+static int ramdisk_write(void *priv, const BYTE *buf, DWORD start, UINT count)
+{
+	ramdisk_t *rd = priv;
+
+	if (start + count > rd->sectors) return -ERR_IO;
+	memcpy(&rd->data[(size_t)start * RAMDISK_SECT], buf, count * RAMDISK_SECT);
+	rd->writes++;
+	rd->sect_wr += count;
+	return 0;
+}
+
+const fat_disk_ops ramdisk_ops = {
+	.init = ramdisk_init,
+	.online = ramdisk_online,
+	.read = ramdisk_read,
+	.write = ramdisk_write,
+};
+
+int ramdisk_create(ramdisk_t *rd, u32 mib)
+{
+	memset(rd, 0, sizeof(*rd));
+	rd->sectors = mib * (SIZE_MIB(1) / RAMDISK_SECT);
+	rd->data = calloc(rd->sectors, RAMDISK_SECT);
+	return (rd->data == NULL) ? -ERR_MEM : 0;
+}
+
+void ramdisk_free(ramdisk_t *rd)
+{
+	free(rd->data);
+	rd->data = NULL;
+}
+
+static void put16(u8 *p, u32 v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(u8 *p, u32 v)
+{
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+/* grows the FAT until it covers every cluster left next to it */
+static u32 fat_layout(u32 total, u32 spc, bool fat32, u32 *fatsz)
+{
+	u32 rsvd = fat32 ? 32 : 1, root = fat32 ? 0 : 32;
+	u32 fs = 1;
+
+	while(1) {
+		u32 nc = (total - rsvd - 2 * fs - root) / spc;
+		u32 need = ((nc + 2) * (fat32 ? 4 : 2) + RAMDISK_SECT - 1) / RAMDISK_SECT;
+
+		if (need <= fs) {
+			*fatsz = fs;
+			return nc;
+		}
+		fs = need;
+	}
+}
+
+int ramdisk_format(ramdisk_t *rd, u32 cluster)
+{
+	u32 spc = cluster / RAMDISK_SECT, total = rd->sectors;
+	u32 fatsz, nc, rsvd;
+	bool fat32 = false;
+	u8 *bs = rd->data;
+
+	if (spc == 0 || (spc & (spc - 1)) || spc > 64) return -ERR_ARG;
+
+	nc = fat_layout(total, spc, false, &fatsz);
+	if (nc > FAT16_MAX) {
+		fat32 = true;
+		nc = fat_layout(total, spc, true, &fatsz);
+		if (nc <= FAT16_MAX) return -ERR_ARG;
+	} else if (nc <= FAT12_MAX) {
+		return -ERR_ARG;	/* FAT12 isn't worth benchmarking */
+	}
+
+	rsvd = fat32 ? 32 : 1;
+	memset(rd->data, 0, (size_t)total * RAMDISK_SECT);
+
+	bs[0] = 0xEB;
+	bs[1] = fat32 ? 0x58 : 0x3C;
+	bs[2] = 0x90;
+	memcpy(&bs[3], "MSWIN4.1", 8);
+	put16(&bs[11], RAMDISK_SECT);
+	bs[13] = spc;
+	put16(&bs[14], rsvd);
+	bs[16] = 2;
+	put16(&bs[17], fat32 ? 0 : 512);
+	if (!fat32 && total < 0x10000) put16(&bs[19], total);
+	else put32(&bs[32], total);
+	bs[21] = 0xF8;
+	put16(&bs[24], 63);
+	put16(&bs[26], 255);
+
+	if (fat32) {
+		u8 *fsi = &rd->data[RAMDISK_SECT];
+
+		put32(&bs[36], fatsz);
+		put32(&bs[44], 2);		/* root directory cluster */
+		put16(&bs[48], 1);		/* FSInfo sector */
+		put16(&bs[50], 6);		/* backup boot sector */
+		bs[64] = 0x80;
+		bs[66] = 0x29;
+		put32(&bs[67], 0x12345678);
+		memcpy(&bs[71], "BENCH      FAT32   ", 19);
+
+		put32(&fsi[0], 0x41615252);
+		put32(&fsi[484], 0x61417272);
+		put32(&fsi[488], 0xFFFFFFFF);
+		put32(&fsi[492], 0xFFFFFFFF);
+		put32(&fsi[508], 0xAA550000);
+	} else {
+		put16(&bs[22], fatsz);
+		bs[36] = 0x80;
+		bs[38] = 0x29;
+		put32(&bs[39], 0x12345678);
+		memcpy(&bs[43], "BENCH      FAT16   ", 19);
+	}
+	put16(&bs[510], 0xAA55);
+
+	if (fat32) memcpy(&rd->data[6 * RAMDISK_SECT], bs, RAMDISK_SECT);
+
+	/* media and end of chain markers, plus the root directory chain on FAT32 */
+	for (int i = 0; i < 2; i++) {
+		u8 *fat = &rd->data[(size_t)(rsvd + i * fatsz) * RAMDISK_SECT];
+
+		if (fat32) {
+			put32(&fat[0], 0x0FFFFFF8);
+			put32(&fat[4], 0x0FFFFFFF);
+			put32(&fat[8], 0x0FFFFFFF);
+		} else {
+			put16(&fat[0], 0xFFF8);
+			put16(&fat[2], 0xFFFF);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef RAMDISK_H__
+#define RAMDISK_H__
+
+#include <nds.h>
+
+#include "fat.h"
+
+#define RAMDISK_SECT	(512)
+
+/* a FAT image in memory, counting every request the driver gets */
+typedef struct {
+	u8 *data;
+	u32 sectors;
+
+	u64 reads, writes;			/* driver calls */
+	u64 sect_rd, sect_wr;		/* sectors moved */
+} ramdisk_t;
+
+/* for fat_mount, the priv pointer is the ramdisk_t */
+extern const fat_disk_ops ramdisk_ops;
+
+int ramdisk_create(ramdisk_t *rd, u32 mib);
+void ramdisk_free(ramdisk_t *rd);
+
+/*
+ * writes an empty FAT16 or FAT32 volume over the whole image, whichever
+ * the cluster count calls for, `cluster` is in bytes (512 - 32768)
+ */
+int ramdisk_format(ramdisk_t *rd, u32 cluster);
+
+#endif /* RAMDISK_H__ */
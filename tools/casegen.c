@@ -0,0 +1,100 @@
+/*
+ * flattens the FatFs up-case conversion into a two level lookup table
+ * runs on the host, the output header gets included by ffunicode.c
+ *
+ * usage: casegen <out.h>
+ *
+ * the reference is the compressed table walk in ffunicode.c, built here
+ * with FF_CASE_REFERENCE, every BMP code point is split into a block
+ * index and an offset, identical blocks of deltas are only stored once
+ * and the result is checked against the reference before it's written
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define FF_CASE_REFERENCE
+#include "ffunicode.c"
+
+/* 32 code points per block came out smallest (~5KiB for the whole BMP) */
+#define CASE_SHIFT	(5)
+#define CASE_BLKSZ	(1 << CASE_SHIFT)
+#define CASE_NBLK	(0x10000 >> CASE_SHIFT)
+#define CASE_MAXBLK	(256)
+
+static WORD delta[0x10000];
+static WORD blocks[CASE_MAXBLK][CASE_BLKSZ];
+static BYTE blkidx[CASE_NBLK];
+
+int main(int argc, char *argv[])
+{
+	int nblocks = 0;
+	FILE *out;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <out.h>\n", argv[0]);
+		return 1;
+	}
+
+	for (DWORD uc = 0; uc < 0x10000; uc++)
+		delta[uc] = (WORD)(ff_wtoupper_ref(uc) - uc);
+
+	/* block 0 is all zeroes, most of the BMP has no case at all */
+	nblocks = 1;
+	for (int b = 0; b < CASE_NBLK; b++) {
+		const WORD *d = &delta[b << CASE_SHIFT];
+		int i;
+
+		for (i = 0; i < nblocks; i++) {
+			if (!memcmp(blocks[i], d, sizeof(blocks[i]))) break;
+		}
+
+		if (i == nblocks) {
+			if (nblocks == CASE_MAXBLK) {
+				fprintf(stderr, "casegen: too many distinct blocks\n");
+				return 1;
+			}
+			memcpy(blocks[nblocks++], d, sizeof(blocks[0]));
+		}
+		blkidx[b] = i;
+	}
+
+	for (DWORD uc = 0; uc < 0x10000; uc++) {
+		WORD up = uc + blocks[blkidx[uc >> CASE_SHIFT]][uc & (CASE_BLKSZ - 1)];
+		if (up != ff_wtoupper_ref(uc)) {
+			fprintf(stderr, "casegen: mismatch at U+%04X\n", (unsigned)uc);
+			return 1;
+		}
+	}
+
+	out = fopen(argv[1], "w");
+	if (out == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	fprintf(out, "/* generated by tools/casegen, do not edit */\n\n");
+	fprintf(out, "#define FF_CASE_SHIFT\t%d\n\n", CASE_SHIFT);
+
+	fprintf(out, "static const BYTE ff_case_index[%d] = {", CASE_NBLK);
+	for (int b = 0; b < CASE_NBLK; b++)
+		fprintf(out, "%s%d,", (b % 32) ? "" : "\n\t", blkidx[b]);
+	fprintf(out, "\n};\n\n");
+
+	fprintf(out, "static const WORD ff_case_delta[%d][%d] = {\n", nblocks, CASE_BLKSZ);
+	for (int i = 0; i < nblocks; i++) {
+		fprintf(out, "\t{");
+		for (int j = 0; j < CASE_BLKSZ; j++)
+			fprintf(out, "%s0x%04X,", (j % 8) ? "" : "\n\t\t", blocks[i][j]);
+		fprintf(out, "\n\t},\n");
+	}
+	fprintf(out, "};\n");
+
+	if (fclose(out) != 0) {
+		perror(argv[1]);
+		remove(argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,551 @@
+/*
+ * round trips through the BIOS decompressors, plus a decoding speed run
+ *
+ * usage: comptest
+ *
+ * there are no stock samples to check against, so every format gets a
+ * small encoder here, it only has to produce valid streams, not good ones
+ *
+ * each stream is decoded in one go, in odd sized pieces, with skips in
+ * between, again after a rewind and finally cut short, which has to end
+ * in an error rather than garbage
+ *
+ * the Huffman tree is laid out breadth first, which keeps the child
+ * offsets in range for up to 64 symbols, data with more than that is
+ * skipped for the 8 bit variant
+ */
+
+#define _POSIX_C_SOURCE	199309L	/* clock_gettime */
+#include <time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "bioscomp.h"
+
+#define TEST_SIZE		(SIZE_KIB(64))
+#define TEST_BENCHSZ	(SIZE_MIB(4))
+#define TEST_BENCHBUF	(SIZE_KIB(32))	/* same as one vfs_read of hash_fd */
+
+#define LZ_HASH		(1 << 15)
+#define LZ_DEPTH	(32)
+
+typedef struct {
+	const u8 *data;
+	off_t size;
+} stream_t;
+
+typedef struct {
+	const char *name;
+	void (*make)(u8 *buf, size_t len);
+	size_t len;
+} dataset_t;
+
+typedef struct {
+	const char *name;
+	int type;
+	size_t (*encode)(u8 *dst, const u8 *src, size_t len, int type);
+} format_t;
+
+static const size_t pieces[] = {1, 3, 7, 100, 4095, 4097, 65};
+
+static int failures;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u32 rng = 1;
+static u32 next_rand(void)
+{
+	rng = rng * 1103515245 + 12345;
+	return rng >> 8;
+}
+
+/* both header layouts, the long one is used past 16 MiB or when forced */
+static size_t put_header(u8 *dst, int type, size_t len, bool big)
+{
+	if (len < BIT(24) && !big) {
+		dst[0] = type; dst[1] = len; dst[2] = len >> 8; dst[3] = len >> 16;
+		return 4;
+	}
+
+	dst[0] = type; dst[1] = dst[2] = dst[3] = 0;
+	dst[4] = len; dst[5] = len >> 8; dst[6] = len >> 16; dst[7] = len >> 24;
+	return 8;
+}
+
+/* greedy, hash chained match finder, `type` picks the token layout */
+static size_t lz_encode(u8 *dst, const u8 *src, size_t len, int type)
+{
+	static s32 head[LZ_HASH], prev[BIOSCOMP_WINDOW];
+	size_t maxlen = (type == BIOSCOMP_LZ11) ? 0x10110 : 0x12;
+	size_t o = put_header(dst, type, len, false), flagpos = 0, i = 0;
+	int ntok = 8;
+
+	for (size_t h = 0; h < LZ_HASH; h++) head[h] = -1;
+
+	while(i < len) {
+		size_t best = 0, bestd = 0;
+
+		if (ntok == 8) {
+			flagpos = o;
+			dst[o++] = 0;
+			ntok = 0;
+		}
+
+		if (i + 3 <= len) {
+			u32 h = ((src[i] << 10) ^ (src[i + 1] << 5) ^ src[i + 2]) & (LZ_HASH - 1);
+			s32 cand = head[h];
+
+			for (int depth = 0; cand >= 0 && depth < LZ_DEPTH; depth++) {
+				size_t d = i - cand, n = 0;
+
+				if (d > BIOSCOMP_WINDOW) break;
+				while(n < maxlen && i + n < len && src[cand + n] == src[i + n]) n++;
+				if (n > best) {
+					best = n;
+					bestd = d;
+				}
+
+				if (prev[cand & (BIOSCOMP_WINDOW - 1)] >= cand) break;
+				cand = prev[cand & (BIOSCOMP_WINDOW - 1)];
+			}
+		}
+
+		if (best < 3) best = 1;
+
+		/* every covered position goes into the chains */
+		for (size_t k = 0; k < best; k++) {
+			size_t p = i + k;
+			if (p + 3 <= len) {
+				u32 h = ((src[p] << 10) ^ (src[p + 1] << 5) ^ src[p + 2]) & (LZ_HASH - 1);
+				prev[p & (BIOSCOMP_WINDOW - 1)] = head[h];
+				head[h] = p;
+			}
+		}
+
+		if (best == 1) {
+			dst[o++] = src[i];
+		} else {
+			size_t d = bestd - 1;
+
+			dst[flagpos] |= 0x80 >> ntok;
+			if (type == BIOSCOMP_LZ10 || best <= 0x10) {
+				size_t n = (type == BIOSCOMP_LZ10) ? best - 3 : best - 1;
+				dst[o++] = (n << 4) | (d >> 8);
+				dst[o++] = d;
+			} else if (best <= 0x110) {
+				size_t n = best - 0x11;
+				dst[o++] = n >> 4;
+				dst[o++] = (n << 4) | (d >> 8);
+				dst[o++] = d;
+			} else {
+				size_t n = best - 0x111;
+				dst[o++] = 0x10 | (n >> 12);
+				dst[o++] = n >> 4;
+				dst[o++] = (n << 4) | (d >> 8);
+				dst[o++] = d;
+			}
+		}
+
+		i += best;
+		ntok++;
+	}
+
+	return o;
+}
+
+static size_t rle_encode(u8 *dst, const u8 *src, size_t len, int type)
+{
+	size_t o = put_header(dst, type, len, false), i = 0;
+
+	while(i < len) {
+		size_t run = 1, lit = 0;
+
+		while(run < 130 && i + run < len && src[i + run] == src[i]) run++;
+		if (run >= 3) {
+			dst[o++] = 0x80 | (run - 3);
+			dst[o++] = src[i];
+			i += run;
+			continue;
+		}
+
+		/* literals up to the next run worth encoding */
+		while(lit < 128 && i + lit < len) {
+			if (i + lit + 2 < len && src[i + lit] == src[i + lit + 1] &&
+				src[i + lit] == src[i + lit + 2]) break;
+			lit++;
+		}
+
+		dst[o++] = lit - 1;
+		memcpy(&dst[o], &src[i], lit);
+		o += lit;
+		i += lit;
+	}
+
+	return o;
+}
+
+typedef struct {
+	u32 freq;
+	int child[2];	/* -1 for leaves */
+	int sym;
+} hnode_t;
+
+static void huff_codes(const hnode_t *nodes, int n, u32 code, int depth,
+	u32 *codes, int *lens, bool *ok)
+{
+	if (nodes[n].child[0] < 0) {
+		codes[nodes[n].sym] = code;
+		lens[nodes[n].sym] = depth ? depth : 1;
+		return;
+	}
+
+	if (depth >= 32) {
+		*ok = false;
+		return;
+	}
+
+	huff_codes(nodes, nodes[n].child[0], code << 1, depth + 1, codes, lens, ok);
+	huff_codes(nodes, nodes[n].child[1], (code << 1) | 1, depth + 1, codes, lens, ok);
+}
+
+/* returns zero when the tree can't be expressed in the BIOS layout */
+static size_t huff_encode(u8 *dst, const u8 *src, size_t len, int type)
+{
+	hnode_t nodes[512];
+	bool used[512] = {false}, ok = true;
+	u32 freq[256] = {0}, codes[256], word = 0;
+	int lens[256], queue[256], addr[256];
+	int bits = (type == BIOSCOMP_HUFF4) ? 4 : 8, nsym = 1 << bits;
+	int count = 0, root, qhead = 0, qtail = 0, pair = 1, nbits = 0;
+	size_t o = put_header(dst, type, len, false), t = o;
+
+	for (size_t i = 0; i < len; i++) {
+		if (bits == 8) {
+			freq[src[i]]++;
+		} else {
+			freq[src[i] & 0xF]++;
+			freq[src[i] >> 4]++;
+		}
+	}
+
+	for (int s = 0; s < nsym; s++) {
+		if (freq[s] == 0) continue;
+		nodes[count] = (hnode_t){.freq = freq[s], .child = {-1, -1}, .sym = s};
+		count++;
+	}
+
+	/* a lone symbol still needs a sibling */
+	while(count < 2) {
+		nodes[count] = (hnode_t){.freq = 0, .child = {-1, -1}, .sym = count};
+		count++;
+	}
+
+	/* plain quadratic merge, there are at most 511 nodes */
+	for (int leaves = count; leaves > 1; leaves--) {
+		int pick[2];
+
+		for (int k = 0; k < 2; k++) {
+			pick[k] = -1;
+			for (int n = 0; n < count; n++) {
+				if (used[n]) continue;
+				if (pick[k] < 0 || nodes[n].freq < nodes[pick[k]].freq) pick[k] = n;
+			}
+			used[pick[k]] = true;
+		}
+
+		nodes[count] = (hnode_t){
+			.freq = nodes[pick[0]].freq + nodes[pick[1]].freq,
+			.child = {pick[0], pick[1]}, .sym = -1,
+		};
+		count++;
+	}
+	root = count - 1;
+
+	huff_codes(nodes, root, 0, 0, codes, lens, &ok);
+	if (!ok) return 0;
+
+	/* the root sits right after the size byte, children always come in pairs */
+	queue[qtail] = root;
+	addr[qtail++] = 1;
+	while(qhead < qtail) {
+		int n = queue[qhead], a = addr[qhead++];
+		int off = pair - (a >> 1) - 1;
+		u8 node = off;
+
+		if (off > 0x3F) return 0;
+
+		for (int b = 0; b < 2; b++) {
+			int c = nodes[n].child[b], ca = pair * 2 + b;
+
+			if (nodes[c].child[0] < 0) {
+				node |= b ? 0x40 : 0x80;
+				dst[t + ca] = nodes[c].sym;
+			} else {
+				queue[qtail] = c;
+				addr[qtail++] = ca;
+			}
+		}
+
+		dst[t + a] = node;
+		pair++;
+	}
+	dst[t] = pair - 1;
+	o += pair * 2;
+
+	/* MSB first into little endian words, nibbles go low first */
+	for (size_t i = 0; i < len * (8 / bits); i++) {
+		int s = (bits == 8) ? src[i] : (src[i >> 1] >> ((i & 1) * 4)) & 0xF;
+
+		for (int k = lens[s] - 1; k >= 0; k--) {
+			word = (word << 1) | ((codes[s] >> k) & 1);
+			if (++nbits == 32) {
+				dst[o++] = word; dst[o++] = word >> 8;
+				dst[o++] = word >> 16; dst[o++] = word >> 24;
+				nbits = 0;
+			}
+		}
+	}
+
+	if (nbits) {
+		word <<= 32 - nbits;
+		dst[o++] = word; dst[o++] = word >> 8;
+		dst[o++] = word >> 16; dst[o++] = word >> 24;
+	}
+
+	return o;
+}
+
+/* words from a small vocabulary, what LZ is meant for */
+static void make_text(u8 *buf, size_t len)
+{
+	static const char *const words[] = {
+		"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ",
+		"Nintendo ", "DS ", "cartridge ", "save ", "backup ", "\n", "0x2000 ",
+	};
+
+	for (size_t i = 0; i < len;) {
+		const char *w = words[next_rand() % ARRAY_SIZE(words)];
+		while(*w && i < len) buf[i++] = *w++;
+	}
+}
+
+/* long runs of a few values, tile map like */
+static void make_runs(u8 *buf, size_t len)
+{
+	for (size_t i = 0; i < len;) {
+		size_t n = 1 + next_rand() % 200;
+		u8 v = next_rand() % 24;
+
+		if (next_rand() % 4 == 0) n = 1 + n % 3;
+		while(n-- && i < len) buf[i++] = v;
+	}
+}
+
+/* skewed noise over a restricted alphabet, hardly any matches */
+static void make_noise(u8 *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		u32 r = next_rand();
+		buf[i] = 0x40 + ((r & 0xF) & ((r >> 4) & 0x3F));
+	}
+}
+
+/* every byte value, out of reach of the 8 bit Huffman encoder here */
+static void make_binary(u8 *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = (i & 0x100) ? (i * 2654435761u) >> 24 : next_rand();
+}
+
+static void make_short(u8 *buf, size_t len)
+{
+	memcpy(buf, "abracadabra abracadabra", len);
+}
+
+static const dataset_t datasets[] = {
+	{"short", make_short, 23},
+	{"text", make_text, TEST_SIZE},
+	{"runs", make_runs, TEST_SIZE},
+	{"noise", make_noise, TEST_SIZE},
+	{"binary", make_binary, TEST_SIZE},
+};
+
+static const format_t formats[] = {
+	{"lz10", BIOSCOMP_LZ10, lz_encode},
+	{"lz11", BIOSCOMP_LZ11, lz_encode},
+	{"rle", BIOSCOMP_RLE, rle_encode},
+	{"huff4", BIOSCOMP_HUFF4, huff_encode},
+	{"huff8", BIOSCOMP_HUFF8, huff_encode},
+};
+
+static off_t stream_read(void *priv, void *buf, off_t size, off_t pos)
+{
+	const stream_t *s = priv;
+
+	if (pos >= s->size) return 0;
+	if (size > s->size - pos) size = s->size - pos;
+	memcpy(buf, &s->data[pos], size);
+	return size;
+}
+
+static void expect(const format_t *f, const dataset_t *d, const char *how, bool ok)
+{
+	printf("%-4s %-6s %-7s %s\n", ok ? "ok" : "FAIL", f->name, d->name, how);
+	if (!ok) failures++;
+}
+
+static void test_stream(const format_t *f, const dataset_t *d,
+	const u8 *src, const u8 *comp, size_t clen, u8 *out)
+{
+	static bioscomp_t z;
+	stream_t s = {comp, clen};
+	off_t pos, res;
+	size_t p;
+	bool ok;
+
+	if (IS_ERR(bioscomp_init(&z, stream_read, &s, clen))) {
+		expect(f, d, "init", false);
+		return;
+	}
+	expect(f, d, "size", bioscomp_size(&z) == (off_t)d->len);
+
+	memset(out, 0xAA, d->len);
+	res = bioscomp_read(&z, out, d->len + 1);
+	expect(f, d, "whole", res == (off_t)d->len && !memcmp(out, src, d->len) &&
+		bioscomp_read(&z, out, 1) == 0);
+
+	bioscomp_rewind(&z);
+	memset(out, 0xAA, d->len);
+	for (pos = 0, p = 0, ok = true; ok && pos < (off_t)d->len; p++) {
+		res = bioscomp_read(&z, &out[pos], pieces[p % ARRAY_SIZE(pieces)]);
+		ok = res > 0;
+		pos += res;
+	}
+	expect(f, d, "pieces", ok && !memcmp(out, src, d->len));
+
+	/* what a seeking reader does, every other piece only decoded */
+	bioscomp_rewind(&z);
+	for (pos = 0, p = 0, ok = true; ok && pos < (off_t)d->len; p++) {
+		size_t n = pieces[p % ARRAY_SIZE(pieces)];
+
+		res = bioscomp_read(&z, (p & 1) ? NULL : out, n);
+		ok = res > 0 && ((p & 1) || !memcmp(out, &src[pos], res));
+		pos += res;
+	}
+	expect(f, d, "skips", ok);
+	bioscomp_free(&z);
+
+	/* the last word can be padding, cut well before it */
+	if (clen > 16) {
+		s.size = clen - 5;
+		if (IS_ERR(bioscomp_init(&z, stream_read, &s, s.size))) {
+			expect(f, d, "truncated", true);
+		} else {
+			expect(f, d, "truncated", IS_ERR(bioscomp_read(&z, out, d->len)));
+			bioscomp_free(&z);
+		}
+	}
+}
+
+static void test_bighdr(u8 *comp, u8 *out)
+{
+	static const char msg[] = "long header, long header, long header";
+	static const dataset_t d = {"long", NULL, sizeof(msg)};
+	static bioscomp_t z;
+	stream_t s = {comp, 0};
+	size_t o;
+
+	/* same stream, behind the 8 byte header form */
+	o = rle_encode(comp + 4, (const u8*)msg, d.len, BIOSCOMP_RLE);
+	put_header(comp, BIOSCOMP_RLE, d.len, true);
+	s.size = o + 4;
+
+	bool ok = !IS_ERR(bioscomp_init(&z, stream_read, &s, s.size)) &&
+		bioscomp_size(&z) == (off_t)d.len &&
+		bioscomp_read(&z, out, d.len) == (off_t)d.len && !memcmp(out, msg, d.len);
+	expect(&formats[2], &d, "8 byte header", ok);
+	if (z.in) bioscomp_free(&z);
+}
+
+static void bench(const format_t *f, const u8 *comp, size_t clen, size_t len, u8 *out)
+{
+	static bioscomp_t z;
+	stream_t s = {comp, clen};
+	double start, secs;
+	off_t res, done = 0;
+
+	start = now();
+	if (IS_ERR(bioscomp_init(&z, stream_read, &s, clen))) return;
+	while((res = bioscomp_read(&z, out, TEST_BENCHBUF)) > 0)
+		done += res;
+	bioscomp_free(&z);
+	secs = now() - start;
+
+	if (done != (off_t)len) {
+		printf("FAIL %-6s bench decoded %lld of %lu\n", f->name, (long long)done, (unsigned long)len);
+		failures++;
+		return;
+	}
+
+	printf("{\"bench\":\"%s\",\"in\":%lu,\"out\":%lu,\"secs\":%.6f,\"mib_s\":%.2f}\n",
+		f->name, (unsigned long)clen, (unsigned long)len, secs, (len / 1048576.0) / secs);
+}
+
+int main(void)
+{
+	size_t worst = TEST_BENCHSZ * 8 + 1024;
+	u8 *src, *comp, *out;
+
+	src = malloc(TEST_BENCHSZ);
+	comp = malloc(worst);
+	out = malloc(TEST_BENCHSZ);
+	if (src == NULL || comp == NULL || out == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(datasets); i++) {
+		const dataset_t *d = &datasets[i];
+
+		datasets[i].make(src, d->len);
+		for (size_t j = 0; j < ARRAY_SIZE(formats); j++) {
+			const format_t *f = &formats[j];
+			size_t clen = f->encode(comp, src, d->len, f->type);
+
+			if (clen == 0) {
+				printf("skip %-6s %-7s too many symbols\n", f->name, d->name);
+				continue;
+			}
+			test_stream(f, d, src, comp, clen, out);
+		}
+	}
+	test_bighdr(comp, out);
+
+	if (failures) {
+		printf("%d failed\n", failures);
+		return 1;
+	}
+
+	make_text(src, TEST_BENCHSZ);
+	for (size_t j = 0; j < ARRAY_SIZE(formats); j++) {
+		const format_t *f = &formats[j];
+		size_t clen = f->encode(comp, src, TEST_BENCHSZ, f->type);
+		if (clen) bench(f, comp, clen, TEST_BENCHSZ, out);
+	}
+
+	free(out);
+	free(comp);
+	free(src);
+	return failures ? 1 : 0;
+}
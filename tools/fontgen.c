@@ -0,0 +1,85 @@
+/*
+ * expands the 1bpp 8x8 UI font into 4bpp NDS tiles at build time
+ * runs on the host, the output gets linked in with bin2o and copied
+ * straight into tile memory by ui_reset
+ *
+ * usage: fontgen <out.bin>
+ *
+ * the glyphs come from the `font` array in FONT_HEADER (source/ui/font.h
+ * unless the Makefile says otherwise), 8 bytes per glyph, so a bigger or
+ * extended font only needs a header with a bigger array
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define FONT_GLYPHS
+#include FONT_HEADER
+
+/* the map entries can address 1024 tiles, the icon slots take the last 64 */
+#define FONT_MAX_GLYPHS	(1024 - 64)
+
+#define FONT_TRANSPARENT	(0x00000000)
+#define FONT_OPAQUE			(0x11111111)
+
+static int put_word(FILE *f, uint32_t w)
+{
+	for (int i = 0; i < 4; i++) {
+		if (fputc((w >> (i * 8)) & 0xFF, f) == EOF) return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t glyphs = sizeof(font) / 8;
+	FILE *out;
+	int res = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <out.bin>\n", argv[0]);
+		return 1;
+	}
+
+	if ((sizeof(font) % 8) || glyphs < 2 || glyphs > FONT_MAX_GLYPHS) {
+		fprintf(stderr, "fontgen: bad font size (%zu bytes)\n", sizeof(font));
+		return 1;
+	}
+
+	out = fopen(argv[1], "wb");
+	if (out == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	for (size_t i = 0; i < glyphs && !res; i++) {
+		for (int y = 0; y < 8 && !res; y++) {
+			uint32_t row;
+
+			if (i == 0) {
+				row = FONT_TRANSPARENT;
+			} else if (i == 1) {
+				row = FONT_OPAQUE;
+			} else {
+				/* the leftmost pixel is the MSB and goes in the lowest nibble */
+				uint8_t bits = font[i * 8 + y];
+
+				row = FONT_OPAQUE;
+				for (int x = 0; x < 8; x++) {
+					if (bits & (0x80 >> x)) row |= 0xFu << (x * 4);
+				}
+			}
+
+			res = put_word(out, row);
+		}
+	}
+
+	if (fclose(out) != 0) res = -1;
+	if (res) {
+		perror(argv[1]);
+		remove(argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
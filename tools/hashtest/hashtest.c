@@ -0,0 +1,211 @@
+/*
+ * known answer tests for the hashing code, plus a throughput run
+ *
+ * usage: hashtest
+ *
+ * the CRC16 is the NDS flavour (0xA001 reflected, 0xFFFF init, no final
+ * xor), same as CRC-16/MODBUS, the rest are the usual CRC32, FIPS 180
+ * SHA-1 and SHA-256 vectors
+ *
+ * every vector is fed once in one go and once in odd sized, misaligned
+ * pieces, so the block buffering and the slice-by-8 alignment path get
+ * a workout as well
+ */
+
+#define _POSIX_C_SOURCE	199309L	/* clock_gettime */
+#include <time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "vfs.h"
+
+#include "hash.h"
+
+#define TEST_BENCHSZ	(SIZE_MIB(16))
+#define TEST_MILLION	(1000000)
+
+typedef struct {
+	const char *name;
+	const char *msg;	/**< NULL for a million 'a' */
+	u16 crc16;
+	u32 crc32;
+	const char *sha1;
+	const char *sha256;
+} vector_t;
+
+static const vector_t vectors[] = {
+	{
+		.name = "empty", .msg = "",
+		.crc16 = 0xFFFF, .crc32 = 0x00000000,
+		.sha1 = "da39a3ee5e6b4b0d3255bfef95601890afd80709",
+		.sha256 = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+	},
+	{
+		.name = "check", .msg = "123456789",
+		.crc16 = 0x4B37, .crc32 = 0xCBF43926,
+		.sha1 = "f7c3bc1d808e04732adf679965ccc34ca7ae3441",
+		.sha256 = "15e2b0d3c33891ebb0f1ef609ec419420c20e320ce94c65fbc8c3312448eb225",
+	},
+	{
+		.name = "abc", .msg = "abc",
+		.crc16 = 0x5749, .crc32 = 0x352441C2,
+		.sha1 = "a9993e364706816aba3e25717850c26c9cd0d89d",
+		.sha256 = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+	},
+	{
+		/* 56 bytes, the length no longer fits in the first block */
+		.name = "448 bits", .msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+		.crc16 = 0x71EC, .crc32 = 0x171A3F5F,
+		.sha1 = "84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+		.sha256 = "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+	},
+	{
+		.name = "million a", .msg = NULL,
+		.crc16 = 0x1D7D, .crc32 = 0xDC25BFBC,
+		.sha1 = "34aa973cd4c4daa4f61eeb2bdbad27316534016f",
+		.sha256 = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+	},
+};
+
+static const size_t pieces[] = {1, 3, 7, 63, 64, 65, 127, 1000};
+
+static int failures;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void check(const vector_t *v, const char *how, const hash_result_t *res)
+{
+	char sha1[SHA1_DIGEST_SIZE * 2 + 1], sha256[SHA256_DIGEST_SIZE * 2 + 1];
+	bool ok;
+
+	hash_hexstr(sha1, res->sha1, SHA1_DIGEST_SIZE);
+	hash_hexstr(sha256, res->sha256, SHA256_DIGEST_SIZE);
+
+	ok = res->crc16 == v->crc16 && res->crc32 == v->crc32 &&
+		!strcmp(sha1, v->sha1) && !strcmp(sha256, v->sha256);
+
+	printf("%-4s %-10s %s\n", ok ? "ok" : "FAIL", v->name, how);
+	if (ok) return;
+
+	printf("     crc16 %04x want %04x\n", res->crc16, v->crc16);
+	printf("     crc32 %08lx want %08lx\n", (unsigned long)res->crc32, (unsigned long)v->crc32);
+	printf("     sha1 %s\n     want %s\n", sha1, v->sha1);
+	printf("     sha256 %s\n     want %s\n", sha256, v->sha256);
+	failures++;
+}
+
+static void test_vector(const vector_t *v, u8 *scratch)
+{
+	hash_ctx_t ctx;
+	hash_result_t res;
+	const u8 *msg;
+	size_t len, pos, p;
+
+	if (v->msg) {
+		len = strlen(v->msg);
+		msg = (const u8*)v->msg;
+	} else {
+		len = TEST_MILLION;
+		memset(scratch, 'a', len);
+		msg = scratch;
+	}
+
+	hash_init(&ctx, HASH_ALL);
+	hash_update(&ctx, msg, len);
+	hash_final(&ctx, &res);
+	check(v, "whole", &res);
+
+	/* copied one byte in so every piece starts misaligned */
+	if (msg != scratch) memcpy(scratch + 1, msg, len);
+	else memmove(scratch + 1, scratch, len);
+
+	hash_init(&ctx, HASH_ALL);
+	for (pos = 0, p = 0; pos < len; p++) {
+		size_t n = pieces[p % ARRAY_SIZE(pieces)];
+		if (n > len - pos) n = len - pos;
+		hash_update(&ctx, scratch + 1 + pos, n);
+		pos += n;
+	}
+	hash_final(&ctx, &res);
+	check(v, "pieces", &res);
+}
+
+static void test_oneshot(void)
+{
+	/* the header checksum helpers chain like the streaming ones */
+	u32 crc32 = hash_crc32(hash_crc32(0, "1234", 4), "56789", 5);
+	u16 crc16 = hash_crc16(hash_crc16(0xFFFF, "1234", 4), "56789", 5);
+	bool ok = crc32 == 0xCBF43926 && crc16 == 0x4B37;
+
+	printf("%-4s %-10s %s\n", ok ? "ok" : "FAIL", "check", "one-shot chained");
+	if (!ok) failures++;
+}
+
+static void bench(const char *name, int algos, const u8 *buf, size_t len)
+{
+	hash_ctx_t ctx;
+	hash_result_t res;
+	double start, secs;
+
+	start = now();
+	hash_init(&ctx, algos);
+	hash_update(&ctx, buf, len);
+	hash_final(&ctx, &res);
+	secs = now() - start;
+
+	printf("{\"bench\":\"%s\",\"bytes\":%lu,\"secs\":%.6f,\"mib_s\":%.2f}\n",
+		name, (unsigned long)len, secs, (len / 1048576.0) / secs);
+}
+
+int main(void)
+{
+	u8 *scratch, *buf;
+
+	scratch = malloc(TEST_MILLION + 1);
+	buf = malloc(TEST_BENCHSZ);
+	if (scratch == NULL || buf == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(vectors); i++)
+		test_vector(&vectors[i], scratch);
+	test_oneshot();
+
+	if (failures) {
+		printf("%d failed\n", failures);
+		return 1;
+	}
+
+	for (size_t i = 0; i < TEST_BENCHSZ; i++)
+		buf[i] = i * 2654435761u >> 24;
+
+	bench("crc16", HASH_CRC16, buf, TEST_BENCHSZ);
+	bench("crc32", HASH_CRC32, buf, TEST_BENCHSZ);
+	bench("sha1", HASH_SHA1, buf, TEST_BENCHSZ);
+	bench("sha256", HASH_SHA256, buf, TEST_BENCHSZ);
+	bench("all", HASH_ALL, buf, TEST_BENCHSZ);
+
+	free(buf);
+	free(scratch);
+	return 0;
+}
+
+/* hash_fd and hash_file aren't exercised, the VFS underneath is left out */
+off_t vfs_size(int fd) { return -ERR_UNSUPP; }
+off_t vfs_read(int fd, void *buf, off_t size) { return -ERR_UNSUPP; }
+int vfs_map(int fd, off_t pos, const void **ptr, off_t *len) { return -ERR_UNSUPP; }
+int vfs_unmap(int fd, const void *ptr) { return -ERR_UNSUPP; }
+int vfs_open(const char *path, int mode) { return -ERR_UNSUPP; }
+int vfs_close(int fd) { return -ERR_UNSUPP; }
@@ -0,0 +1,192 @@
+/*
+ * checks for the NDS ROM header validation, against crafted headers
+ *
+ * usage: srltest
+ *
+ * the real logo isn't shipped, a synthetic one gets its last two bytes
+ * forced so its CRC16 matches the known one, which is all the parser
+ * looks at
+ *
+ * srl_read_header gets its data from an in-memory "file" that can be
+ * cut short or made to fail, the rest of srl.c only has stubs to link
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <nds.h>
+
+#include "global.h"
+#include "err.h"
+
+#include "fident.h"
+#include "hash.h"
+#include "ui.h"
+#include "vfs.h"
+
+#include "nitrofs.h"
+#include "srl.h"
+#include "xfer.h"
+
+static u8 image[SRL_HDR_SIZE] __attribute__((aligned(4)));
+static off_t image_len;
+static int image_err;
+
+static int failures;
+
+static void expect(const char *what, int got, int want)
+{
+	bool ok = (got == want);
+
+	printf("%-4s %s", ok ? "ok" : "FAIL", what);
+	if (!ok) {
+		printf(" (got %d, want %d)", got, want);
+		failures++;
+	}
+	printf("\n");
+}
+
+/* a plausible header with both checksums right */
+static void make_good(srl_header_t *hdr)
+{
+	u16 crc;
+
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->title, "SRLTEST", 7);
+	memcpy(hdr->gamecode, "TEST", 4);
+	memcpy(hdr->makercode, "01", 2);
+	hdr->arm9.rom_offset = 0x4000;
+	hdr->arm9.entry = hdr->arm9.ram_addr = 0x02000000;
+	hdr->arm9.size = 0x1000;
+	hdr->header_size = SRL_HDR_SIZE;
+
+	for (int i = 0; i < SRL_LOGO_SIZE - 2; i++)
+		hdr->logo[i] = i * 37 + 11;
+
+	/* CRC16 without a final xor, two trailing bytes can reach any value */
+	crc = hash_crc16(0xFFFF, hdr->logo, SRL_LOGO_SIZE - 2);
+	for (u32 tail = 0; tail < 0x10000; tail++) {
+		u8 b[2] = {tail, tail >> 8};
+		if (hash_crc16(crc, b, 2) == SRL_LOGO_CRC) {
+			memcpy(&hdr->logo[SRL_LOGO_SIZE - 2], b, 2);
+			break;
+		}
+	}
+	hdr->logo_crc = hash_crc16(0xFFFF, hdr->logo, SRL_LOGO_SIZE);
+	hdr->header_crc = hash_crc16(0xFFFF, hdr, SRL_HDR_CRC_LEN);
+}
+
+static void reseal(srl_header_t *hdr)
+{
+	hdr->header_crc = hash_crc16(0xFFFF, hdr, SRL_HDR_CRC_LEN);
+}
+
+static void test_parse(void)
+{
+	srl_header_t hdr;
+
+	make_good(&hdr);
+	expect("good header", srl_parse_header(&hdr), SRL_HDR_OK | SRL_LOGO_OK);
+
+	hdr.banner_offset = 0x8000;
+	reseal(&hdr);
+	expect("good header with a banner", srl_parse_header(&hdr),
+		SRL_HDR_OK | SRL_LOGO_OK | SRL_HAS_BANNER);
+
+	make_good(&hdr);
+	hdr.title[0] ^= 1;
+	expect("title damaged", srl_parse_header(&hdr), SRL_LOGO_OK);
+
+	make_good(&hdr);
+	hdr.header_crc ^= 0x8000;
+	expect("header CRC damaged", srl_parse_header(&hdr), SRL_LOGO_OK);
+
+	/* the header CRC covers the logo, resealed so only the logo check trips */
+	make_good(&hdr);
+	hdr.logo[0] ^= 1;
+	reseal(&hdr);
+	expect("logo damaged", srl_parse_header(&hdr), SRL_HDR_OK);
+
+	/* self consistent, just not the known logo */
+	make_good(&hdr);
+	hdr.logo[0] ^= 1;
+	hdr.logo_crc = hash_crc16(0xFFFF, hdr.logo, SRL_LOGO_SIZE);
+	reseal(&hdr);
+	expect("unknown logo", srl_parse_header(&hdr), SRL_HDR_OK);
+
+	/* the part past the CRC'd range doesn't matter */
+	make_good(&hdr);
+	hdr.reserved2[0] = 0xFF;
+	expect("reserved area changed", srl_parse_header(&hdr), SRL_HDR_OK | SRL_LOGO_OK);
+
+	memset(&hdr, 0, sizeof(hdr));
+	expect("all zeroes", srl_parse_header(&hdr), 0);
+
+	memset(&hdr, 0xFF, sizeof(hdr));
+	expect("all ones", srl_parse_header(&hdr), SRL_HAS_BANNER);
+}
+
+static void test_read(void)
+{
+	srl_header_t hdr;
+	static const off_t cuts[] = {0, 1, SRL_HDR_CRC_LEN, SRL_HDR_SIZE - 1};
+	char what[64];
+
+	make_good((srl_header_t*)image);
+
+	image_len = SRL_HDR_SIZE;
+	image_err = 0;
+	expect("read whole header", srl_read_header(0, &hdr), SRL_HDR_OK | SRL_LOGO_OK);
+
+	for (size_t i = 0; i < ARRAY_SIZE(cuts); i++) {
+		image_len = cuts[i];
+		snprintf(what, sizeof(what), "read truncated to %d bytes", (int)cuts[i]);
+		expect(what, srl_read_header(0, &hdr), -ERR_IO);
+	}
+
+	image_len = SRL_HDR_SIZE;
+	image_err = -ERR_NOTREADY;
+	expect("read error passed through", srl_read_header(0, &hdr), -ERR_NOTREADY);
+}
+
+int main(void)
+{
+	test_parse();
+	test_read();
+
+	if (failures) {
+		printf("%d failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
+
+/* the header "file", positional reads only */
+off_t vfs_pread(int fd, void *buf, off_t size, off_t pos)
+{
+	if (image_err) return image_err;
+	if (pos >= image_len) return 0;
+	if (size > image_len - pos) size = image_len - pos;
+	memcpy(buf, &image[pos], size);
+	return size;
+}
+
+/* only there to link, nothing here is reached */
+int vfs_open(const char *path, int mode) { return -ERR_UNSUPP; }
+int vfs_close(int fd) { return -ERR_UNSUPP; }
+off_t vfs_size(int fd) { return -ERR_UNSUPP; }
+off_t vfs_read(int fd, void *buf, off_t size) { return -ERR_UNSUPP; }
+int vfs_map(int fd, off_t pos, const void **ptr, off_t *len) { return -ERR_UNSUPP; }
+int vfs_unmap(int fd, const void *ptr) { return -ERR_UNSUPP; }
+
+int fident_register(fident_handler_t *handler) { return 0; }
+int nitrofs_mount(char drive, const char *path) { return -ERR_UNSUPP; }
+
+u16 ui_shadow[2][4][UI_SHADOW_SIZE];
+vu32 ui_dirty[2][4];
+void xfer_fill16(void *dst, u16 val, size_t count) { }
+vu16 *ui_map(int screen, int bg) { return NULL; }
+void ui_icon_load(int screen, int slot, const void *tiles, const u16 *pal) { }
+void ui_drawicon(vu16 *map, int slot, size_t x, size_t y) { }
+void ui_drawstr(vu16 *map, size_t x, size_t y, const char *str) { }
+void ui_msg(const char *str) { }
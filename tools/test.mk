@@ -0,0 +1,37 @@
+#---------------------------------------------------------------------------------
+# shared rules for the host test programs, included at the end of their
+# Makefiles once these are set
+#
+#   TOPDIR    path to the top of the repo
+#   SRCDIR    $(TOPDIR)/source
+#   TARGET    program name, also what make run runs
+#   INCDIRS   directories under source/ searched for quoted includes
+#   SOURCES   the test itself and whatever it takes from source/
+#---------------------------------------------------------------------------------
+BUILD    := build
+
+CC       ?= cc
+CFLAGS   := -std=c99 -O2 -g -Wall -Wno-unused-function -Dtypeof=__typeof__\
+            -I$(TOPDIR)/tools/bench/include -iquote . \
+            $(foreach dir,$(INCDIRS),-iquote $(SRCDIR)/$(dir))
+
+OBJECTS  := $(addprefix $(BUILD)/,$(notdir $(SOURCES:.c=.o)))
+
+vpath %.c . $(sort $(dir $(SOURCES)))
+
+.PHONY: all run clean
+
+all: $(TARGET)
+
+$(TARGET): $(OBJECTS)
+	$(CC) $(CFLAGS) $^ -o $@
+
+$(BUILD)/%.o: %.c
+	@mkdir -p $(BUILD)
+	$(CC) $(CFLAGS) -c $< -o $@
+
+run: $(TARGET)
+	./$(TARGET)
+
+clean:
+	rm -rf $(BUILD) $(TARGET)
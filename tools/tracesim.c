@@ -0,0 +1,364 @@
+/*
+ * replays a block I/O trace (make TRACE=1, "Trace:/disk.trc") through
+ * candidate sector cache policies and reports hit rates and time
+ *
+ * usage: tracesim <disk.trc> [policy...]
+ *
+ * policies:
+ *   none              every request goes to the card
+ *   lru:N             N sector LRU cache, write-through
+ *   lru:N:raK         same, misses read K extra sectors ahead
+ *   wb:N[:raK]        same, writes stay in the cache until evicted
+ *
+ * without any policy a few cache sizes are compared
+ *
+ * the card is modelled as a fixed cost per request plus a cost per
+ * sector, fitted to the latencies in the trace itself (reads and writes
+ * separately), cache hits are free
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* must match disktrace.h */
+#define DISKTRACE_MAGIC		(0x43525444)
+#define DISKTRACE_WRITE		(1 << 0)
+#define DISKTRACE_ERROR		(1 << 1)
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t rec_size;
+	uint32_t tick_hz;
+	uint32_t count;
+	uint32_t lost;
+	uint32_t reserved[3];
+} trace_hdr_t;
+
+typedef struct {
+	uint32_t time;
+	uint32_t latency;
+	uint32_t lba;
+	uint32_t count;
+	uint16_t drive;
+	uint16_t flags;
+} trace_rec_t;
+
+/* time = base + per_sector * sectors, in ticks */
+typedef struct {
+	double base, per_sector;
+} cost_t;
+
+typedef struct {
+	uint64_t key;
+	int prev, next;		/* LRU list, most recent at the head */
+	int hnext;			/* hash chain */
+	int dirty;
+} slot_t;
+
+typedef struct {
+	const char *name;
+	int size, ahead, writeback;
+
+	slot_t *slots;
+	int *buckets;
+	int nbuckets, used, head, tail;
+
+	uint64_t lookups, hits, flushes;
+	double time;
+} cache_t;
+
+static trace_rec_t *recs;
+static uint32_t nrecs;
+static cost_t cost[2];
+
+static uint64_t sect_key(int drive, uint32_t lba)
+{
+	return ((uint64_t)drive << 32) | lba;
+}
+
+static int hash_key(const cache_t *c, uint64_t key)
+{
+	return (int)((key * 0x9E3779B97F4A7C15ULL) >> 40) & (c->nbuckets - 1);
+}
+
+static double req_cost(int write, uint32_t sectors)
+{
+	return cost[write].base + cost[write].per_sector * sectors;
+}
+
+static void list_unlink(cache_t *c, int i)
+{
+	slot_t *s = &c->slots[i];
+	if (s->prev >= 0) c->slots[s->prev].next = s->next; else c->head = s->next;
+	if (s->next >= 0) c->slots[s->next].prev = s->prev; else c->tail = s->prev;
+}
+
+static void list_push(cache_t *c, int i)
+{
+	slot_t *s = &c->slots[i];
+	s->prev = -1;
+	s->next = c->head;
+	if (c->head >= 0) c->slots[c->head].prev = i;
+	c->head = i;
+	if (c->tail < 0) c->tail = i;
+}
+
+static int cache_find(cache_t *c, uint64_t key)
+{
+	for (int i = c->buckets[hash_key(c, key)]; i >= 0; i = c->slots[i].hnext) {
+		if (c->slots[i].key == key) return i;
+	}
+	return -1;
+}
+
+static void hash_remove(cache_t *c, int i)
+{
+	int *p = &c->buckets[hash_key(c, c->slots[i].key)];
+	while(*p != i) p = &c->slots[*p].hnext;
+	*p = c->slots[i].hnext;
+}
+
+/* puts a sector at the head of the list, evicting the tail if full */
+static void cache_insert(cache_t *c, uint64_t key, int dirty)
+{
+	int i = cache_find(c, key);
+
+	if (i >= 0) {
+		list_unlink(c, i);
+	} else {
+		if (c->used < c->size) {
+			i = c->used++;
+		} else {
+			i = c->tail;
+			list_unlink(c, i);
+			hash_remove(c, i);
+			/* dirty sectors get written back one at a time */
+			if (c->slots[i].dirty) {
+				c->time += req_cost(1, 1);
+				c->flushes++;
+			}
+		}
+
+		c->slots[i].key = key;
+		c->slots[i].dirty = 0;
+		c->slots[i].hnext = c->buckets[hash_key(c, key)];
+		c->buckets[hash_key(c, key)] = i;
+	}
+
+	c->slots[i].dirty |= dirty;
+	list_push(c, i);
+}
+
+static void cache_touch(cache_t *c, int i)
+{
+	list_unlink(c, i);
+	list_push(c, i);
+}
+
+static void cache_read(cache_t *c, const trace_rec_t *r)
+{
+	uint32_t s = 0;
+
+	while(s < r->count) {
+		uint32_t run = 0, fetch;
+		int i;
+
+		c->lookups++;
+		i = cache_find(c, sect_key(r->drive, r->lba + s));
+		if (i >= 0) {
+			c->hits++;
+			cache_touch(c, i);
+			s++;
+			continue;
+		}
+
+		/* one card request for the whole run of missing sectors */
+		while(s + run < r->count && cache_find(c, sect_key(r->drive, r->lba + s + run)) < 0)
+			run++;
+		c->lookups += run - 1;
+
+		fetch = run + ((s + run == r->count) ? c->ahead : 0);
+		c->time += req_cost(0, fetch);
+		for (uint32_t j = 0; j < fetch; j++)
+			cache_insert(c, sect_key(r->drive, r->lba + s + j), 0);
+		s += run;
+	}
+}
+
+static void cache_write(cache_t *c, const trace_rec_t *r)
+{
+	if (!c->writeback) c->time += req_cost(1, r->count);
+	for (uint32_t s = 0; s < r->count; s++)
+		cache_insert(c, sect_key(r->drive, r->lba + s), c->writeback);
+}
+
+static int cache_setup(cache_t *c, const char *spec)
+{
+	char kind[8] = "";
+	int n = 0;
+	const char *ra;
+
+	memset(c, 0, sizeof(*c));
+	c->name = spec;
+	c->head = c->tail = -1;
+
+	if (!strcmp(spec, "none")) return 0;
+
+	if (sscanf(spec, "%7[a-z]:%d", kind, &n) != 2 || n <= 0) return -1;
+	if (!strcmp(kind, "wb")) {
+		c->writeback = 1;
+	} else if (strcmp(kind, "lru")) {
+		return -1;
+	}
+
+	ra = strstr(spec, ":ra");
+	if (ra != NULL) c->ahead = atoi(ra + 3);
+
+	c->size = n;
+	for (c->nbuckets = 1; c->nbuckets < n * 2; c->nbuckets <<= 1);
+	c->slots = calloc(n, sizeof(*c->slots));
+	c->buckets = malloc(c->nbuckets * sizeof(*c->buckets));
+	if (c->slots == NULL || c->buckets == NULL) return -1;
+	memset(c->buckets, 0xFF, c->nbuckets * sizeof(*c->buckets));
+	return 0;
+}
+
+static void cache_run(cache_t *c)
+{
+	for (uint32_t i = 0; i < nrecs; i++) {
+		const trace_rec_t *r = &recs[i];
+		int write = r->flags & DISKTRACE_WRITE;
+
+		if (c->size == 0) {
+			c->time += req_cost(write, r->count);
+			c->lookups += r->count;
+			continue;
+		}
+
+		if (write) cache_write(c, r);
+		else cache_read(c, r);
+	}
+
+	/* whatever is still dirty has to reach the card eventually */
+	for (int i = 0; i < c->used; i++) {
+		if (c->slots[i].dirty) {
+			c->time += req_cost(1, 1);
+			c->flushes++;
+		}
+	}
+}
+
+/* least squares fit of latency against sector count */
+static void fit_costs(void)
+{
+	for (int w = 0; w < 2; w++) {
+		double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0, d;
+
+		for (uint32_t i = 0; i < nrecs; i++) {
+			const trace_rec_t *r = &recs[i];
+			if (!!(r->flags & DISKTRACE_WRITE) != w || (r->flags & DISKTRACE_ERROR)) continue;
+			n++;
+			sx += r->count;
+			sy += r->latency;
+			sxx += (double)r->count * r->count;
+			sxy += (double)r->count * r->latency;
+		}
+
+		if (n == 0) continue;
+
+		d = n * sxx - sx * sx;
+		if (d > 0) {
+			cost[w].per_sector = (n * sxy - sx * sy) / d;
+			cost[w].base = (sy - cost[w].per_sector * sx) / n;
+		}
+
+		/* all requests the same size (or a nonsense fit), share it all out per sector */
+		if (d <= 0 || cost[w].per_sector < 0 || cost[w].base < 0) {
+			cost[w].base = 0;
+			cost[w].per_sector = sy / sx;
+		}
+	}
+
+	/* a trace without writes still needs something to charge write-backs */
+	if (cost[1].per_sector == 0 && cost[1].base == 0) cost[1] = cost[0];
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *defaults[] = {
+		"none", "lru:8", "lru:32", "lru:128", "lru:128:ra8",
+		"lru:512", "lru:512:ra32", "wb:128", "wb:512:ra32",
+	};
+	const char **specs = defaults;
+	int nspecs = sizeof(defaults) / sizeof(*defaults);
+	double measured = 0, ms;
+	uint64_t sectors[2] = {0, 0};
+	trace_hdr_t hdr;
+	FILE *f;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <disk.trc> [policy...]\n", argv[0]);
+		return 1;
+	}
+
+	if (argc > 2) {
+		specs = (const char **)&argv[2];
+		nspecs = argc - 2;
+	}
+
+	f = fopen(argv[1], "rb");
+	if (f == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != DISKTRACE_MAGIC ||
+		hdr.rec_size != sizeof(trace_rec_t) || hdr.tick_hz == 0) {
+		fprintf(stderr, "%s: not a disk trace\n", argv[1]);
+		return 1;
+	}
+
+	recs = malloc((size_t)hdr.count * sizeof(*recs) + 1);
+	if (recs == NULL) return 1;
+	nrecs = fread(recs, sizeof(*recs), hdr.count, f);
+	fclose(f);
+
+	for (uint32_t i = 0; i < nrecs; i++) {
+		measured += recs[i].latency;
+		sectors[!!(recs[i].flags & DISKTRACE_WRITE)] += recs[i].count;
+	}
+
+	fit_costs();
+	ms = 1000.0 / hdr.tick_hz;
+
+	printf("%u requests (%u lost), %llu sectors read, %llu written\n", nrecs, hdr.lost,
+		(unsigned long long)sectors[0], (unsigned long long)sectors[1]);
+	printf("measured %.2f ms, model: read %.1f + %.1f/sect us, write %.1f + %.1f/sect us\n\n",
+		measured * ms,
+		cost[0].base * ms * 1000, cost[0].per_sector * ms * 1000,
+		cost[1].base * ms * 1000, cost[1].per_sector * ms * 1000);
+
+	printf("%-16s %10s %8s %10s %12s\n", "policy", "lookups", "hit%", "flushes", "time_ms");
+	for (int i = 0; i < nspecs; i++) {
+		cache_t c;
+
+		if (cache_setup(&c, specs[i])) {
+			fprintf(stderr, "bad policy \"%s\"\n", specs[i]);
+			return 1;
+		}
+
+		cache_run(&c);
+		printf("%-16s %10llu %7.2f%% %10llu %12.2f\n", c.name,
+			(unsigned long long)c.lookups,
+			c.lookups ? (100.0 * c.hits / c.lookups) : 0.0,
+			(unsigned long long)c.flushes, c.time * ms);
+
+		free(c.slots);
+		free(c.buckets);
+	}
+
+	return 0;
+}